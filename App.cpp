@@ -1,6 +1,9 @@
 #include "Game/App.hpp"
 #include "Game/Game.hpp"
 #include "Game/GameCommon.hpp"
+#include "Game/BlockDefinition.hpp"
+#include "Game/SaveMigrator.hpp"
+#include "Game/WorldBackup.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Audio/AudioSystem.hpp"
@@ -10,6 +13,7 @@
 #include "Engine/Core/DevConsole.hpp"
 #include "Engine/Renderer/DebugRenderSystem.hpp"
 #include "Engine/JobSystem/JobSystem.hpp"
+#include <cstdio>
 
 
 App* g_theApp = nullptr;
@@ -19,18 +23,13 @@ InputSystem* g_theInput = nullptr;
 AudioSystem* g_theAudio = nullptr;
 Window*		 g_theWindow = nullptr;
 
-Game* m_theGame = nullptr;
+Game* g_theGame = nullptr;
 
 
 //public game flow functions
 void App::Startup()
 {
-	XmlDocument gameConfigXml;
-	char const* filePath = "Data/GameConfig.xml";
-	XmlError result = gameConfigXml.LoadFile(filePath);
-	GUARANTEE_OR_DIE(result == tinyxml2::XML_SUCCESS, Stringf("Failed to open game config file!"));
-	XmlElement* root = gameConfigXml.RootElement();
-	g_gameConfigBlackboard.PopulateFromXmlElementAttributes(*root);
+	LoadGameConfig();
 	
 	EventSystemConfig eventSystemConfig;
 	g_theEventSystem = new EventSystem(eventSystemConfig);
@@ -71,8 +70,8 @@ void App::Startup()
 	debugRenderConfig.m_renderer = g_theRenderer;
 	DebugRenderSystemStartup(debugRenderConfig);
 
-	m_theGame = new Game();
-	m_theGame->Startup();
+	g_theGame = new Game();
+	g_theGame->Startup();
 
 	SubscribeEventCallbackFunction("quit", Event_Quit);
 
@@ -103,9 +102,9 @@ void App::Run()
 
 void App::Shutdown()
 {
-	m_theGame->Shutdown();
-	delete m_theGame;
-	m_theGame = nullptr;
+	g_theGame->Shutdown();
+	delete g_theGame;
+	g_theGame = nullptr;
 
 	DebugRenderSystemShutdown();
 
@@ -152,6 +151,84 @@ void App::RunFrame()
 }
 
 
+//
+//public headless functions
+//
+int App::RunHeadless(std::string const& commandLine)
+{
+	//tools like the save migrator only need config, events, jobs, and block definitions, so no window or renderer gets made
+	LoadGameConfig();
+
+	EventSystemConfig eventSystemConfig;
+	g_theEventSystem = new EventSystem(eventSystemConfig);
+
+	JobSystemConfig jobSystemConfig;
+	g_theJobSystem = new JobSystem(jobSystemConfig);
+
+	g_theEventSystem->Startup();
+	g_theJobSystem->Startup();
+
+	BlockDefinition::InitializeBlockDefs();
+
+	//the command line reads like a dev console command: a command name, then key=value args separated by spaces
+	std::string commandName;
+	EventArgs args;
+	size_t wordStartIndex = 0;
+	while (wordStartIndex < commandLine.size())
+	{
+		size_t wordEndIndex = commandLine.find(' ', wordStartIndex);
+		if (wordEndIndex == std::string::npos)
+		{
+			wordEndIndex = commandLine.size();
+		}
+
+		std::string word = commandLine.substr(wordStartIndex, wordEndIndex - wordStartIndex);
+		size_t equalsIndex = word.find('=');
+		if (commandName.empty())
+		{
+			commandName = word;
+		}
+		else if (equalsIndex != std::string::npos)
+		{
+			args.SetValue(word.substr(0, equalsIndex), word.substr(equalsIndex + 1));
+		}
+
+		wordStartIndex = wordEndIndex + 1;
+	}
+
+	bool wasSuccessful = false;
+	if (commandName == "migratesaves")
+	{
+		wasSuccessful = SaveMigrator::Event_MigrateSaves(args);
+	}
+	else if (commandName == "backupworld")
+	{
+		wasSuccessful = WorldBackup::Event_BackupWorld(args);
+	}
+	else if (commandName == "restorebackup")
+	{
+		wasSuccessful = WorldBackup::Event_RestoreBackup(args);
+	}
+	else
+	{
+		printf("Unknown command \"%s\"\n", commandName.c_str());
+		printf("Usage: SimpleMiner migratesaves [seed=N] [codec=rle|palette|lz] [verifyOnly=true]\n");
+		printf("       SimpleMiner backupworld [seed=N]\n");
+		printf("       SimpleMiner restorebackup [seed=N] [snapshot=N]\n");
+	}
+
+	g_theJobSystem->Shutdown();
+	delete g_theJobSystem;
+	g_theJobSystem = nullptr;
+
+	g_theEventSystem->Shutdown();
+	delete g_theEventSystem;
+	g_theEventSystem = nullptr;
+
+	return wasSuccessful ? 0 : 1;
+}
+
+
 //
 //public app utilities
 //
@@ -200,7 +277,7 @@ void App::Update()
 	//quit or leave attract mode if q is pressed
 	if (g_theInput->WasKeyJustPressed(KEYCODE_ESC))
 	{
-		if (m_theGame->m_isAttractMode)
+		if (g_theGame->m_isAttractMode)
 		{
 			HandleQuitRequested();
 		}
@@ -211,7 +288,7 @@ void App::Update()
 	}
 
 	//set mouse state based on game
-	if (!g_theDevConsole->IsOpen() && Window::GetWindowContext()->HasFocus() && !m_theGame->m_isAttractMode)
+	if (!g_theDevConsole->IsOpen() && Window::GetWindowContext()->HasFocus() && !g_theGame->m_isAttractMode)
 	{
 		g_theInput->SetCursorMode(true, true);
 	}
@@ -221,10 +298,10 @@ void App::Update()
 	}
 
 	//update the game
-	m_theGame->Update();
+	g_theGame->Update();
 
 	//go back to the start if the game finishes
-	if (m_theGame->m_isFinished)
+	if (g_theGame->m_isFinished)
 	{
 		RestartGame();
 	}
@@ -233,7 +310,7 @@ void App::Update()
 
 void App::Render() const
 {	
-	m_theGame->Render();
+	g_theGame->Render();
 
 	//render dev console separately from and after rest of game
 	g_theRenderer->BeginCamera(m_devConsoleCamera);
@@ -259,12 +336,23 @@ void App::EndFrame()
 //
 //private app utilities
 //
+void App::LoadGameConfig()
+{
+	XmlDocument gameConfigXml;
+	char const* filePath = "Data/GameConfig.xml";
+	XmlError result = gameConfigXml.LoadFile(filePath);
+	GUARANTEE_OR_DIE(result == tinyxml2::XML_SUCCESS, Stringf("Failed to open game config file!"));
+	XmlElement* root = gameConfigXml.RootElement();
+	g_gameConfigBlackboard.PopulateFromXmlElementAttributes(*root);
+}
+
+
 void App::RestartGame()
 {
 	//delete old game
-	m_theGame->Shutdown();
-	delete m_theGame;
-	m_theGame = nullptr;
+	g_theGame->Shutdown();
+	delete g_theGame;
+	g_theGame = nullptr;
 
 	g_theJobSystem->Shutdown();
 	delete g_theJobSystem;
@@ -275,6 +363,6 @@ void App::RestartGame()
 	g_theJobSystem = new JobSystem(jobSystemConfig);
 	g_theJobSystem->Startup();
 
-	m_theGame = new Game();
-	m_theGame->Startup();
+	g_theGame = new Game();
+	g_theGame->Startup();
 }
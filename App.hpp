@@ -13,6 +13,9 @@ public:
 	void Shutdown();
 	void RunFrame();
 
+	//headless functions
+	int RunHeadless(std::string const& commandLine);
+
 	//app utilities
 	bool IsQuitting() const { return m_isQuitting; }
 	bool HandleQuitRequested();
@@ -29,6 +32,7 @@ private:
 	void EndFrame();
 
 	//app utilities
+	void LoadGameConfig();
 	void RestartGame();
 
 //private member variables
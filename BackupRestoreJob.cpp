@@ -0,0 +1,36 @@
+#include "Game/BackupRestoreJob.hpp"
+#include "Game/RegionFile.hpp"
+#include "Engine/Core/FileUtils.hpp"
+
+
+void BackupRestoreJob::Execute()
+{
+	RegionFile regionFile(m_regionFilePath);
+
+	std::vector<uint8_t> payload;
+	for (int entryIndex = 0; entryIndex < static_cast<int>(m_entries.size()); entryIndex++)
+	{
+		BackupEntry const& entry = m_entries[entryIndex];
+
+		//a damaged or missing object fails the whole restore, since the world it would make isn't the one that was backed up
+		std::string objectFilePath = WorldBackup::GetObjectFilePath(m_worldSeed, entry.m_payloadHash);
+		if (FileReadToBuffer(payload, objectFilePath) <= 0 || payload.size() != entry.m_payloadSize || WorldBackup::HashPayload(payload.data(), payload.size()) != entry.m_payloadHash)
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i payload is missing or damaged", entry.m_chunkCoords.x, entry.m_chunkCoords.y));
+			m_numChunksFailed++;
+			continue;
+		}
+
+		if (!regionFile.WriteChunk(entry.m_chunkCoords, payload))
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i couldn't be written to its region", entry.m_chunkCoords.x, entry.m_chunkCoords.y));
+			m_numChunksFailed++;
+			continue;
+		}
+
+		m_numChunksRestored++;
+		m_numBytesRestored += payload.size();
+	}
+
+	regionFile.Flush();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Game/WorldBackup.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <string>
+#include <vector>
+
+
+//rebuilds one region file of a restored world from the backup's object store, checking every payload against its hash on the way
+//each region is written into the restore folder by exactly one job, so it needs no locking
+class BackupRestoreJob : public Job
+{
+//public member functions
+public:
+	BackupRestoreJob(unsigned int worldSeed, std::string const& regionFilePath, std::vector<BackupEntry> const& entries)
+		: m_worldSeed(worldSeed)
+		, m_regionFilePath(regionFilePath)
+		, m_entries(entries)
+	{}
+
+	virtual void Execute() override;
+
+//public member variables
+public:
+	unsigned int			 m_worldSeed = 0;
+	std::string				 m_regionFilePath;
+	std::vector<BackupEntry> m_entries;	//every chunk in this region
+
+	//results
+	int						 m_numChunksRestored = 0;
+	int						 m_numChunksFailed = 0;
+	size_t					 m_numBytesRestored = 0;
+	std::vector<std::string> m_errors;
+};
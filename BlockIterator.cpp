@@ -17,7 +17,7 @@ BlockIterator::BlockIterator(int blockIndex, Chunk* chunk)
 //
 //general accessors
 //
-Block* BlockIterator::GetBlock() const
+Block const* BlockIterator::GetBlock() const
 {
 	if (m_chunk == nullptr)
 	{
@@ -25,7 +25,19 @@ Block* BlockIterator::GetBlock() const
 	}
 	GUARANTEE_OR_DIE(m_blockIndex >= 0 && m_blockIndex < CHUNK_TOTAL_BLOCKS, "Bad block index on block iterator!");
 	
-	return &m_chunk->m_blocks[m_blockIndex];
+	return m_chunk->GetBlock(m_blockIndex);
+}
+
+
+Block* BlockIterator::GetBlockForWrite() const
+{
+	if (m_chunk == nullptr)
+	{
+		return nullptr;
+	}
+	GUARANTEE_OR_DIE(m_blockIndex >= 0 && m_blockIndex < CHUNK_TOTAL_BLOCKS, "Bad block index on block iterator!");
+
+	return m_chunk->GetBlockForWrite(m_blockIndex);
 }
 
 
@@ -141,7 +153,7 @@ BlockIterator BlockIterator::GetWestNeighbor() const
 
 	if (localX == -1)
 	{
-		localX = 15;
+		localX = CHUNK_MAX_X;
 		chunk = m_chunk->m_westNeighbor;
 	}
 
@@ -199,7 +211,7 @@ BlockIterator BlockIterator::GetSouthNeighbor() const
 
 	if (localY == -1)
 	{
-		localY = 15;
+		localY = CHUNK_MAX_Y;
 		chunk = m_chunk->m_southNeighbor;
 	}
 
@@ -16,7 +16,8 @@ public:
 	explicit BlockIterator(int blockIndex, Chunk* chunk);
 
 	//general accessors
-	Block* GetBlock() const;
+	Block const* GetBlock() const;
+	Block* GetBlockForWrite() const;
 	Chunk* GetChunk() const;
 	int	   GetBlockIndex() const;
 	Vec3   GetWorldCenter() const;
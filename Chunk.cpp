@@ -1,5 +1,12 @@
 #include "Game/Chunk.hpp"
+#include "Game/ChunkSnapshot.hpp"
+#include "Game/ChunkMeshJob.hpp"
+#include "Game/ChunkSectionPool.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/MappedFile.hpp"
+#include "Game/RegionFile.hpp"
 #include "Game/World.hpp"
+#include "Game/Game.hpp"
 #include "Game/GameCommon.hpp"
 #include "Game/BlockDefinition.hpp"
 #include "ThirdParty/Squirrel/RawNoise.hpp"
@@ -11,8 +18,13 @@
 #include "Engine/Math/RandomNumberGenerator.hpp"
 #include "Engine/Core/FileUtils.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/Time.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Renderer/DebugRenderSystem.hpp"
+#include <algorithm>
+#include <atomic>
+#include <windows.h>
 
 
 //
@@ -22,7 +34,18 @@ Chunk::Chunk(IntVec2 chunkCoords, World* world)
 	: m_chunkCoords(chunkCoords)
 	, m_world(world)
 {
-	m_blocks = new Block[CHUNK_TOTAL_BLOCKS];
+	//chunk starts out as all air, so every section can share the same empty one until it gets written to
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		m_sections[sectionIndex] = ChunkSectionPool::GetEmptySection();
+		m_isSectionResident[sectionIndex] = true;
+	}
+
+	for (int columnIndex = 0; columnIndex < CHUNK_LAYER_SIZE; columnIndex++)
+	{
+		m_columnMinSolidZ[columnIndex] = CHUNK_SIZE_Z;
+		m_columnMaxSolidZ[columnIndex] = -1;
+	}
 	
 	float xMin = static_cast<float>(m_chunkCoords.x * CHUNK_SIZE_X);
 	float yMin = static_cast<float>(m_chunkCoords.y * CHUNK_SIZE_Y);
@@ -33,7 +56,6 @@ Chunk::Chunk(IntVec2 chunkCoords, World* world)
 	m_bounds = AABB3(xMin, yMin, zMin, xMax, yMax, zMax);
 
 	m_gpuMesh = g_theRenderer->CreateVertexBuffer(sizeof(Vertex_PCU));
-	m_cpuMesh.reserve(5000);
 }
 
 
@@ -45,30 +67,262 @@ Chunk::~Chunk()
 		m_gpuMesh = nullptr;
 	}
 
-	delete[] m_blocks;
+	//sections are released here, but any snapshot still pinning them keeps them alive until the job holding it is finished
 }
 
 
 //
 //public game flow functions
 //
-void Chunk::Update()
+void Chunk::Render() const
 {
-	bool allNeighborsPresent = (m_eastNeighbor != nullptr) && (m_westNeighbor != nullptr) && (m_northNeighbor != nullptr) && (m_southNeighbor != nullptr);
+	//setting renderer mode to opaque for now because transparent blocks (e.g. ice) look weird
+	g_theRenderer->SetBlendMode(BlendMode::OPAQUE);
+	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_BACK);
+	if (m_isMeshIndexed)
+	{
+		int numQuads = m_numMeshVerts / 4;
+		g_theRenderer->DrawIndexedVertexBuffer(m_gpuMesh, g_chunkQuadIndexBuffer, numQuads * 6);
+	}
+	else
+	{
+		g_theRenderer->DrawVertexBuffer(m_gpuMesh, m_numMeshVerts);
+	}
+}
+
 
-	if (m_areVertsDirty && allNeighborsPresent)
+//
+//public block accessors
+//
+Block const* Chunk::GetBlock(int blockIndex) const
+{
+	int sectionIndex = blockIndex >> CHUNK_SECTION_BITS;
+	if (m_sections[sectionIndex] == nullptr)
 	{
-		RebuildVertexes();
+		RestoreSection(sectionIndex);
 	}
+
+	ChunkSection const* section = m_sections[sectionIndex].get();
+
+	return &section->m_blocks[blockIndex & (CHUNK_SECTION_TOTAL_BLOCKS - 1)];
 }
 
 
-void Chunk::Render() const
+Block* Chunk::GetBlockForWrite(int blockIndex)
 {
-	//setting renderer mode to opaque for now because transparent blocks (e.g. ice) look weird
-	g_theRenderer->SetBlendMode(BlendMode::OPAQUE);
-	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_BACK);
-	g_theRenderer->DrawVertexBuffer(m_gpuMesh, static_cast<int>(m_cpuMesh.size()));
+	int sectionIndex = blockIndex >> CHUNK_SECTION_BITS;
+	if (m_sections[sectionIndex] == nullptr)
+	{
+		RestoreSection(sectionIndex);
+	}
+
+	std::shared_ptr<ChunkSection>& section = m_sections[sectionIndex];
+
+	//if a snapshot or the section pool is still holding this section, give the live chunk its own copy of just this section
+	//only the main thread hands out new references and other threads only ever drop theirs, so a stale count can only be too high (which just costs a copy), never too low
+	//use_count is a relaxed load though, so seeing one needs an acquire fence before writing, or a job's last reads of the section could still be in flight
+	if (section.use_count() > 1)
+	{
+		section = std::make_shared<ChunkSection>(*section);
+	}
+	else
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+
+	m_hasSectionChangedSinceSharing[sectionIndex] = true;
+	m_version++;
+
+	return &section->m_blocks[blockIndex & (CHUNK_SECTION_TOTAL_BLOCKS - 1)];
+}
+
+
+//
+//public snapshot functions
+//
+std::shared_ptr<ChunkSnapshot const> Chunk::TakeSnapshot()
+{
+	//chunks that were never activated have no lighting at all, which looks just like settled lighting
+	bool hasSettledLighting = m_state == ChunkState::ACTIVATED && !HasDirtyLighting();
+
+	//the mesh is only worth saving alongside settled lighting, since it has the lighting baked into its colors
+	bool hasBakedMesh = hasSettledLighting && m_isMeshBaked && !m_areVertsDirty;
+
+	//if nothing has changed since the last snapshot and someone is still holding it, just share that one
+	//(lighting settling and meshes finishing don't touch any blocks, so they don't bump the version and have to be checked on their own)
+	std::shared_ptr<ChunkSnapshot const> latestSnapshot = m_latestSnapshot.lock();
+	bool isLatestSnapshotCurrent = latestSnapshot != nullptr && m_latestSnapshotVersion == m_version && latestSnapshot->m_hasSettledLighting == hasSettledLighting && latestSnapshot->m_hasBakedMesh == hasBakedMesh;
+	isLatestSnapshotCurrent = isLatestSnapshotCurrent && (!hasBakedMesh || latestSnapshot->m_meshInputHash == m_meshInputHash) && latestSnapshot->m_isGeneratedBaselineKnown == m_isGeneratedBaselineKnown;
+	if (isLatestSnapshotCurrent)
+	{
+		return latestSnapshot;
+	}
+
+	std::shared_ptr<ChunkSnapshot> snapshot = std::make_shared<ChunkSnapshot>();
+	snapshot->m_chunkCoords = m_chunkCoords;
+	snapshot->m_worldSeed = m_world->m_worldSeed;
+	snapshot->m_version = m_version;
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		//snapshots are read off the main thread, so evicted sections have to be restored first
+		if (m_sections[sectionIndex] == nullptr)
+		{
+			RestoreSection(sectionIndex);
+		}
+
+		snapshot->m_sections[sectionIndex] = m_sections[sectionIndex];
+	}
+
+	snapshot->m_hasSettledLighting = hasSettledLighting;
+	snapshot->m_hasBakedMesh = hasBakedMesh;
+	if (snapshot->m_hasBakedMesh)
+	{
+		snapshot->m_meshInputHash = m_meshInputHash;
+		snapshot->m_meshFaces = m_meshFaces;
+	}
+
+	snapshot->m_isGeneratedBaselineKnown = m_isGeneratedBaselineKnown;
+	snapshot->m_generatedBlockTypes = m_generatedBlockTypes;
+
+	m_latestSnapshot = snapshot;
+	m_latestSnapshotVersion = m_version;
+
+	return snapshot;
+}
+
+
+std::shared_ptr<ChunkSnapshot const> Chunk::TakeSnapshotWithNeighbors()
+{
+	std::shared_ptr<ChunkSnapshot> snapshot = std::make_shared<ChunkSnapshot>(*TakeSnapshot());
+
+	if (m_eastNeighbor != nullptr) snapshot->m_eastNeighbor = m_eastNeighbor->TakeSnapshot();
+	if (m_westNeighbor != nullptr) snapshot->m_westNeighbor = m_westNeighbor->TakeSnapshot();
+	if (m_northNeighbor != nullptr) snapshot->m_northNeighbor = m_northNeighbor->TakeSnapshot();
+	if (m_southNeighbor != nullptr) snapshot->m_southNeighbor = m_southNeighbor->TakeSnapshot();
+
+	return snapshot;
+}
+
+
+std::shared_ptr<ChunkSnapshot const> Chunk::TakeMeshSnapshot()
+{
+	//a full snapshot would restore every evicted section of five chunks just to remesh one, so this only pins what a mesh build reads
+	bool isSectionMeshed[CHUNK_NUM_SECTIONS];
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		isSectionMeshed[sectionIndex] = m_sectionVisibleCounts[sectionIndex] > 0 && m_isSectionResident[sectionIndex];
+	}
+
+	auto pinSections = [](Chunk* chunk, ChunkSnapshot& snapshot, bool const* sectionsToPin)
+		{
+			snapshot.m_chunkCoords = chunk->m_chunkCoords;
+			snapshot.m_worldSeed = chunk->m_world->m_worldSeed;
+			snapshot.m_version = chunk->m_version;
+			for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+			{
+				if (!sectionsToPin[sectionIndex])
+				{
+					continue;
+				}
+
+				if (chunk->m_sections[sectionIndex] == nullptr)
+				{
+					chunk->RestoreSection(sectionIndex);
+				}
+				snapshot.m_sections[sectionIndex] = chunk->m_sections[sectionIndex];
+			}
+		};
+
+	//this chunk needs every resident section for the input hash, plus the sections above and below meshed ones for their top and bottom faces
+	bool sectionsToPin[CHUNK_NUM_SECTIONS];
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		bool isBelowMeshedSection = sectionIndex + 1 < CHUNK_NUM_SECTIONS && isSectionMeshed[sectionIndex + 1];
+		bool isAboveMeshedSection = sectionIndex > 0 && isSectionMeshed[sectionIndex - 1];
+		sectionsToPin[sectionIndex] = m_isSectionResident[sectionIndex] || isBelowMeshedSection || isAboveMeshedSection;
+	}
+
+	std::shared_ptr<ChunkSnapshot> snapshot = std::make_shared<ChunkSnapshot>();
+	pinSections(this, *snapshot, sectionsToPin);
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		snapshot->m_isSectionResident[sectionIndex] = m_isSectionResident[sectionIndex];
+		snapshot->m_sectionVisibleCounts[sectionIndex] = m_sectionVisibleCounts[sectionIndex];
+	}
+
+	//neighbors only need the sections right beside the meshed ones
+	Chunk* sideNeighbors[4] = { m_eastNeighbor, m_westNeighbor, m_northNeighbor, m_southNeighbor };
+	std::shared_ptr<ChunkSnapshot const>* neighborSnapshots[4] = { &snapshot->m_eastNeighbor, &snapshot->m_westNeighbor, &snapshot->m_northNeighbor, &snapshot->m_southNeighbor };
+	for (int neighborIndex = 0; neighborIndex < 4; neighborIndex++)
+	{
+		if (sideNeighbors[neighborIndex] == nullptr)
+		{
+			continue;
+		}
+
+		std::shared_ptr<ChunkSnapshot> neighborSnapshot = std::make_shared<ChunkSnapshot>();
+		pinSections(sideNeighbors[neighborIndex], *neighborSnapshot, isSectionMeshed);
+		*neighborSnapshots[neighborIndex] = neighborSnapshot;
+	}
+
+	return snapshot;
+}
+
+
+//
+//public mesh job functions
+//
+ChunkMeshJob* Chunk::CreateMeshJob()
+{
+	ChunkMeshJob* meshJob = new ChunkMeshJob(m_chunkCoords, TakeMeshSnapshot(), m_world->m_mesherType, m_world->m_useIndexedQuads, m_world->m_useBakedMeshes);
+
+	//a baked mesh from a save or the chunk cache goes along with the job, which checks it against the snapshot before building anything
+	if (m_hasCachedMesh)
+	{
+		meshJob->m_hasCachedMesh = true;
+		meshJob->m_cachedMeshInputHash = m_meshInputHash;
+		meshJob->m_cachedMeshFaces.swap(m_meshFaces);
+		m_hasCachedMesh = false;
+	}
+
+	//the faces this chunk has are about to be replaced, so they're not worth saving or caching until the job comes back
+	m_isMeshBaked = false;
+
+	return meshJob;
+}
+
+
+void Chunk::OnMeshJobCompleted(ChunkMeshJob* meshJob)
+{
+	//a build this chunk isn't waiting on was started by an earlier chunk at the same coords, before it was deactivated
+	if (meshJob != m_runningMeshJob)
+	{
+		return;
+	}
+	m_runningMeshJob = nullptr;
+
+	if (meshJob->m_hasCachedMesh)
+	{
+		m_world->m_numBakedMeshChecks++;
+		m_world->m_numBakedMeshHits += meshJob->m_didReuseCachedMesh ? 1 : 0;
+	}
+
+	m_meshFaces.swap(meshJob->m_meshFaces);
+	m_meshInputHash = meshJob->m_meshInputHash;
+	m_isMeshBaked = meshJob->m_useBakedMeshes;
+	m_isMeshIndexed = meshJob->m_useIndexedQuads;
+	m_numMeshVerts = static_cast<int>(meshJob->m_verts.size());
+	m_world->m_meshBuildSeconds += meshJob->m_buildSeconds;
+	m_world->m_numMeshesBuilt++;
+
+	//the upload is the only part of a mesh build that has to happen on the main thread (the verts go away with the job)
+	g_theRenderer->CopyCPUToGPU(meshJob->m_verts.data(), meshJob->m_verts.size() * sizeof(Vertex_PCU), m_gpuMesh);
+}
+
+
+bool Chunk::IsMeshJobRunning() const
+{
+	return m_runningMeshJob != nullptr;
 }
 
 
@@ -77,6 +331,10 @@ void Chunk::Render() const
 //
 void Chunk::PopulateBlocks()
 {
+	//generation itself isn't an edit, so stop tracking until it's done
+	m_isGeneratedBaselineKnown = false;
+	m_generatedBlockTypes.clear();
+
 	std::vector<BlockTemplateEntry> blockTemplateStartingPositions;
 
 	unsigned int currentSeed = 0;
@@ -174,7 +432,14 @@ void Chunk::PopulateBlocks()
 			}
 			int stoneHeightZ = terrainHeightZ - dirtDepth;
 
-			for (int localZ = 0; localZ < CHUNK_SIZE_Z; localZ++)
+			//nothing gets generated above the terrain (plus tree origins) or sea level, so don't bother looping through the sky
+			int generationMaxZ = (terrainHeightZ + 1 > SEA_LEVEL) ? terrainHeightZ + 1 : SEA_LEVEL;
+			if (generationMaxZ > CHUNK_MAX_Z)
+			{
+				generationMaxZ = CHUNK_MAX_Z;
+			}
+
+			for (int localZ = 0; localZ <= generationMaxZ; localZ++)
 			{
 				if (localX >= 0 && localX < CHUNK_SIZE_X && localY >= 0 && localY < CHUNK_SIZE_Y)
 				{
@@ -326,6 +591,7 @@ void Chunk::PopulateBlocks()
 		}
 	}
 
+	m_isGeneratedBaselineKnown = true;
 	m_needsSaving = false;	//we don't need to save if we just generated this chunk
 }
 
@@ -443,17 +709,29 @@ void Chunk::SetBlockType(int blockX, int blockY, int blockZ, std::string blockNa
 
 void Chunk::SetBlockType(int blockIndex, std::string blockName)
 {
-	m_blocks[blockIndex].m_blockType = static_cast<uint8_t>(BlockDefinition::GetBlockDefIDFromName(blockName));
-	SetVertsAsDirty();
-	m_needsSaving = true;
+	SetBlockType(blockIndex, static_cast<uint8_t>(BlockDefinition::GetBlockDefIDFromName(blockName)));
 }
 
 
 void Chunk::SetBlockType(int blockIndex, uint8_t blockDefID)
 {
-	m_blocks[blockIndex].m_blockType = blockDefID;
+	Block* block = GetBlockForWrite(blockIndex);
+	uint8_t previousBlockDefID = block->m_blockType;
+	block->m_blockType = blockDefID;
 	SetVertsAsDirty();
 	m_needsSaving = true;
+	m_queuedSaveTicket = 0;
+
+	if (previousBlockDefID != blockDefID)
+	{
+		UpdateSummaryForBlockChange(blockIndex, previousBlockDefID, blockDefID);
+
+		//only the first change to a block is its generated type
+		if (m_isGeneratedBaselineKnown)
+		{
+			m_generatedBlockTypes.emplace(blockIndex, previousBlockDefID);
+		}
+	}
 }
 
 
@@ -461,14 +739,18 @@ void Chunk::SetBlockIsSky(int blockX, int blockY, int blockZ)
 {
 	int blockIndex = blockX + (blockY << CHUNK_BITS_X) + (blockZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
 
-	m_blocks[blockIndex].SetIsSky(true);
+	//don't write (and un-share the section) if it's already sky
+	if (!GetBlock(blockIndex)->IsSky())
+	{
+		GetBlockForWrite(blockIndex)->SetIsSky(true);
+	}
 }
 
 
 std::string Chunk::GetBlockType(int blockX, int blockY, int blockZ) const
 {
 	int blockIndex = blockX + (blockY << CHUNK_BITS_X) + (blockZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
-	int blockDefIndex = m_blocks[blockIndex].m_blockType;
+	int blockDefIndex = GetBlock(blockIndex)->m_blockType;
 
 	return BlockDefinition::s_blockDefs[blockDefIndex].m_name;
 }
@@ -476,7 +758,7 @@ std::string Chunk::GetBlockType(int blockX, int blockY, int blockZ) const
 
 std::string Chunk::GetBlockType(int blockIndex) const
 {
-	int blockDefIndex = m_blocks[blockIndex].m_blockType;
+	int blockDefIndex = GetBlock(blockIndex)->m_blockType;
 
 	return BlockDefinition::s_blockDefs[blockDefIndex].m_name;
 }
@@ -492,7 +774,7 @@ bool Chunk::IsBlockOpaque(int blockX, int blockY, int blockZ) const
 
 bool Chunk::IsBlockOpaque(int blockIndex) const
 {
-	int blockDefIndex = m_blocks[blockIndex].m_blockType;
+	int blockDefIndex = GetBlock(blockIndex)->m_blockType;
 
 	return BlockDefinition::s_blockDefs[blockDefIndex].m_isOpaque;
 }
@@ -500,7 +782,7 @@ bool Chunk::IsBlockOpaque(int blockIndex) const
 
 int Chunk::GetBlockLightEmissionValue(int blockIndex) const
 {
-	int blockDefIndex = m_blocks[blockIndex].m_blockType;
+	int blockDefIndex = GetBlock(blockIndex)->m_blockType;
 
 	return BlockDefinition::s_blockDefs[blockDefIndex].m_lightEmissionValue;
 }
@@ -511,401 +793,1368 @@ bool Chunk::SaveChunk()
 	m_needsSaving = false;
 	
 	std::vector<uint8_t> chunkBuffer;
+	TakeSnapshot()->WriteSaveBuffer(chunkBuffer, m_world->m_saveCodec, m_world->m_useOverlaySaves);
 
-	//save header
-	chunkBuffer.emplace_back(static_cast<uint8_t>('G'));
-	chunkBuffer.emplace_back(static_cast<uint8_t>('C'));
-	chunkBuffer.emplace_back(static_cast<uint8_t>('H'));
-	chunkBuffer.emplace_back(static_cast<uint8_t>('K'));
-	chunkBuffer.emplace_back(static_cast<uint8_t>(3));
-	chunkBuffer.emplace_back(static_cast<uint8_t>(CHUNK_BITS_X));
-	chunkBuffer.emplace_back(static_cast<uint8_t>(CHUNK_BITS_Y));
-	chunkBuffer.emplace_back(static_cast<uint8_t>(CHUNK_BITS_Z));
-
-	//save world seed
-	uint8_t worldSeedByte1 = static_cast<uint8_t>(m_world->m_worldSeed >> 24);
-	uint8_t worldSeedByte2 = static_cast<uint8_t>(m_world->m_worldSeed >> 16);	//should automatically cut off higher bits
-	uint8_t worldSeedByte3 = static_cast<uint8_t>(m_world->m_worldSeed >> 8);
-	uint8_t worldSeedByte4 = static_cast<uint8_t>(m_world->m_worldSeed);
-
-	chunkBuffer.emplace_back(worldSeedByte4);
-	chunkBuffer.emplace_back(worldSeedByte3);
-	chunkBuffer.emplace_back(worldSeedByte2);
-	chunkBuffer.emplace_back(worldSeedByte1);
-
-	//save run length
-	uint8_t currentBlockType = 0;
-	uint8_t currentBlockRunLength = 0;
-	int totalRunLength = 0;
-	for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
-	{
-		Block& block = m_blocks[blockIndex];
-
-		//initialize current block type when starting out
-		if (blockIndex == 0)
-		{
-			currentBlockType = block.m_blockType;
-		}
-		else
-		{
-			//if block type changes, save out previous block type and run length
-			if (block.m_blockType != currentBlockType)
-			{
-				chunkBuffer.emplace_back(currentBlockType);
-				chunkBuffer.emplace_back(currentBlockRunLength);
-
-				currentBlockType = block.m_blockType;
-				currentBlockRunLength = 0;
-			}
-			else
-			{
-				//if at final block or if run length has reached 255, go ahead and save the run length
-				if (blockIndex == CHUNK_TOTAL_BLOCKS - 1 || currentBlockRunLength == 255)
-				{
-					chunkBuffer.emplace_back(currentBlockType);
-					chunkBuffer.emplace_back(currentBlockRunLength);
-
-					currentBlockRunLength = 0;
-				}
-			}
-		}
-
-		currentBlockRunLength++;
-		totalRunLength++;
-	}
-
-	if (totalRunLength != CHUNK_TOTAL_BLOCKS)
-	{
-		std::string errorText = Stringf("Chunk %i, %i didn't save enough data!", m_chunkCoords.x, m_chunkCoords.y);
-		ERROR_AND_DIE(errorText.c_str());
-	}
-
-
-	
-	std::string fileName = Stringf("Saves/World_%u/Chunk(%i,%i).chunk", m_world->m_worldSeed, m_chunkCoords.x, m_chunkCoords.y);
-
-	return FileWriteFromBuffer(chunkBuffer, fileName);
+	return m_world->WriteSavedChunk(m_chunkCoords, chunkBuffer, m_world->m_worldSeed);
 }
 
 
 void Chunk::LoadChunk()
 {
+	//decode straight out of the mapped region file when possible, otherwise fall back to reading into a buffer (which also imports old per-chunk saves)
+	std::shared_ptr<MappedFile> mappedFile;
+	uint8_t const* chunkData = nullptr;
+	size_t chunkDataSize = 0;
 	std::vector<uint8_t> chunkBuffer;
 
-	std::string fileName = Stringf("Saves/World_%u/Chunk(%i,%i).chunk", m_world->m_worldSeed, m_chunkCoords.x, m_chunkCoords.y);
+	if (!m_world->m_useMappedReads || !m_world->ReadSavedChunkMapped(m_chunkCoords, mappedFile, chunkData, chunkDataSize))
+	{
+		//if the save disappeared somehow, generate from scratch instead
+		if (!m_world->ReadSavedChunk(m_chunkCoords, chunkBuffer))
+		{
+			PopulateBlocks();
+			return;
+		}
 
-	FileReadToBuffer(chunkBuffer, fileName);
+		chunkData = chunkBuffer.data();
+		chunkDataSize = chunkBuffer.size();
+	}
 
-	//check header
-	if (chunkBuffer[0] != 'G' || chunkBuffer[1] != 'C' || chunkBuffer[2] != 'H' || chunkBuffer[3] != 'K')
+	//same goes for saves from a different seed, or ones that are damaged
+	std::string errorText;
+	ChunkDecodeResult decodeResult = DecodeSaveBuffer(chunkData, chunkDataSize, errorText);
+	if (decodeResult == ChunkDecodeResult::MALFORMED)
 	{
-		ERROR_AND_DIE("Chunk file missing 4CC!");
+		DebuggerPrintf("%s, regenerating it instead\n", errorText.c_str());
 	}
-	else if (chunkBuffer[4] != 3)
+	if (decodeResult == ChunkDecodeResult::GENERATOR_MISMATCH)
 	{
-		ERROR_AND_DIE("Chunk file version incorrect!");
+		DebuggerPrintf("Chunk %i, %i save was made with a different generator version, so its edits were replayed onto newly generated terrain\n", m_chunkCoords.x, m_chunkCoords.y);
 	}
-	else if (chunkBuffer[5] != CHUNK_BITS_X || chunkBuffer[6] != CHUNK_BITS_Y || chunkBuffer[7] != CHUNK_BITS_Z)
+	if (decodeResult != ChunkDecodeResult::SUCCESS && decodeResult != ChunkDecodeResult::GENERATOR_MISMATCH)
 	{
-		ERROR_AND_DIE("Chunk file specifies incorrect number of bits!");
+		PopulateBlocks();
 	}
+}
 
-	//check seed
-	unsigned int worldSeedByte1 = static_cast<unsigned int>(chunkBuffer[8]) << 24;
-	unsigned int worldSeedByte2 = static_cast<unsigned int>(chunkBuffer[9]) << 16;
-	unsigned int worldSeedByte3 = static_cast<unsigned int>(chunkBuffer[10]) << 8;
-	unsigned int worldSeedByte4 = static_cast<unsigned int>(chunkBuffer[11]);
-	unsigned int loadedWorldSeed = worldSeedByte4 | worldSeedByte3 | worldSeedByte2 | worldSeedByte1;
 
-	//if seed doesn't match, generate from scratch instead
-	if (loadedWorldSeed != m_world->m_worldSeed)
+bool Chunk::LoadChunkFromSnapshot(ChunkSnapshot const& snapshot)
+{
+	//a snapshot from another world's seed is never this chunk's, so leave the chunk untouched
+	if (snapshot.m_worldSeed != m_world->m_worldSeed)
 	{
-		PopulateBlocks();
-		return;
+		return false;
 	}
 
-	//load blocks
-	int blockIndex = 0;
-	int totalRunLength = 0;
+	BeginBulkFill();
 
-	for (int bufferIndex = 12; bufferIndex < chunkBuffer.size() - 1; bufferIndex = bufferIndex + 2)
+	int runStartIndex = 0;
+	uint8_t runBlockType = snapshot.GetBlockType(0);
+	for (int blockIndex = 1; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
 	{
-		uint8_t nextBlockType = chunkBuffer[bufferIndex];
-		uint8_t nextBlockRunLength = chunkBuffer[bufferIndex + 1];
-		totalRunLength += nextBlockRunLength;
-
-		if (totalRunLength > CHUNK_TOTAL_BLOCKS)
-		{
-			std::string errorText = Stringf("Chunk %i, %i save file has too much data!", m_chunkCoords.x, m_chunkCoords.y);
-			ERROR_AND_DIE(errorText.c_str());
-		}
-
-		for (int runIndex = 0; runIndex < nextBlockRunLength; runIndex++)
+		uint8_t blockType = snapshot.GetBlockType(blockIndex);
+		if (blockType != runBlockType)
 		{
-
-			SetBlockType(blockIndex, nextBlockType);
-			blockIndex++;
+			FillBlockRun(runStartIndex, blockIndex - runStartIndex, runBlockType);
+			runStartIndex = blockIndex;
+			runBlockType = blockType;
 		}
 	}
+	FillBlockRun(runStartIndex, CHUNK_TOTAL_BLOCKS - runStartIndex, runBlockType);
 
-	m_needsSaving = false;
-}
+	EndBulkFill();
 
+	m_isGeneratedBaselineKnown = snapshot.m_isGeneratedBaselineKnown;
+	m_generatedBlockTypes = snapshot.m_generatedBlockTypes;
 
-int Chunk::GetBlockIndexFromLocalCoords(int localX, int localY, int localZ) const
-{
-	return localX + (localY << CHUNK_BITS_X) + (localZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
-}
+	//keep the lighting too, as long as it was settled when the snapshot was taken
+	if (!snapshot.m_hasSettledLighting)
+	{
+		return true;
+	}
 
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		Block const* snapshotBlocks = snapshot.m_sections[sectionIndex]->m_blocks;
+		Block* blocks = GetBlockForWrite(sectionIndex << CHUNK_SECTION_BITS);
+		for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			blocks[blockIndex].m_lighting = snapshotBlocks[blockIndex].m_lighting;
+			blocks[blockIndex].m_bitFlags = snapshotBlocks[blockIndex].m_bitFlags & BLOCK_BIT_IS_SKY;
+		}
+	}
 
-Vec3 Chunk::GetChunkCenter() const
-{
-	return Vec3(m_bounds.m_mins.x + CHUNK_SIZE_X * 0.5f, m_bounds.m_mins.y + CHUNK_SIZE_Y * 0.5f, m_bounds.m_mins.z + CHUNK_SIZE_Z * 0.5f);
-}
+	m_hasCachedLighting = true;
 
+	if (snapshot.m_hasBakedMesh)
+	{
+		m_meshFaces = snapshot.m_meshFaces;
+		m_meshInputHash = snapshot.m_meshInputHash;
+		m_hasCachedMesh = true;
+	}
 
-void Chunk::SetVertsAsDirty()
-{
-	m_areVertsDirty = true;
+	return true;
 }
 
 
-//
-//private rendering functions
-//
-void Chunk::RebuildVertexes()
+ChunkDecodeResult Chunk::DecodeSaveBuffer(uint8_t const* chunkData, size_t chunkDataSize, std::string& out_errorText)
 {
-	m_cpuMesh.clear();
-	for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
+	//check header
+	if (chunkDataSize < CHUNK_SAVE_HEADER_SIZE)
 	{
-		AddVertsForBlock(m_cpuMesh, blockIndex);
+		out_errorText = Stringf("Chunk %i, %i save is too short to have a header (%i bytes)", m_chunkCoords.x, m_chunkCoords.y, static_cast<int>(chunkDataSize));
+		return ChunkDecodeResult::MALFORMED;
+	}
+	if (chunkData[0] != 'G' || chunkData[1] != 'C' || chunkData[2] != 'H' || chunkData[3] != 'K')
+	{
+		out_errorText = Stringf("Chunk %i, %i save is missing its 4CC", m_chunkCoords.x, m_chunkCoords.y);
+		return ChunkDecodeResult::MALFORMED;
+	}
+	uint8_t codecVersion = chunkData[4] & ~(CHUNK_SAVE_LIGHTING_FLAG | CHUNK_SAVE_MESH_FLAG);
+	bool isOverlaySave = codecVersion == CHUNK_SAVE_OVERLAY_VERSION;
+	if (!isOverlaySave && !ChunkCodec::IsSupportedVersion(codecVersion))
+	{
+		out_errorText = Stringf("Chunk %i, %i save has unsupported version %i", m_chunkCoords.x, m_chunkCoords.y, static_cast<int>(chunkData[4]));
+		return ChunkDecodeResult::MALFORMED;
+	}
+	if (chunkData[5] != CHUNK_BITS_X || chunkData[6] != CHUNK_BITS_Y || chunkData[7] != CHUNK_BITS_Z)
+	{
+		out_errorText = Stringf("Chunk %i, %i save specifies incorrect number of bits (%i, %i, %i)", m_chunkCoords.x, m_chunkCoords.y, static_cast<int>(chunkData[5]), static_cast<int>(chunkData[6]), static_cast<int>(chunkData[7]));
+		return ChunkDecodeResult::MALFORMED;
 	}
 
-	g_theRenderer->CopyCPUToGPU(m_cpuMesh.data(), m_cpuMesh.size() * sizeof(Vertex_PCU), m_gpuMesh);
-
-	m_areVertsDirty = false;
-}
-
-
-void Chunk::AddVertsForBlock(std::vector<Vertex_PCU>& verts, int blockIndex)
-{
-	BlockDefinition const* blockDef = BlockDefinition::GetBlockDefFromID(m_blocks[blockIndex].m_blockType);
-	if (!blockDef->m_isVisible)
+	//check seed (written lowest byte first)
+	unsigned int loadedWorldSeed = static_cast<unsigned int>(chunkData[8]) | (static_cast<unsigned int>(chunkData[9]) << 8) | (static_cast<unsigned int>(chunkData[10]) << 16) | (static_cast<unsigned int>(chunkData[11]) << 24);
+	if (loadedWorldSeed != m_world->m_worldSeed)
 	{
-		return;
+		return ChunkDecodeResult::SEED_MISMATCH;
 	}
-	
-	int localX = blockIndex & (CHUNK_SIZE_X - 1);
-	int localY = (blockIndex >> CHUNK_BITS_X) & (CHUNK_SIZE_Y - 1);
-	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
 
-	float globalXMin = static_cast<float>(localX + (m_chunkCoords.x * CHUNK_SIZE_X));
-	float globalYMin = static_cast<float>(localY + (m_chunkCoords.y * CHUNK_SIZE_Y));
-	float globalZMin = static_cast<float>(localZ);
-	float globalXMax = globalXMin + 1.0f;
-	float globalYMax = globalYMin + 1.0f;
-	float globalZMax = globalZMin + 1.0f;
-
-	AABB2 topUVs = g_worldSpriteSheet->GetSpriteUVs(blockDef->m_topSpriteIndex);
-	AABB2 sideUVs = g_worldSpriteSheet->GetSpriteUVs(blockDef->m_sideSpriteIndex);
-	AABB2 bottomUVs = g_worldSpriteSheet->GetSpriteUVs(blockDef->m_bottomSpriteIndex);
-
-	Vec3 bottomLeftBack = Vec3(globalXMin, globalYMax, globalZMin);
-	Vec3 bottomRightBack = Vec3(globalXMin, globalYMin, globalZMin);
-	Vec3 topLeftBack = Vec3(globalXMin, globalYMax, globalZMax);
-	Vec3 topRightBack = Vec3(globalXMin, globalYMin, globalZMax);
-	Vec3 bottomLeftFront = Vec3(globalXMax, globalYMax, globalZMin);
-	Vec3 bottomRightFront = Vec3(globalXMax, globalYMin, globalZMin);
-	Vec3 topLeftFront = Vec3(globalXMax, globalYMax, globalZMax);
-	Vec3 topRightFront = Vec3(globalXMax, globalYMin, globalZMax);
-
-	bool drawWestFace = true;
-	bool drawEastFace = true;
-	bool drawSouthFace = true;
-	bool drawNorthFace = true;
-	bool drawDownwardFace = true;
-	bool drawSkywardFace = true;
-
-	BlockIterator thisBlock = BlockIterator(blockIndex, this);
-	BlockIterator eastNeighbor = thisBlock.GetEastNeighbor();
-	BlockIterator westNeighbor = thisBlock.GetWestNeighbor();
-	BlockIterator northNeighbor = thisBlock.GetNorthNeighbor();
-	BlockIterator southNeighbor = thisBlock.GetSouthNeighbor();
-	BlockIterator skywardNeighbor = thisBlock.GetSkywardNeighbor();
-	BlockIterator downwardNeighbor = thisBlock.GetDownwardNeighbor();
-
-	if (g_enableHiddenSurfaceRemoval)	//only bother with checking surrounding blocks if hidden surface removal is turned on
-	{
-		//check west (-x) block
-		if (westNeighbor.GetChunk() != nullptr)
-		{
-			BlockDefinition const* westBlockDef = BlockDefinition::GetBlockDefFromID(westNeighbor.GetBlock()->m_blockType);
-			if (westBlockDef->m_isOpaque)
-			{
-				drawWestFace = false;
-			}
-		}
+	//read the lighting section if there is one: stamp, then palette-encoded lighting and sky flags, each with a size in front
+	size_t readIndex = CHUNK_SAVE_HEADER_SIZE;
+	std::vector<BlockRun> lightingRuns;
+	std::vector<BlockRun> skyRuns;
+	bool isSavedLightingValid = false;
 
-		//check east (+x) block
-		if (eastNeighbor.GetChunk() != nullptr)
+	auto readUint32 = [chunkData, chunkDataSize, &readIndex](uint32_t& out_value)
 		{
-			BlockDefinition const* eastBlockDef = BlockDefinition::GetBlockDefFromID(eastNeighbor.GetBlock()->m_blockType);
-			if (eastBlockDef->m_isOpaque)
+			if (chunkDataSize - readIndex < 4)
 			{
-				drawEastFace = false;
+				return false;
 			}
-		}
+			out_value = static_cast<uint32_t>(chunkData[readIndex]) | (static_cast<uint32_t>(chunkData[readIndex + 1]) << 8) | (static_cast<uint32_t>(chunkData[readIndex + 2]) << 16) | (static_cast<uint32_t>(chunkData[readIndex + 3]) << 24);
+			readIndex += 4;
+			return true;
+		};
+
+	if ((chunkData[4] & CHUNK_SAVE_LIGHTING_FLAG) != 0)
+	{
+		uint32_t lightingStamp = 0;
+		uint32_t lightingDataSize = 0;
+		uint32_t skyDataSize = 0;
+		std::string lightingErrorText;
+
+		bool didReadLighting = readUint32(lightingStamp) && readUint32(lightingDataSize) && lightingDataSize <= chunkDataSize - readIndex;
+		didReadLighting = didReadLighting && ChunkCodec::DecodeBlockRuns(static_cast<uint8_t>(ChunkCodecType::PALETTE_RLE), chunkData + readIndex, lightingDataSize, CHUNK_TOTAL_BLOCKS, lightingRuns, lightingErrorText);
+		readIndex += didReadLighting ? lightingDataSize : 0;
 
-		//check south (-y) block
-		if (southNeighbor.GetChunk() != nullptr)
+		didReadLighting = didReadLighting && readUint32(skyDataSize) && skyDataSize <= chunkDataSize - readIndex;
+		didReadLighting = didReadLighting && ChunkCodec::DecodeBlockRuns(static_cast<uint8_t>(ChunkCodecType::PALETTE_RLE), chunkData + readIndex, skyDataSize, CHUNK_TOTAL_BLOCKS, skyRuns, lightingErrorText);
+		readIndex += didReadLighting ? skyDataSize : 0;
+
+		if (!didReadLighting)
 		{
-			BlockDefinition const* southBlockDef = BlockDefinition::GetBlockDefFromID(southNeighbor.GetBlock()->m_blockType);
-			if (southBlockDef->m_isOpaque)
-			{
-				drawSouthFace = false;
-			}
+			out_errorText = Stringf("Chunk %i, %i save has a damaged lighting section (%s)", m_chunkCoords.x, m_chunkCoords.y, lightingErrorText.empty() ? "bad size" : lightingErrorText.c_str());
+			return ChunkDecodeResult::MALFORMED;
 		}
 
-		//check north (+y) block
-		if (northNeighbor.GetChunk() != nullptr)
+		//lighting made with different rules or block definitions just gets redone on activation
+		isSavedLightingValid = lightingStamp == GetLightingStamp();
+	}
+
+	//read the baked mesh section if there is one: stamp, input hash, then the encoded faces with a size in front
+	std::vector<ChunkMeshFace> meshFaces;
+	uint64_t meshInputHash = 0;
+	bool isSavedMeshValid = false;
+	if ((chunkData[4] & CHUNK_SAVE_MESH_FLAG) != 0)
+	{
+		uint32_t meshStamp = 0;
+		uint32_t meshInputHashLow = 0;
+		uint32_t meshInputHashHigh = 0;
+		uint32_t meshDataSize = 0;
+		std::string meshErrorText;
+
+		bool didReadMesh = readUint32(meshStamp) && readUint32(meshInputHashLow) && readUint32(meshInputHashHigh);
+		didReadMesh = didReadMesh && readUint32(meshDataSize) && meshDataSize <= chunkDataSize - readIndex;
+		didReadMesh = didReadMesh && ChunkCodec::DecodeMeshFaces(chunkData + readIndex, meshDataSize, CHUNK_TOTAL_BLOCKS, meshFaces, meshErrorText);
+		readIndex += didReadMesh ? meshDataSize : 0;
+
+		if (!didReadMesh)
 		{
-			BlockDefinition const* northBlockDef = BlockDefinition::GetBlockDefFromID(northNeighbor.GetBlock()->m_blockType);
-			if (northBlockDef->m_isOpaque)
-			{
-				drawNorthFace = false;
-			}
+			out_errorText = Stringf("Chunk %i, %i save has a damaged mesh section (%s)", m_chunkCoords.x, m_chunkCoords.y, meshErrorText.empty() ? "bad size" : meshErrorText.c_str());
+			return ChunkDecodeResult::MALFORMED;
 		}
 
-		//check downward (-z) block
-		if (downwardNeighbor.GetChunk() != nullptr)
+		//the mesh has the saved lighting baked into it, so it's no use without that lighting
+		meshInputHash = static_cast<uint64_t>(meshInputHashLow) | (static_cast<uint64_t>(meshInputHashHigh) << 32);
+		isSavedMeshValid = isSavedLightingValid && meshStamp == GetMeshStamp();
+	}
+
+	//overlay saves are just the generator version and a list of edits to replay on top of a freshly generated chunk
+	std::vector<BlockEdit> blockEdits;
+	std::string codecErrorText;
+	int numBlockDefs = static_cast<int>(BlockDefinition::s_blockDefs.size());
+	bool isGeneratorMismatch = false;
+	if (isOverlaySave)
+	{
+		uint32_t generatorVersion = 0;
+		if (!readUint32(generatorVersion))
+		{
+			out_errorText = Stringf("Chunk %i, %i save is missing its generator version", m_chunkCoords.x, m_chunkCoords.y);
+			return ChunkDecodeResult::MALFORMED;
+		}
+		if (!ChunkCodec::DecodeBlockEdits(chunkData + readIndex, chunkDataSize - readIndex, CHUNK_TOTAL_BLOCKS, blockEdits, codecErrorText))
+		{
+			out_errorText = Stringf("Chunk %i, %i save %s", m_chunkCoords.x, m_chunkCoords.y, codecErrorText.c_str());
+			return ChunkDecodeResult::MALFORMED;
+		}
+		for (int editIndex = 0; editIndex < static_cast<int>(blockEdits.size()); editIndex++)
 		{
-			BlockDefinition const* downwardBlockDef = BlockDefinition::GetBlockDefFromID(downwardNeighbor.GetBlock()->m_blockType);
-			if (downwardBlockDef->m_isOpaque)
+			if (blockEdits[editIndex].m_blockType >= numBlockDefs)
 			{
-				drawDownwardFace = false;
+				out_errorText = Stringf("Chunk %i, %i save has unknown block type %i", m_chunkCoords.x, m_chunkCoords.y, static_cast<int>(blockEdits[editIndex].m_blockType));
+				return ChunkDecodeResult::MALFORMED;
 			}
 		}
 
-		//check skyward (+z) block
-		if (skywardNeighbor.GetChunk() != nullptr)
+		//the edits still get replayed onto whatever the current generator makes, rather than losing them, but lighting and meshes baked from the old terrain are no use
+		if (generatorVersion != GetGeneratorStamp())
 		{
-			BlockDefinition const* skywardBlockDef = BlockDefinition::GetBlockDefFromID(skywardNeighbor.GetBlock()->m_blockType);
-			if (skywardBlockDef->m_isOpaque)
-			{
-				drawSkywardFace = false;
-			}
+			isGeneratorMismatch = true;
+			isSavedLightingValid = false;
+			isSavedMeshValid = false;
 		}
 	}
 
-	//get light values of surrounding blocks
-	unsigned char westOutdoorLightValue = 0;
-	unsigned char westIndoorLightValue = 0;
-	unsigned char eastOutdoorLightValue = 0;
-	unsigned char eastIndoorLightValue = 0;
-	unsigned char northOutdoorLightValue = 0;
-	unsigned char northIndoorLightValue = 0;
-	unsigned char southOutdoorLightValue = 0;
-	unsigned char southIndoorLightValue = 0;
-	unsigned char skywardOutdoorLightValue = 0;
-	unsigned char skywardIndoorLightValue = 0;
-	unsigned char downwardOutdoorLightValue = 0;
-	unsigned char downwardIndoorLightValue = 0;
-
-	if (eastNeighbor.GetChunk() != nullptr && drawEastFace)
+	//decode into runs with whichever codec wrote the save
+	std::vector<BlockRun> blockRuns;
+	if (!isOverlaySave && !ChunkCodec::DecodeBlockRuns(codecVersion, chunkData + readIndex, chunkDataSize - readIndex, CHUNK_TOTAL_BLOCKS, blockRuns, codecErrorText))
 	{
-		eastOutdoorLightValue = eastNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float eastOutdoorLightValueNormalized = NormalizeByte(eastOutdoorLightValue);
-		eastOutdoorLightValueNormalized = RangeMapClamped(eastOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		eastOutdoorLightValue = DenormalizeByte(eastOutdoorLightValueNormalized);
-
-		eastIndoorLightValue = eastNeighbor.GetBlock()->GetIndoorLightLevel();
-		float eastIndoorLightValueNormalized = NormalizeByte(eastIndoorLightValue);
-		eastIndoorLightValueNormalized = RangeMapClamped(eastIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		eastIndoorLightValue = DenormalizeByte(eastIndoorLightValueNormalized);
+		out_errorText = Stringf("Chunk %i, %i save %s", m_chunkCoords.x, m_chunkCoords.y, codecErrorText.c_str());
+		return ChunkDecodeResult::MALFORMED;
 	}
-	if (westNeighbor.GetChunk() != nullptr && drawWestFace)
-	{
-		westOutdoorLightValue = westNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float westOutdoorLightValueNormalized = NormalizeByte(westOutdoorLightValue);
-		westOutdoorLightValueNormalized = RangeMapClamped(westOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		westOutdoorLightValue = DenormalizeByte(westOutdoorLightValueNormalized);
 
-		westIndoorLightValue = westNeighbor.GetBlock()->GetIndoorLightLevel();
-		float westIndoorLightValueNormalized = NormalizeByte(westIndoorLightValue);
-		westIndoorLightValueNormalized = RangeMapClamped(westIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		westIndoorLightValue = DenormalizeByte(westIndoorLightValueNormalized);
-	}
-	if (northNeighbor.GetChunk() != nullptr && drawNorthFace)
+	//check every run before touching any blocks, so a bad save leaves the chunk untouched
+	int totalRunLength = 0;
+	for (int runIndex = 0; runIndex < static_cast<int>(blockRuns.size()); runIndex++)
 	{
-		northOutdoorLightValue = northNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float northOutdoorLightValueNormalized = NormalizeByte(northOutdoorLightValue);
-		northOutdoorLightValueNormalized = RangeMapClamped(northOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		northOutdoorLightValue = DenormalizeByte(northOutdoorLightValueNormalized);
+		if (blockRuns[runIndex].m_blockType >= numBlockDefs)
+		{
+			out_errorText = Stringf("Chunk %i, %i save has unknown block type %i", m_chunkCoords.x, m_chunkCoords.y, static_cast<int>(blockRuns[runIndex].m_blockType));
+			return ChunkDecodeResult::MALFORMED;
+		}
 
-		northIndoorLightValue = northNeighbor.GetBlock()->GetIndoorLightLevel();
-		float northIndoorLightValueNormalized = NormalizeByte(northIndoorLightValue);
-		northIndoorLightValueNormalized = RangeMapClamped(northIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		northIndoorLightValue = DenormalizeByte(northIndoorLightValueNormalized);
+		totalRunLength += blockRuns[runIndex].m_length;
+		if (totalRunLength > CHUNK_TOTAL_BLOCKS)
+		{
+			out_errorText = Stringf("Chunk %i, %i save has too much data", m_chunkCoords.x, m_chunkCoords.y);
+			return ChunkDecodeResult::MALFORMED;
+		}
 	}
-	if (southNeighbor.GetChunk() != nullptr && drawSouthFace)
-	{
-		southOutdoorLightValue = southNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float southOutdoorLightValueNormalized = NormalizeByte(southOutdoorLightValue);
-		southOutdoorLightValueNormalized = RangeMapClamped(southOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		southOutdoorLightValue = DenormalizeByte(southOutdoorLightValueNormalized);
 
-		southIndoorLightValue = southNeighbor.GetBlock()->GetIndoorLightLevel();
-		float southIndoorLightValueNormalized = NormalizeByte(southIndoorLightValue);
-		southIndoorLightValueNormalized = RangeMapClamped(southIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		southIndoorLightValue = DenormalizeByte(southIndoorLightValueNormalized);
-	}
-	if (skywardNeighbor.GetChunk() != nullptr && drawSkywardFace)
+	//only overlay saves get to leave blocks out, so a full save that stops early was cut short somewhere
+	if (!isOverlaySave && totalRunLength != CHUNK_TOTAL_BLOCKS)
 	{
-		skywardOutdoorLightValue = skywardNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float skywardOutdoorLightValueNormalized = NormalizeByte(skywardOutdoorLightValue);
-		skywardOutdoorLightValueNormalized = RangeMapClamped(skywardOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		skywardOutdoorLightValue = DenormalizeByte(skywardOutdoorLightValueNormalized);
-
-		skywardIndoorLightValue = skywardNeighbor.GetBlock()->GetIndoorLightLevel();
-		float skywardIndoorLightValueNormalized = NormalizeByte(skywardIndoorLightValue);
-		skywardIndoorLightValueNormalized = RangeMapClamped(skywardIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		skywardIndoorLightValue = DenormalizeByte(skywardIndoorLightValueNormalized);
+		out_errorText = Stringf("Chunk %i, %i save only covers %i of %i blocks", m_chunkCoords.x, m_chunkCoords.y, totalRunLength, CHUNK_TOTAL_BLOCKS);
+		return ChunkDecodeResult::MALFORMED;
 	}
-	if (downwardNeighbor.GetChunk() != nullptr && drawDownwardFace)
-	{
-		downwardOutdoorLightValue = downwardNeighbor.GetBlock()->GetOutdoorLightLevel();
-		float downwardOutdoorLightValueNormalized = NormalizeByte(downwardOutdoorLightValue);
-		downwardOutdoorLightValueNormalized = RangeMapClamped(downwardOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		downwardOutdoorLightValue = DenormalizeByte(downwardOutdoorLightValueNormalized);
 
-		downwardIndoorLightValue = downwardNeighbor.GetBlock()->GetIndoorLightLevel();
-		float downwardIndoorLightValueNormalized = NormalizeByte(downwardIndoorLightValue);
-		downwardIndoorLightValueNormalized = RangeMapClamped(downwardIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
-		downwardIndoorLightValue = DenormalizeByte(downwardIndoorLightValueNormalized);
-	}
-	
-	if (drawEastFace)
+	//lighting has to cover every block exactly to be usable
+	if (isSavedLightingValid)
+	{
+		int totalLightingRunLength = 0;
+		for (int runIndex = 0; runIndex < static_cast<int>(lightingRuns.size()); runIndex++)
+		{
+			totalLightingRunLength += lightingRuns[runIndex].m_length;
+		}
+		int totalSkyRunLength = 0;
+		for (int runIndex = 0; runIndex < static_cast<int>(skyRuns.size()); runIndex++)
+		{
+			totalSkyRunLength += skyRuns[runIndex].m_length;
+		}
+
+		if (totalLightingRunLength != CHUNK_TOTAL_BLOCKS || totalSkyRunLength != CHUNK_TOTAL_BLOCKS)
+		{
+			out_errorText = Stringf("Chunk %i, %i save has lighting for %i blocks and sky flags for %i", m_chunkCoords.x, m_chunkCoords.y, totalLightingRunLength, totalSkyRunLength);
+			return ChunkDecodeResult::MALFORMED;
+		}
+	}
+
+	//fill whole runs straight into block storage
+	BeginBulkFill();
+
+	int blockIndex = 0;
+	for (int runIndex = 0; runIndex < static_cast<int>(blockRuns.size()); runIndex++)
+	{
+		FillBlockRun(blockIndex, blockRuns[runIndex].m_length, blockRuns[runIndex].m_blockType);
+		blockIndex += blockRuns[runIndex].m_length;
+	}
+
+	//or regenerate and replay the edits, which also records the generated types so the next save can be an overlay again
+	if (isOverlaySave)
+	{
+		PopulateBlocks();
+		for (int editIndex = 0; editIndex < static_cast<int>(blockEdits.size()); editIndex++)
+		{
+			SetBlockType(blockEdits[editIndex].m_blockIndex, blockEdits[editIndex].m_blockType);
+		}
+	}
+
+	if (isSavedLightingValid)
+	{
+		blockIndex = 0;
+		for (int runIndex = 0; runIndex < static_cast<int>(lightingRuns.size()); runIndex++)
+		{
+			FillLightingRun(blockIndex, lightingRuns[runIndex].m_length, lightingRuns[runIndex].m_blockType);
+			blockIndex += lightingRuns[runIndex].m_length;
+		}
+
+		blockIndex = 0;
+		for (int runIndex = 0; runIndex < static_cast<int>(skyRuns.size()); runIndex++)
+		{
+			if (skyRuns[runIndex].m_blockType != 0)
+			{
+				FillSkyRun(blockIndex, skyRuns[runIndex].m_length);
+			}
+			blockIndex += skyRuns[runIndex].m_length;
+		}
+
+		m_hasCachedLighting = true;
+	}
+
+	if (isSavedMeshValid)
+	{
+		m_meshFaces.swap(meshFaces);
+		m_meshInputHash = meshInputHash;
+		m_hasCachedMesh = true;
+	}
+
+	EndBulkFill();
+
+	//resave it against the current generator, so the replayed edits are what's on disk from now on
+	if (isGeneratorMismatch)
+	{
+		m_needsSaving = true;
+		return ChunkDecodeResult::GENERATOR_MISMATCH;
+	}
+
+	return ChunkDecodeResult::SUCCESS;
+}
+
+
+int Chunk::GetBlockIndexFromLocalCoords(int localX, int localY, int localZ)
+{
+	return localX + (localY << CHUNK_BITS_X) + (localZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
+}
+
+
+int Chunk::GetNumMeshVerts() const
+{
+	return m_numMeshVerts;
+}
+
+
+Vec3 Chunk::GetChunkCenter() const
+{
+	return Vec3(m_bounds.m_mins.x + CHUNK_SIZE_X * 0.5f, m_bounds.m_mins.y + CHUNK_SIZE_Y * 0.5f, m_bounds.m_mins.z + CHUNK_SIZE_Z * 0.5f);
+}
+
+
+void Chunk::SetVertsAsDirty()
+{
+	m_areVertsDirty = true;
+}
+
+
+//
+//public section sharing functions
+//
+void Chunk::ShareIdenticalSections()
+{
+	//swap any sections that changed since last time for their pooled copies, so identical sections across chunks only exist once
+	//shouldn't be called while any blocks in the chunk have dirty lighting, since the dirty flag would end up shared with other chunks
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		if (m_hasSectionChangedSinceSharing[sectionIndex] && m_sections[sectionIndex] != nullptr)
+		{
+			m_sections[sectionIndex] = ChunkSectionPool::GetSharedSection(m_sections[sectionIndex]);
+			m_hasSectionChangedSinceSharing[sectionIndex] = false;
+		}
+	}
+}
+
+
+void Chunk::ShareOpenSkySections()
+{
+	//sections entirely above the highest non-air block are nothing but sky, so they can all point at the pooled open sky section
+	//instead of having sky flags and outdoor light set block by block
+	//(sections that came back with indoor light spilling up into them, from a torch near the surface, are left alone, since nothing would relight them)
+	int firstOpenSkySection = (m_highestNonAirZ >> CHUNK_SECTION_BITS_Z) + 1;
+	for (int sectionIndex = firstOpenSkySection; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		if (HasIndoorLightInSection(sectionIndex))
+		{
+			continue;
+		}
+
+		m_sections[sectionIndex] = ChunkSectionPool::GetOpenSkySection();
+		m_evictedSectionData[sectionIndex].clear();
+		m_hasSectionChangedSinceSharing[sectionIndex] = false;
+	}
+
+	m_version++;
+}
+
+
+bool Chunk::HasIndoorLightInSection(int sectionIndex) const
+{
+	if (m_sections[sectionIndex] == nullptr)
+	{
+		RestoreSection(sectionIndex);
+	}
+
+	Block const* blocks = m_sections[sectionIndex]->m_blocks;
+	for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+	{
+		if (blocks[blockIndex].GetIndoorLightLevel() > 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//
+//public section residency functions
+//
+IntVec3 Chunk::GetSectionCoords(int sectionIndex) const
+{
+	return IntVec3(m_chunkCoords.x, m_chunkCoords.y, sectionIndex);
+}
+
+
+AABB3 Chunk::GetSectionBounds(int sectionIndex) const
+{
+	IntVec3 sectionCoords = GetSectionCoords(sectionIndex);
+
+	float xMin = static_cast<float>(sectionCoords.x * CHUNK_SIZE_X);
+	float yMin = static_cast<float>(sectionCoords.y * CHUNK_SIZE_Y);
+	float zMin = static_cast<float>(sectionCoords.z * CHUNK_SECTION_SIZE_Z);
+
+	return AABB3(xMin, yMin, zMin, xMin + static_cast<float>(CHUNK_SIZE_X), yMin + static_cast<float>(CHUNK_SIZE_Y), zMin + static_cast<float>(CHUNK_SECTION_SIZE_Z));
+}
+
+
+void Chunk::SetSectionResident(int sectionIndex, bool isResident)
+{
+	if (m_isSectionResident[sectionIndex] == isResident)
+	{
+		return;
+	}
+
+	m_isSectionResident[sectionIndex] = isResident;
+
+	if (isResident)
+	{
+		if (m_sections[sectionIndex] == nullptr)
+		{
+			RestoreSection(sectionIndex);
+		}
+	}
+	else
+	{
+		EvictSection(sectionIndex);
+	}
+
+	//non-resident sections aren't meshed, so the mesh only needs rebuilding if there was something to draw
+	if (m_sectionVisibleCounts[sectionIndex] > 0)
+	{
+		SetVertsAsDirty();
+	}
+}
+
+
+bool Chunk::IsSectionResident(int sectionIndex) const
+{
+	return m_isSectionResident[sectionIndex];
+}
+
+
+bool Chunk::IsSectionEvicted(int sectionIndex) const
+{
+	return m_sections[sectionIndex] == nullptr;
+}
+
+
+void Chunk::EvictNonResidentSection(int sectionIndex)
+{
+	//no mesh rebuild needed, since the section already stopped being meshed when it went non-resident
+	if (m_isSectionResident[sectionIndex] || m_sections[sectionIndex] == nullptr)
+	{
+		return;
+	}
+
+	EvictSection(sectionIndex);
+}
+
+
+//
+//public lighting functions
+//
+bool Chunk::HasDirtyLighting() const
+{
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		//check evicted sections without decompressing them (bit flags are the last byte of each run)
+		if (m_sections[sectionIndex] == nullptr)
+		{
+			std::vector<uint8_t> const& evictedData = m_evictedSectionData[sectionIndex];
+			for (int dataIndex = 3; dataIndex < evictedData.size(); dataIndex += 4)
+			{
+				if ((evictedData[dataIndex] & BLOCK_BIT_IS_LIGHT_DIRTY) == BLOCK_BIT_IS_LIGHT_DIRTY)
+				{
+					return true;
+				}
+			}
+
+			continue;
+		}
+
+		Block const* blocks = m_sections[sectionIndex]->m_blocks;
+		for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			if (blocks[blockIndex].IsLightDirty())
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+//
+//public summary functions
+//
+void Chunk::RebuildSummary()
+{
+	for (int columnIndex = 0; columnIndex < CHUNK_LAYER_SIZE; columnIndex++)
+	{
+		m_columnMinSolidZ[columnIndex] = CHUNK_SIZE_Z;
+		m_columnMaxSolidZ[columnIndex] = -1;
+	}
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		m_sectionNonAirCounts[sectionIndex] = 0;
+		m_sectionOpaqueCounts[sectionIndex] = 0;
+		m_sectionVisibleCounts[sectionIndex] = 0;
+	}
+	m_highestNonAirZ = -1;
+	m_numOpaqueBlocks = 0;
+	m_numVisibleBlocks = 0;
+	m_lightEmitterIndices.clear();
+
+	//treat every block as if it had just been changed from air
+	for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
+	{
+		uint8_t blockDefID = GetBlock(blockIndex)->m_blockType;
+		if (blockDefID != 0)
+		{
+			UpdateSummaryForBlockChange(blockIndex, 0, blockDefID);
+		}
+	}
+}
+
+
+bool Chunk::CouldBlockBeSolid(int blockIndex) const
+{
+	int columnIndex = blockIndex & (CHUNK_LAYER_SIZE - 1);
+	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+
+	return localZ >= m_columnMinSolidZ[columnIndex] && localZ <= m_columnMaxSolidZ[columnIndex];
+}
+
+
+//
+//static save utilities
+//
+uint32_t Chunk::GetLightingStamp()
+{
+	//saved lighting is only trusted if it was made with the same lighting rules and the same light-related block definitions
+	static uint32_t const s_lightingStamp = []()
+		{
+			uint32_t stamp = 2166136261u;
+			auto addToStamp = [&stamp](uint32_t value)
+				{
+					stamp = (stamp ^ value) * 16777619u;
+				};
+
+			addToStamp(CHUNK_LIGHTING_VERSION);
+			addToStamp(static_cast<uint32_t>(BlockDefinition::s_blockDefs.size()));
+			for (int blockDefIndex = 0; blockDefIndex < static_cast<int>(BlockDefinition::s_blockDefs.size()); blockDefIndex++)
+			{
+				addToStamp(static_cast<uint32_t>(BlockDefinition::s_blockDefs[blockDefIndex].m_isOpaque));
+				addToStamp(static_cast<uint32_t>(BlockDefinition::s_blockDefs[blockDefIndex].m_lightEmissionValue));
+			}
+
+			return stamp;
+		}();
+
+	return s_lightingStamp;
+}
+
+
+uint32_t Chunk::GetMeshStamp()
+{
+	//saved meshes are only trusted if they were made with the same meshing rules and the same look for every block
+	static uint32_t const s_meshStamp = []()
+		{
+			uint32_t stamp = 2166136261u;
+			auto addToStamp = [&stamp](uint32_t value)
+				{
+					stamp = (stamp ^ value) * 16777619u;
+				};
+
+			addToStamp(CHUNK_MESH_VERSION);
+			addToStamp(static_cast<uint32_t>(BlockDefinition::s_blockDefs.size()));
+			for (int blockDefIndex = 0; blockDefIndex < static_cast<int>(BlockDefinition::s_blockDefs.size()); blockDefIndex++)
+			{
+				BlockDefinition const& blockDef = BlockDefinition::s_blockDefs[blockDefIndex];
+				addToStamp(static_cast<uint32_t>(blockDef.m_isVisible));
+				addToStamp(static_cast<uint32_t>(blockDef.m_isOpaque));
+				addToStamp(static_cast<uint32_t>(blockDef.m_topSpriteIndex));
+				addToStamp(static_cast<uint32_t>(blockDef.m_sideSpriteIndex));
+				addToStamp(static_cast<uint32_t>(blockDef.m_bottomSpriteIndex));
+			}
+
+			return stamp;
+		}();
+
+	return s_meshStamp;
+}
+
+
+uint32_t Chunk::GetGeneratorStamp()
+{
+	//overlay saves only replay cleanly on top of the same generator, which also means the same block definition ids and block templates
+	//(the generator reads nothing from game config besides the seed, which saves already check on their own)
+	static uint32_t const s_generatorStamp = []()
+		{
+			uint32_t stamp = 2166136261u;
+			auto addToStamp = [&stamp](uint32_t value)
+				{
+					stamp = (stamp ^ value) * 16777619u;
+				};
+			auto addStringToStamp = [&addToStamp](std::string const& text)
+				{
+					addToStamp(static_cast<uint32_t>(text.size()));
+					for (int charIndex = 0; charIndex < static_cast<int>(text.size()); charIndex++)
+					{
+						addToStamp(static_cast<uint32_t>(static_cast<uint8_t>(text[charIndex])));
+					}
+				};
+
+			addToStamp(CHUNK_GENERATOR_VERSION);
+			addToStamp(static_cast<uint32_t>(BlockDefinition::s_blockDefs.size()));
+			for (int blockDefIndex = 0; blockDefIndex < static_cast<int>(BlockDefinition::s_blockDefs.size()); blockDefIndex++)
+			{
+				addStringToStamp(BlockDefinition::s_blockDefs[blockDefIndex].m_name);
+			}
+
+			addToStamp(static_cast<uint32_t>(BlockTemplate::s_loadedTemplates.size()));
+			for (int templateIndex = 0; templateIndex < static_cast<int>(BlockTemplate::s_loadedTemplates.size()); templateIndex++)
+			{
+				BlockTemplate const& blockTemplate = BlockTemplate::s_loadedTemplates[templateIndex];
+				addStringToStamp(blockTemplate.m_name);
+				addToStamp(static_cast<uint32_t>(blockTemplate.m_blueprint.size()));
+				for (int blueprintIndex = 0; blueprintIndex < static_cast<int>(blockTemplate.m_blueprint.size()); blueprintIndex++)
+				{
+					BlockTemplateEntry const& blueprintEntry = blockTemplate.m_blueprint[blueprintIndex];
+					addStringToStamp(blueprintEntry.m_blockName);
+					addToStamp(static_cast<uint32_t>(blueprintEntry.m_localBlockCoords.x));
+					addToStamp(static_cast<uint32_t>(blueprintEntry.m_localBlockCoords.y));
+					addToStamp(static_cast<uint32_t>(blueprintEntry.m_localBlockCoords.z));
+				}
+			}
+
+			return stamp;
+		}();
+
+	return s_generatorStamp;
+}
+
+
+bool Chunk::Event_BenchmarkChunkDecoding(EventArgs& args)
+{
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk decoding benchmark needs a world, so start the game first");
+		return false;
+	}
+
+	int numChunks = args.GetValue("chunks", 64);
+	if (numChunks < 1 || numChunks > 1024)
+	{
+		numChunks = 64;
+	}
+
+	//make real saves from chunks generated far away from the player, so the active world isn't touched
+	std::vector<std::vector<uint8_t>> chunkBuffers(numChunks);
+	size_t totalSaveBytes = 0;
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		Chunk* chunk = new Chunk(IntVec2(2000 + chunkIndex, 2000), world);
+		chunk->PopulateBlocks();
+		chunk->TakeSnapshot()->WriteSaveBuffer(chunkBuffers[chunkIndex], ChunkCodecType::RLE);
+		totalSaveBytes += chunkBuffers[chunkIndex].size();
+		delete chunk;
+	}
+
+	std::vector<Chunk*> perBlockChunks(numChunks);
+	std::vector<Chunk*> bulkChunks(numChunks);
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		perBlockChunks[chunkIndex] = new Chunk(IntVec2(2000 + chunkIndex, 2000), world);
+		bulkChunks[chunkIndex] = new Chunk(IntVec2(2000 + chunkIndex, 2000), world);
+	}
+
+	//old path: one SetBlockType per block
+	double startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		std::vector<uint8_t> const& chunkBuffer = chunkBuffers[chunkIndex];
+		int blockIndex = 0;
+		for (size_t bufferIndex = CHUNK_SAVE_HEADER_SIZE; bufferIndex + 1 < chunkBuffer.size(); bufferIndex += 2)
+		{
+			for (int runIndex = 0; runIndex < chunkBuffer[bufferIndex + 1]; runIndex++)
+			{
+				perBlockChunks[chunkIndex]->SetBlockType(blockIndex, chunkBuffer[bufferIndex]);
+				blockIndex++;
+			}
+		}
+	}
+	double perBlockSeconds = GetCurrentTimeSeconds() - startTime;
+
+	//new path: validate, then fill whole runs
+	bool didAllDecode = true;
+	startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		std::string errorText;
+		didAllDecode = didAllDecode && bulkChunks[chunkIndex]->DecodeSaveBuffer(chunkBuffers[chunkIndex].data(), chunkBuffers[chunkIndex].size(), errorText) == ChunkDecodeResult::SUCCESS;
+	}
+	double bulkSeconds = GetCurrentTimeSeconds() - startTime;
+
+	bool didMatch = didAllDecode;
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS && didMatch; blockIndex++)
+		{
+			didMatch = perBlockChunks[chunkIndex]->GetBlock(blockIndex)->m_blockType == bulkChunks[chunkIndex]->GetBlock(blockIndex)->m_blockType;
+		}
+		didMatch = didMatch && perBlockChunks[chunkIndex]->m_highestNonAirZ == bulkChunks[chunkIndex]->m_highestNonAirZ && perBlockChunks[chunkIndex]->m_numOpaqueBlocks == bulkChunks[chunkIndex]->m_numOpaqueBlocks;
+
+		delete perBlockChunks[chunkIndex];
+		delete bulkChunks[chunkIndex];
+	}
+
+	double saveMB = static_cast<double>(totalSaveBytes) / (1024.0 * 1024.0);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Chunk decoding benchmark (%i chunks, %.1f KB average save):", numChunks, static_cast<double>(totalSaveBytes) / (1024.0 * numChunks)));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Per-block SetBlockType: %.0f chunks/s (%.1f MB/s)", numChunks / perBlockSeconds, saveMB / perBlockSeconds));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Bulk run fill: %.0f chunks/s (%.1f MB/s), %.1fx faster%s", numChunks / bulkSeconds, saveMB / bulkSeconds, perBlockSeconds / bulkSeconds, didMatch ? "" : " (MISMATCH)"));
+
+	return true;
+}
+
+
+
+bool Chunk::Event_BenchmarkMappedReads(EventArgs& args)
+{
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Mapped read benchmark needs a world, so start the game first");
+		return false;
+	}
+
+	int numChunks = args.GetValue("chunks", REGION_NUM_CHUNKS);
+	if (numChunks < 1 || numChunks > REGION_NUM_CHUNKS)
+	{
+		numChunks = REGION_NUM_CHUNKS;
+	}
+
+	CreateDirectoryA("Saves", NULL);
+	CreateDirectoryA("Saves\\Benchmark", NULL);
+
+	//fill one region with real saves of chunks generated far away from the player, so the active world isn't touched
+	IntVec2 regionCoords = IntVec2(2016 >> REGION_BITS_X, 2016 >> REGION_BITS_Y);
+	std::string regionFilePath = Stringf("Saves/Benchmark/Region(%i,%i).region", regionCoords.x, regionCoords.y);
+	std::remove(regionFilePath.c_str());
+
+	std::vector<IntVec2> chunkCoords(numChunks);
+	std::vector<Chunk*> chunks(numChunks);
+	RegionFile* regionFile = new RegionFile(regionFilePath);
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		chunkCoords[chunkIndex] = IntVec2((regionCoords.x * REGION_SIZE_X) + (chunkIndex & (REGION_SIZE_X - 1)), (regionCoords.y * REGION_SIZE_Y) + (chunkIndex >> REGION_BITS_X));
+		chunks[chunkIndex] = new Chunk(chunkCoords[chunkIndex], world);
+		chunks[chunkIndex]->PopulateBlocks();
+
+		std::vector<uint8_t> chunkBuffer;
+		chunks[chunkIndex]->TakeSnapshot()->WriteSaveBuffer(chunkBuffer, world->m_saveCodec);
+		regionFile->WriteChunk(chunkCoords[chunkIndex], chunkBuffer);
+	}
+	int numRegionSectors = regionFile->GetNumUsedSectors();
+	delete regionFile;
+
+	//each pass opens the region fresh, reads and decodes every chunk, with the file either dropped from the os cache first or left warm from the pass before
+	double passSeconds[2][2] = {};	//[mapped][warm]
+	bool didAllDecode = true;
+	bool didAllEvict = true;
+	for (int isMapped = 0; isMapped < 2; isMapped++)
+	{
+		for (int isWarm = 0; isWarm < 2; isWarm++)
+		{
+			if (!isWarm)
+			{
+				didAllEvict = MappedFile::EvictFromPageCache(regionFilePath) && didAllEvict;
+			}
+
+			double startTime = GetCurrentTimeSeconds();
+			regionFile = new RegionFile(regionFilePath);
+			for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+			{
+				std::string errorText;
+				if (isMapped)
+				{
+					std::shared_ptr<MappedFile> mappedFile;
+					uint8_t const* chunkData = nullptr;
+					size_t chunkDataSize = 0;
+					didAllDecode = regionFile->ReadChunkMapped(chunkCoords[chunkIndex], mappedFile, chunkData, chunkDataSize) && didAllDecode;
+					didAllDecode = chunks[chunkIndex]->DecodeSaveBuffer(chunkData, chunkDataSize, errorText) == ChunkDecodeResult::SUCCESS && didAllDecode;
+				}
+				else
+				{
+					std::vector<uint8_t> chunkBuffer;
+					didAllDecode = regionFile->ReadChunk(chunkCoords[chunkIndex], chunkBuffer) && didAllDecode;
+					didAllDecode = chunks[chunkIndex]->DecodeSaveBuffer(chunkBuffer.data(), chunkBuffer.size(), errorText) == ChunkDecodeResult::SUCCESS && didAllDecode;
+				}
+			}
+			delete regionFile;
+			passSeconds[isMapped][isWarm] = GetCurrentTimeSeconds() - startTime;
+		}
+	}
+
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		delete chunks[chunkIndex];
+	}
+	std::remove(regionFilePath.c_str());
+
+	double microsecondsPerChunk = 1000000.0 / static_cast<double>(numChunks);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Mapped read benchmark (%i chunks, %i sectors, read + decode)%s:", numChunks, numRegionSectors, didAllEvict ? "" : " (couldn't evict the file, so cold numbers are warm)"));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Buffered: cold %.1f us/chunk, warm %.1f us/chunk", passSeconds[0][0] * microsecondsPerChunk, passSeconds[0][1] * microsecondsPerChunk));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Mapped:   cold %.1f us/chunk, warm %.1f us/chunk%s", passSeconds[1][0] * microsecondsPerChunk, passSeconds[1][1] * microsecondsPerChunk, didAllDecode ? "" : " (DECODE FAILED)"));
+
+	return true;
+}
+
+
+bool Chunk::Event_BenchmarkChunkMeshing(EventArgs& args)
+{
+	UNUSED(args);
+
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk meshing benchmark needs a world, so start the game first");
+		return false;
+	}
+
+	//meshes the active chunks of whatever seed is loaded, since that's the terrain the meshers actually see (F9 to try another)
+	int numChunks = 0;
+	size_t numFaces = 0;
+	size_t numVerts[2][2] = {};	//[greedy][indexed]
+	double facesSeconds = 0.0;
+	double meshSeconds[2][2] = {};
+	std::vector<ChunkMeshFace> faces;
+	std::vector<Vertex_PCU> verts;
+	for (auto chunkIndex = world->m_activeChunks.begin(); chunkIndex != world->m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk* chunk = chunkIndex->second;
+		if (chunk->m_eastNeighbor == nullptr || chunk->m_westNeighbor == nullptr || chunk->m_northNeighbor == nullptr || chunk->m_southNeighbor == nullptr)
+		{
+			continue;
+		}
+
+		std::shared_ptr<ChunkSnapshot const> snapshot = chunk->TakeMeshSnapshot();
+		double startTime = GetCurrentTimeSeconds();
+		snapshot->BuildMeshFaces(faces);
+		facesSeconds += GetCurrentTimeSeconds() - startTime;
+		numFaces += faces.size();
+		numChunks++;
+
+		for (int isGreedy = 0; isGreedy < 2; isGreedy++)
+		{
+			for (int isIndexed = 0; isIndexed < 2; isIndexed++)
+			{
+				verts.clear();
+				startTime = GetCurrentTimeSeconds();
+				snapshot->AddVertsForMeshFaces(verts, faces, isGreedy ? ChunkMesherType::GREEDY : ChunkMesherType::PER_FACE, isIndexed != 0);
+				meshSeconds[isGreedy][isIndexed] += GetCurrentTimeSeconds() - startTime;
+				numVerts[isGreedy][isIndexed] += verts.size();
+			}
+		}
+	}
+
+	if (numChunks == 0)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "No active chunks have all their neighbors yet, so there's nothing to mesh");
+		return false;
+	}
+
+	double chunkCount = static_cast<double>(numChunks);
+	double facesMicroseconds = facesSeconds * 1000000.0 / chunkCount;
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Chunk meshing benchmark (seed %u, %i chunks, %.0f visible faces per chunk, finding faces takes %.1f us/chunk):", world->m_worldSeed.load(), numChunks, static_cast<double>(numFaces) / chunkCount, facesMicroseconds));
+	for (int isGreedy = 0; isGreedy < 2; isGreedy++)
+	{
+		for (int isIndexed = 0; isIndexed < 2; isIndexed++)
+		{
+			double vertsPerChunk = static_cast<double>(numVerts[isGreedy][isIndexed]) / chunkCount;
+			double kilobytesPerChunk = vertsPerChunk * static_cast<double>(sizeof(Vertex_PCU)) / 1024.0;
+			double packedKilobytesPerChunk = vertsPerChunk * static_cast<double>(sizeof(ChunkVertex)) / 1024.0;
+			double totalMegabytes = static_cast<double>(numVerts[isGreedy][isIndexed] * sizeof(Vertex_PCU)) / (1024.0 * 1024.0);
+			double meshMicroseconds = meshSeconds[isGreedy][isIndexed] * 1000000.0 / chunkCount;
+			std::string label = Stringf("%s, %s:", isGreedy ? "Greedy" : "Per-face", isIndexed ? "indexed" : "unindexed");
+			g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" %-20s %.0f verts/chunk (%.1f KB/chunk, %.1f KB/chunk if packed, %.1f MB total), %.1f us/chunk to build (%.1f us with faces)", label.c_str(),
+				vertsPerChunk, kilobytesPerChunk, packedKilobytesPerChunk, totalMegabytes, meshMicroseconds, facesMicroseconds + meshMicroseconds));
+		}
+	}
+	size_t quadIndexBufferBytes = static_cast<size_t>(CHUNK_MAX_MESH_QUADS) * 6 * sizeof(unsigned int);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Greedy meshes have %.1fx fewer verts, indexed quads have %.1fx fewer (plus the shared %.1f MB quad index buffer)", static_cast<double>(numVerts[0][0]) / static_cast<double>(numVerts[1][0] > 0 ? numVerts[1][0] : 1),
+		static_cast<double>(numVerts[0][0]) / static_cast<double>(numVerts[0][1] > 0 ? numVerts[0][1] : 1), static_cast<double>(quadIndexBufferBytes) / (1024.0 * 1024.0)));
+
+	return true;
+}
+
+
+//
+//static mesher utilities
+//
+bool Chunk::GetMesherFromName(std::string const& mesherName, ChunkMesherType& out_mesher)
+{
+	if (mesherName == "perFace")
+	{
+		out_mesher = ChunkMesherType::PER_FACE;
+		return true;
+	}
+	if (mesherName == "greedy")
+	{
+		out_mesher = ChunkMesherType::GREEDY;
+		return true;
+	}
+
+	return false;
+}
+
+
+char const* Chunk::GetMesherName(ChunkMesherType mesher)
+{
+	switch (mesher)
+	{
+		case ChunkMesherType::PER_FACE:	return "perFace";
+		case ChunkMesherType::GREEDY:	return "greedy";
+		default:						return "unknown";
+	}
+}
+
+
+//
+//public rendering functions
+//
+bool Chunk::IsReadyToRemesh() const
+{
+	bool allNeighborsPresent = (m_eastNeighbor != nullptr) && (m_westNeighbor != nullptr) && (m_northNeighbor != nullptr) && (m_southNeighbor != nullptr);
+
+	//only one mesh build per chunk at a time, so anything that dirties the mesh while one is running just waits for the next
+	return m_areVertsDirty && allNeighborsPresent && m_runningMeshJob == nullptr;
+}
+
+
+void Chunk::RebuildVertexes()
+{
+	//meshes are built from a snapshot, so the build can run on a worker while this chunk and its neighbors keep changing
+	ChunkMeshJob* meshJob = CreateMeshJob();
+	m_runningMeshJob = meshJob;
+	m_areVertsDirty = false;
+	m_isRemeshUrgent = false;
+
+	if (m_world->m_useMeshJobs)
 	{
-		AddVertsForQuad3D(verts, bottomRightFront, bottomLeftFront, topRightFront, topLeftFront, Rgba8(eastOutdoorLightValue, eastIndoorLightValue, 255), sideUVs);	//+x (east) face
+		m_world->m_numMeshJobsRunning++;
+		g_theJobSystem->PostNewJob(meshJob);
+		return;
+	}
+
+	//with mesh jobs turned off, the same build just runs right here
+	meshJob->Execute();
+	OnMeshJobCompleted(meshJob);
+	delete meshJob;
+}
+
+
+//
+//private summary functions
+//
+void Chunk::UpdateSummaryForBlockChange(int blockIndex, uint8_t previousBlockDefID, uint8_t newBlockDefID)
+{
+	BlockDefinition const& previousBlockDef = BlockDefinition::s_blockDefs[previousBlockDefID];
+	BlockDefinition const& newBlockDef = BlockDefinition::s_blockDefs[newBlockDefID];
+
+	int sectionIndex = blockIndex >> CHUNK_SECTION_BITS;
+	int columnIndex = blockIndex & (CHUNK_LAYER_SIZE - 1);
+	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+
+	//update block counts
+	bool wasAir = previousBlockDefID == 0;
+	bool isAir = newBlockDefID == 0;
+	m_sectionNonAirCounts[sectionIndex] += static_cast<int>(wasAir) - static_cast<int>(isAir);
+
+	int opaqueChange = static_cast<int>(newBlockDef.m_isOpaque) - static_cast<int>(previousBlockDef.m_isOpaque);
+	m_sectionOpaqueCounts[sectionIndex] += opaqueChange;
+	m_numOpaqueBlocks += opaqueChange;
+
+	int visibleChange = static_cast<int>(newBlockDef.m_isVisible) - static_cast<int>(previousBlockDef.m_isVisible);
+	m_sectionVisibleCounts[sectionIndex] += visibleChange;
+	m_numVisibleBlocks += visibleChange;
+
+	//update light emitter list
+	if (previousBlockDef.m_lightEmissionValue > 0)
+	{
+		for (int emitterIndex = 0; emitterIndex < m_lightEmitterIndices.size(); emitterIndex++)
+		{
+			if (m_lightEmitterIndices[emitterIndex] == blockIndex)
+			{
+				m_lightEmitterIndices[emitterIndex] = m_lightEmitterIndices.back();
+				m_lightEmitterIndices.pop_back();
+				break;
+			}
+		}
 	}
-	if (drawWestFace)
+	if (newBlockDef.m_lightEmissionValue > 0)
 	{
-		AddVertsForQuad3D(verts, bottomLeftBack, bottomRightBack, topLeftBack, topRightBack, Rgba8(westOutdoorLightValue, westIndoorLightValue, 255), sideUVs);	//-x (west) face
+		m_lightEmitterIndices.push_back(blockIndex);
 	}
-	if (drawNorthFace)
+
+	//update column solid range, only rescanning the column if we removed one of its ends
+	if (newBlockDef.m_isSolid)
+	{
+		if (localZ < m_columnMinSolidZ[columnIndex]) m_columnMinSolidZ[columnIndex] = localZ;
+		if (localZ > m_columnMaxSolidZ[columnIndex]) m_columnMaxSolidZ[columnIndex] = localZ;
+	}
+	else if (previousBlockDef.m_isSolid && (localZ == m_columnMinSolidZ[columnIndex] || localZ == m_columnMaxSolidZ[columnIndex]))
 	{
-		AddVertsForQuad3D(verts, bottomLeftFront, bottomLeftBack, topLeftFront, topLeftBack, Rgba8(northOutdoorLightValue, northIndoorLightValue, 255), sideUVs);	//+y (north) face
+		RecalculateColumnSolidRange(columnIndex);
 	}
-	if (drawSouthFace)
+
+	//update highest non-air block
+	if (!isAir && localZ > m_highestNonAirZ)
 	{
-		AddVertsForQuad3D(verts, bottomRightBack, bottomRightFront, topRightBack, topRightFront, Rgba8(southOutdoorLightValue, southIndoorLightValue, 255), sideUVs);	//-y (south) face
+		m_highestNonAirZ = localZ;
 	}
-	if (drawSkywardFace)
+	else if (isAir && !wasAir && localZ == m_highestNonAirZ)
 	{
-		AddVertsForQuad3D(verts, topLeftBack, topRightBack, topLeftFront, topRightFront, Rgba8(skywardOutdoorLightValue, skywardIndoorLightValue, 255), topUVs);	//+z (skyward) face
+		RecalculateHighestNonAirZ();
 	}
-	if (drawDownwardFace)
+}
+
+
+void Chunk::RecalculateColumnSolidRange(int columnIndex)
+{
+	m_columnMinSolidZ[columnIndex] = CHUNK_SIZE_Z;
+	m_columnMaxSolidZ[columnIndex] = -1;
+
+	for (int localZ = 0; localZ < CHUNK_SIZE_Z; localZ++)
 	{
-		AddVertsForQuad3D(verts, bottomLeftFront, bottomRightFront, bottomLeftBack, bottomRightBack, Rgba8(downwardOutdoorLightValue, downwardIndoorLightValue, 255), bottomUVs);	//-z (downward) face
+		int blockIndex = columnIndex + (localZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
+		if (BlockDefinition::s_blockDefs[GetBlock(blockIndex)->m_blockType].m_isSolid)
+		{
+			if (localZ < m_columnMinSolidZ[columnIndex]) m_columnMinSolidZ[columnIndex] = localZ;
+			m_columnMaxSolidZ[columnIndex] = localZ;
+		}
 	}
 }
+
+
+void Chunk::RecalculateHighestNonAirZ()
+{
+	m_highestNonAirZ = -1;
+
+	//find the highest section with anything in it, then the highest layer in that section with anything in it
+	for (int sectionIndex = CHUNK_NUM_SECTIONS - 1; sectionIndex >= 0; sectionIndex--)
+	{
+		if (m_sectionNonAirCounts[sectionIndex] == 0)
+		{
+			continue;
+		}
+
+		for (int localZ = ((sectionIndex + 1) << CHUNK_SECTION_BITS_Z) - 1; localZ >= (sectionIndex << CHUNK_SECTION_BITS_Z); localZ--)
+		{
+			for (int columnIndex = 0; columnIndex < CHUNK_LAYER_SIZE; columnIndex++)
+			{
+				int blockIndex = columnIndex + (localZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
+				if (GetBlock(blockIndex)->m_blockType != 0)
+				{
+					m_highestNonAirZ = localZ;
+					return;
+				}
+			}
+		}
+	}
+}
+
+
+//
+//private bulk fill functions
+//
+void Chunk::BeginBulkFill()
+{
+	//start every section out as air, only allocating new storage for ones that aren't already
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		if (m_sections[sectionIndex] == nullptr || m_sectionNonAirCounts[sectionIndex] != 0)
+		{
+			m_sections[sectionIndex] = std::make_shared<ChunkSection>();
+			m_evictedSectionData[sectionIndex].clear();
+			m_hasSectionChangedSinceSharing[sectionIndex] = true;
+		}
+	}
+
+	for (int columnIndex = 0; columnIndex < CHUNK_LAYER_SIZE; columnIndex++)
+	{
+		m_columnMinSolidZ[columnIndex] = CHUNK_SIZE_Z;
+		m_columnMaxSolidZ[columnIndex] = -1;
+	}
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		m_sectionNonAirCounts[sectionIndex] = 0;
+		m_sectionOpaqueCounts[sectionIndex] = 0;
+		m_sectionVisibleCounts[sectionIndex] = 0;
+	}
+	m_highestNonAirZ = -1;
+	m_numOpaqueBlocks = 0;
+	m_numVisibleBlocks = 0;
+	m_lightEmitterIndices.clear();
+
+	//full saves don't say what was generated, so there's nothing to make an overlay from
+	m_isGeneratedBaselineKnown = false;
+	m_generatedBlockTypes.clear();
+}
+
+
+void Chunk::FillBlockRun(int firstBlockIndex, int runLength, uint8_t blockDefID)
+{
+	//everything starts out as air, so there's nothing to do
+	if (blockDefID == 0 || runLength <= 0)
+	{
+		return;
+	}
+
+	BlockDefinition const& blockDef = BlockDefinition::s_blockDefs[blockDefID];
+	Block filledBlock;
+	filledBlock.m_blockType = blockDefID;
+
+	//fill the run one section slice at a time
+	int endBlockIndex = firstBlockIndex + runLength;
+	int blockIndex = firstBlockIndex;
+	while (blockIndex < endBlockIndex)
+	{
+		int sectionIndex = blockIndex >> CHUNK_SECTION_BITS;
+		int sectionEndBlockIndex = (sectionIndex + 1) << CHUNK_SECTION_BITS;
+		int numBlocks = (endBlockIndex < sectionEndBlockIndex ? endBlockIndex : sectionEndBlockIndex) - blockIndex;
+
+		std::fill_n(GetBlockForWrite(blockIndex), numBlocks, filledBlock);
+
+		m_sectionNonAirCounts[sectionIndex] += numBlocks;
+		if (blockDef.m_isOpaque) m_sectionOpaqueCounts[sectionIndex] += numBlocks;
+		if (blockDef.m_isVisible) m_sectionVisibleCounts[sectionIndex] += numBlocks;
+
+		blockIndex += numBlocks;
+	}
+
+	//summarize the whole run at once
+	if (blockDef.m_isOpaque) m_numOpaqueBlocks += runLength;
+	if (blockDef.m_isVisible) m_numVisibleBlocks += runLength;
+
+	if (blockDef.m_lightEmissionValue > 0)
+	{
+		for (blockIndex = firstBlockIndex; blockIndex < endBlockIndex; blockIndex++)
+		{
+			m_lightEmitterIndices.push_back(blockIndex);
+		}
+	}
+
+	//runs come in increasing block order, so each block is the highest one so far in its column
+	if (blockDef.m_isSolid)
+	{
+		for (blockIndex = firstBlockIndex; blockIndex < endBlockIndex; blockIndex++)
+		{
+			int columnIndex = blockIndex & (CHUNK_LAYER_SIZE - 1);
+			int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+
+			if (localZ < m_columnMinSolidZ[columnIndex]) m_columnMinSolidZ[columnIndex] = localZ;
+			m_columnMaxSolidZ[columnIndex] = localZ;
+		}
+	}
+
+	m_highestNonAirZ = (endBlockIndex - 1) >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+}
+
+
+void Chunk::FillLightingRun(int firstBlockIndex, int runLength, uint8_t lighting)
+{
+	//bulk filled blocks start out with no light
+	if (lighting == 0)
+	{
+		return;
+	}
+
+	int endBlockIndex = firstBlockIndex + runLength;
+	int blockIndex = firstBlockIndex;
+	while (blockIndex < endBlockIndex)
+	{
+		int sectionEndBlockIndex = ((blockIndex >> CHUNK_SECTION_BITS) + 1) << CHUNK_SECTION_BITS;
+		int numBlocks = (endBlockIndex < sectionEndBlockIndex ? endBlockIndex : sectionEndBlockIndex) - blockIndex;
+
+		Block* blocks = GetBlockForWrite(blockIndex);
+		for (int runIndex = 0; runIndex < numBlocks; runIndex++)
+		{
+			blocks[runIndex].m_lighting = lighting;
+		}
+
+		blockIndex += numBlocks;
+	}
+}
+
+
+void Chunk::FillSkyRun(int firstBlockIndex, int runLength)
+{
+	int endBlockIndex = firstBlockIndex + runLength;
+	int blockIndex = firstBlockIndex;
+	while (blockIndex < endBlockIndex)
+	{
+		int sectionEndBlockIndex = ((blockIndex >> CHUNK_SECTION_BITS) + 1) << CHUNK_SECTION_BITS;
+		int numBlocks = (endBlockIndex < sectionEndBlockIndex ? endBlockIndex : sectionEndBlockIndex) - blockIndex;
+
+		Block* blocks = GetBlockForWrite(blockIndex);
+		for (int runIndex = 0; runIndex < numBlocks; runIndex++)
+		{
+			blocks[runIndex].m_bitFlags |= BLOCK_BIT_IS_SKY;
+		}
+
+		blockIndex += numBlocks;
+	}
+}
+
+
+void Chunk::EndBulkFill()
+{
+	SetVertsAsDirty();
+	m_needsSaving = false;
+	m_version++;
+}
+
+
+//
+//private section residency functions
+//
+void Chunk::EvictSection(int sectionIndex, bool evictPinnedSections)
+{
+	std::shared_ptr<ChunkSection>& section = m_sections[sectionIndex];
+
+	//sections that are pooled or pinned by a snapshot don't cost anything extra to keep around, so only compress ones this chunk owns
+	//(unless the caller knows the snapshot is about to let go, like a pending save)
+	if (section == nullptr)
+	{
+		return;
+	}
+	if (section.use_count() > 1 && (!evictPinnedSections || ChunkSectionPool::IsSectionPooled(section)))
+	{
+		return;
+	}
+
+	//run-length encode as (run length, block type, lighting, bit flags)
+	std::vector<uint8_t>& evictedData = m_evictedSectionData[sectionIndex];
+	evictedData.clear();
+
+	Block const* blocks = section->m_blocks;
+	int blockIndex = 0;
+	while (blockIndex < CHUNK_SECTION_TOTAL_BLOCKS)
+	{
+		Block const& runBlock = blocks[blockIndex];
+		int runLength = 1;
+		while (runLength < 255 && blockIndex + runLength < CHUNK_SECTION_TOTAL_BLOCKS)
+		{
+			Block const& nextBlock = blocks[blockIndex + runLength];
+			if (nextBlock.m_blockType != runBlock.m_blockType || nextBlock.m_lighting != runBlock.m_lighting || nextBlock.m_bitFlags != runBlock.m_bitFlags)
+			{
+				break;
+			}
+
+			runLength++;
+		}
+
+		evictedData.push_back(static_cast<uint8_t>(runLength));
+		evictedData.push_back(runBlock.m_blockType);
+		evictedData.push_back(runBlock.m_lighting);
+		evictedData.push_back(runBlock.m_bitFlags);
+
+		blockIndex += runLength;
+	}
+
+	evictedData.shrink_to_fit();
+	section.reset();
+}
+
+
+void Chunk::RestoreSection(int sectionIndex) const
+{
+	std::vector<uint8_t>& evictedData = m_evictedSectionData[sectionIndex];
+	std::shared_ptr<ChunkSection> section = std::make_shared<ChunkSection>();
+
+	int blockIndex = 0;
+	for (int dataIndex = 0; dataIndex + 3 < evictedData.size(); dataIndex += 4)
+	{
+		Block runBlock;
+		runBlock.m_blockType = evictedData[dataIndex + 1];
+		runBlock.m_lighting = evictedData[dataIndex + 2];
+		runBlock.m_bitFlags = evictedData[dataIndex + 3];
+
+		int runLength = evictedData[dataIndex];
+		for (int runIndex = 0; runIndex < runLength; runIndex++)
+		{
+			section->m_blocks[blockIndex] = runBlock;
+			blockIndex++;
+		}
+	}
+
+	GUARANTEE_OR_DIE(blockIndex == CHUNK_SECTION_TOTAL_BLOCKS, "Evicted chunk section data was corrupted!");
+
+	m_sections[sectionIndex] = section;
+	evictedData.clear();
+	evictedData.shrink_to_fit();
+}
@@ -2,10 +2,16 @@
 #include "Game/Chunk.hpp"
 #include "Game/Block.hpp"
 #include "Game/BlockTemplate.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/ChunkVertex.hpp"
 #include "Engine/Math/IntVec2.hpp"
+#include "Engine/Math/IntVec3.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Core/Vertex_PCU.hpp"
+#include "Engine/Math/AABB2.hpp"
 #include "Engine/Math/AABB3.hpp"
+#include <map>
+#include <memory>
 
 
 //chunk constants
@@ -24,10 +30,18 @@ constexpr int CHUNK_MAX_Z = CHUNK_SIZE_Z - 1;
 constexpr int CHUNK_LAYER_SIZE = CHUNK_SIZE_X * CHUNK_SIZE_Y;
 constexpr int CHUNK_TOTAL_BLOCKS = CHUNK_LAYER_SIZE * CHUNK_SIZE_Z;
 
+//section constants (sections are 16-block-tall horizontal slices of a chunk, so a block's section is just the top bits of its index)
+//sections are the cubic volumes of the world: each one is addressed by IntVec3(chunkX, chunkY, sectionZ) and is only kept resident near the player
+constexpr int CHUNK_SECTION_BITS_Z = 4;
+constexpr int CHUNK_SECTION_SIZE_Z = 1 << CHUNK_SECTION_BITS_Z;
+constexpr int CHUNK_SECTION_BITS = CHUNK_BITS_X + CHUNK_BITS_Y + CHUNK_SECTION_BITS_Z;
+constexpr int CHUNK_SECTION_TOTAL_BLOCKS = 1 << CHUNK_SECTION_BITS;
+constexpr int CHUNK_NUM_SECTIONS = CHUNK_SIZE_Z / CHUNK_SECTION_SIZE_Z;
+
 
 //generation constants
 constexpr int BASE_TERRAIN_HEIGHT = 63;
-constexpr int SEA_LEVEL = CHUNK_SIZE_Z / 2;
+constexpr int SEA_LEVEL = 64;
 constexpr int OCEAN_FLOOR_DEPTH = 30;
 
 constexpr float HUMIDITY_SAND_THRESHOLD = 0.45f;
@@ -61,10 +75,26 @@ constexpr float CAVE_MAX_ANGLE_CHANGE = 90.0f;
 constexpr float CAVE_MAX_HEIGHT_CHANGE = 12.0f;
 constexpr float CAVE_GENERATION_CHANCE = 0.025f;
 
+//save file constants
+constexpr int CHUNK_SAVE_HEADER_SIZE = 12;	//4CC, version (which is also the codec), bits x/y/z, world seed
+constexpr uint8_t CHUNK_SAVE_LIGHTING_FLAG = 0x80;	//set on the version byte when a lighting section follows the header
+constexpr uint32_t CHUNK_LIGHTING_VERSION = 1;		//bump whenever lighting rules change, so old saved lighting gets thrown out
+constexpr uint8_t CHUNK_SAVE_OVERLAY_VERSION = 6;	//version byte for saves that only store blocks that differ from the generator
+constexpr uint32_t CHUNK_GENERATOR_VERSION = 1;		//bump whenever PopulateBlocks changes what it makes, since overlay saves are replayed on top of it (block definitions and templates are hashed in too, see GetGeneratorStamp)
+constexpr uint8_t CHUNK_SAVE_MESH_FLAG = 0x40;		//set on the version byte when a baked mesh section follows the lighting section
+constexpr uint32_t CHUNK_MESH_VERSION = 1;			//bump whenever meshing rules change, so old baked meshes get thrown out
+
+//meshing constants
+constexpr float CHUNK_GREEDY_UV_SPRITE_STRIDE = 256.0f;	//greedy quad UVs are sprite coords * stride + tiles covered, so the world shader can wrap each tile back into its sprite
+constexpr int CHUNK_GREEDY_MAX_QUAD_TILES = static_cast<int>(CHUNK_GREEDY_UV_SPRITE_STRIDE) - 1;	//greedy quads stop growing here, so their tiles never spill into the next sprite's stride (even in chunks taller than the stride)
+constexpr int CHUNK_MAX_MESH_QUADS = CHUNK_TOTAL_BLOCKS * 6;	//every block showing all six faces (a chunk full of non-opaque blocks), which is what the shared quad index buffer is sized for
+
 
 //forward declarations
 class VertexBuffer;
 class World;
+class ChunkSnapshot;
+class ChunkMeshJob;
 
 
 //generation state enum
@@ -72,14 +102,41 @@ enum class ChunkState
 {
 	QUEUED,
 	GENERATING,
+	LOADING,
 	COMPLETED,
 	ACTIVATED
 };
 
 
+//save decoding result enum
+enum class ChunkDecodeResult
+{
+	SUCCESS,
+	SEED_MISMATCH,			//valid save, but for a different world
+	GENERATOR_MISMATCH,		//valid overlay save made on top of a different version of the generator, so its edits were replayed onto what the current one makes
+	MALFORMED
+};
+
+
+//how visible faces are turned into quads
+enum class ChunkMesherType
+{
+	PER_FACE,	//one quad per visible block face, with the sprite's own atlas UVs
+	GREEDY		//coplanar faces with the same sprite and light merged into rectangles, with tiled UVs (needs a world shader tiled sprite mode that doesn't exist yet)
+};
+
+
+//block storage for one section, shared between the live chunk and any snapshots that have pinned it
+struct ChunkSection
+{
+	Block m_blocks[CHUNK_SECTION_TOTAL_BLOCKS];
+};
+
+
 class Chunk
 {
 	friend class World;
+	friend class ChunkCache;
 
 //public member functions
 public:
@@ -88,9 +145,26 @@ public:
 	~Chunk();
 
 	//game flow functions
-	void Update();
 	void Render() const;
 
+	//rendering functions
+	bool IsReadyToRemesh() const;
+	void RebuildVertexes();
+
+	//block accessors
+	Block const* GetBlock(int blockIndex) const;
+	Block*		 GetBlockForWrite(int blockIndex);
+
+	//snapshot functions
+	std::shared_ptr<ChunkSnapshot const> TakeSnapshot();
+	std::shared_ptr<ChunkSnapshot const> TakeSnapshotWithNeighbors();
+	std::shared_ptr<ChunkSnapshot const> TakeMeshSnapshot();
+
+	//mesh job functions
+	ChunkMeshJob* CreateMeshJob();
+	void		  OnMeshJobCompleted(ChunkMeshJob* meshJob);
+	bool		  IsMeshJobRunning() const;
+
 	//chunk utilities
 	void PopulateBlocks();
 	void AddCaves(unsigned int worldCaveSeed, std::vector<BlockTemplateEntry>& blockTemplateOrigins);
@@ -105,19 +179,69 @@ public:
 	int	 GetBlockLightEmissionValue(int blockIndex) const;
 	bool SaveChunk();
 	void LoadChunk();
-	int  GetBlockIndexFromLocalCoords(int localX, int localY, int localZ) const;
+	bool LoadChunkFromSnapshot(ChunkSnapshot const& snapshot);	//false (with the chunk untouched) if the snapshot is from a different seed
+	ChunkDecodeResult DecodeSaveBuffer(uint8_t const* chunkData, size_t chunkDataSize, std::string& out_errorText);
+	static int GetBlockIndexFromLocalCoords(int localX, int localY, int localZ);
+	int  GetNumMeshVerts() const;
 	Vec3 GetChunkCenter() const;
 	void SetVertsAsDirty();
 
+	//section sharing functions
+	void ShareIdenticalSections();
+	void ShareOpenSkySections();
+	bool HasIndoorLightInSection(int sectionIndex) const;
+
+	//section residency functions
+	IntVec3 GetSectionCoords(int sectionIndex) const;
+	AABB3	GetSectionBounds(int sectionIndex) const;
+	void	SetSectionResident(int sectionIndex, bool isResident);
+	bool	IsSectionResident(int sectionIndex) const;
+	bool	IsSectionEvicted(int sectionIndex) const;
+	void	EvictNonResidentSection(int sectionIndex);	//for sections that reads or snapshots restored (or that were pinned) while they were non-resident
+
+	//lighting functions
+	bool HasDirtyLighting() const;
+
+	//summary functions
+	void RebuildSummary();
+	bool CouldBlockBeSolid(int blockIndex) const;
+
+	//static save utilities
+	static uint32_t GetLightingStamp();
+	static uint32_t GetMeshStamp();
+	static uint32_t GetGeneratorStamp();
+	static bool		Event_BenchmarkChunkDecoding(EventArgs& args);
+	static bool		Event_BenchmarkMappedReads(EventArgs& args);
+	static bool		Event_BenchmarkChunkMeshing(EventArgs& args);
+
+	//static mesher utilities
+	static bool		   GetMesherFromName(std::string const& mesherName, ChunkMesherType& out_mesher);
+	static char const* GetMesherName(ChunkMesherType mesher);
+
 //private member functions
 private:
-	//rendering functions
-	void RebuildVertexes();
-	void AddVertsForBlock(std::vector<Vertex_PCU>& verts, int blockIndex);
+	//summary functions
+	void UpdateSummaryForBlockChange(int blockIndex, uint8_t previousBlockDefID, uint8_t newBlockDefID);
+	void RecalculateColumnSolidRange(int columnIndex);
+	void RecalculateHighestNonAirZ();
+
+	//bulk fill functions (runs must be filled in increasing block order)
+	void BeginBulkFill();
+	void FillBlockRun(int firstBlockIndex, int runLength, uint8_t blockDefID);
+	void FillLightingRun(int firstBlockIndex, int runLength, uint8_t lighting);
+	void FillSkyRun(int firstBlockIndex, int runLength);
+	void EndBulkFill();
+
+	//section residency functions
+	void EvictSection(int sectionIndex, bool evictPinnedSections = false);
+	void RestoreSection(int sectionIndex) const;
 
 //public member variables
 public:
-	Block* m_blocks = nullptr;
+	mutable std::shared_ptr<ChunkSection> m_sections[CHUNK_NUM_SECTIONS];	//null while the section is evicted (mutable so const reads can restore it)
+	bool m_hasSectionChangedSinceSharing[CHUNK_NUM_SECTIONS] = {};
+	bool m_isSectionResident[CHUNK_NUM_SECTIONS];
+	unsigned int m_version = 0;
 
 	IntVec2 m_chunkCoords = IntVec2();
 	AABB3	m_bounds = AABB3();
@@ -126,6 +250,21 @@ public:
 
 	bool m_needsSaving = false;
 	bool m_areVertsDirty = true;
+	bool m_isRemeshUrgent = false;		//set when the player edits the chunk, so its remesh goes ahead of everything that's just streaming in
+	bool m_hasCachedLighting = false;	//true if blocks came back from the chunk cache or a save with their lighting already done
+	bool m_hasCachedMesh = false;		//true if the baked mesh came back from the chunk cache or a save, and hasn't been checked against the blocks yet
+
+	//save queue ticket for a save of the blocks as they are now (0 once they're edited again), so m_needsSaving only clears once that save is written
+	uint64_t m_queuedSaveTicket = 0;
+
+	//baked mesh variables (the visible faces the current mesh was built from, and a hash of the blocks and lighting that went into them)
+	std::vector<ChunkMeshFace> m_meshFaces;
+	uint64_t				   m_meshInputHash = 0;
+	bool					   m_isMeshBaked = false;	//true if the faces were built with baked meshes on, so they have a hash worth saving with them
+
+	//overlay save variables (the generated type of every block changed since PopulateBlocks, so saves only need to store the differences)
+	bool				   m_isGeneratedBaselineKnown = false;	//false for chunks loaded from full saves, which have to keep saving in full
+	std::map<int, uint8_t> m_generatedBlockTypes;
 
 	Chunk* m_eastNeighbor = nullptr;
 	Chunk* m_westNeighbor = nullptr;
@@ -133,10 +272,31 @@ public:
 	Chunk* m_southNeighbor = nullptr;
 
 	std::atomic<ChunkState> m_state = ChunkState::QUEUED;
+	std::atomic<bool>		m_isCancelled = false;	//set while queued if the chunk is no longer wanted, so its job skips the work
+
+	//summary variables (kept up to date incrementally by SetBlockType)
+	int m_columnMinSolidZ[CHUNK_LAYER_SIZE];	//CHUNK_SIZE_Z if the column has no solid blocks
+	int m_columnMaxSolidZ[CHUNK_LAYER_SIZE];	//-1 if the column has no solid blocks
+	int m_highestNonAirZ = -1;
+	int m_sectionNonAirCounts[CHUNK_NUM_SECTIONS] = {};
+	int m_sectionOpaqueCounts[CHUNK_NUM_SECTIONS] = {};
+	int m_sectionVisibleCounts[CHUNK_NUM_SECTIONS] = {};
+	int m_numOpaqueBlocks = 0;
+	int m_numVisibleBlocks = 0;
+	std::vector<int> m_lightEmitterIndices;
 
 //private member variables
 private:
 	//rendering variables
-	std::vector<Vertex_PCU> m_cpuMesh;
-	VertexBuffer*			m_gpuMesh = nullptr;
+	int						 m_numMeshVerts = 0;	//the verts only live on the gpu, so this is all that's kept of them
+	VertexBuffer*			 m_gpuMesh = nullptr;
+	bool					 m_isMeshIndexed = false;	//true if the mesh on the gpu is 4 verts per quad, drawn through g_chunkQuadIndexBuffer
+	ChunkMeshJob*			 m_runningMeshJob = nullptr;	//at most one build per chunk is in flight, and anything that dirties the mesh meanwhile waits for the next one
+
+	//snapshot variables
+	std::weak_ptr<ChunkSnapshot const> m_latestSnapshot;
+	unsigned int					   m_latestSnapshotVersion = 0;
+
+	//residency variables (run-length encoded blocks of sections that are too far from the player to keep uncompressed)
+	mutable std::vector<uint8_t> m_evictedSectionData[CHUNK_NUM_SECTIONS];
 };
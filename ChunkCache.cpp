@@ -0,0 +1,212 @@
+#include "Game/ChunkCache.hpp"
+#include <cstring>
+
+
+//
+//public cache management functions
+//
+void ChunkCache::SetMemoryBudget(size_t maxBytes)
+{
+	m_maxBytes = maxBytes;
+
+	while (m_numBytesUsed > m_maxBytes && !m_lruOrder.empty())
+	{
+		EvictLeastRecentlyUsedChunk();
+	}
+}
+
+
+bool ChunkCache::AddChunk(Chunk* chunk)
+{
+	//lighting that's still being worked on can't be trusted later, so leave those chunks to the disk
+	if (m_maxBytes == 0 || chunk->HasDirtyLighting())
+	{
+		m_numSkipped++;
+		return false;
+	}
+
+	RemoveChunk(chunk->m_chunkCoords);
+
+	CachedChunk& cachedChunk = m_cachedChunks[chunk->m_chunkCoords];
+	cachedChunk.m_numBytes = sizeof(CachedChunk);
+
+	//compress every section that isn't pooled, and just keep a reference to ones that are
+	//sections pinned by a pending save still get compressed, since the save lets go of them once it's written
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		chunk->EvictSection(sectionIndex, true);
+
+		if (chunk->IsSectionEvicted(sectionIndex))
+		{
+			cachedChunk.m_compressedSections[sectionIndex].swap(chunk->m_evictedSectionData[sectionIndex]);
+			cachedChunk.m_numBytes += cachedChunk.m_compressedSections[sectionIndex].size();
+		}
+		else
+		{
+			cachedChunk.m_sharedSections[sectionIndex] = chunk->m_sections[sectionIndex];
+		}
+	}
+
+	//keep the summary too, so it doesn't have to be rebuilt block by block
+	memcpy(cachedChunk.m_columnMinSolidZ, chunk->m_columnMinSolidZ, sizeof(cachedChunk.m_columnMinSolidZ));
+	memcpy(cachedChunk.m_columnMaxSolidZ, chunk->m_columnMaxSolidZ, sizeof(cachedChunk.m_columnMaxSolidZ));
+	memcpy(cachedChunk.m_sectionNonAirCounts, chunk->m_sectionNonAirCounts, sizeof(cachedChunk.m_sectionNonAirCounts));
+	memcpy(cachedChunk.m_sectionOpaqueCounts, chunk->m_sectionOpaqueCounts, sizeof(cachedChunk.m_sectionOpaqueCounts));
+	memcpy(cachedChunk.m_sectionVisibleCounts, chunk->m_sectionVisibleCounts, sizeof(cachedChunk.m_sectionVisibleCounts));
+	cachedChunk.m_highestNonAirZ = chunk->m_highestNonAirZ;
+	cachedChunk.m_numOpaqueBlocks = chunk->m_numOpaqueBlocks;
+	cachedChunk.m_numVisibleBlocks = chunk->m_numVisibleBlocks;
+	cachedChunk.m_lightEmitterIndices = chunk->m_lightEmitterIndices;
+	cachedChunk.m_numBytes += cachedChunk.m_lightEmitterIndices.size() * sizeof(int);
+
+	//and what was generated, so the chunk can keep saving as an overlay
+	cachedChunk.m_isGeneratedBaselineKnown = chunk->m_isGeneratedBaselineKnown;
+	cachedChunk.m_generatedBlockTypes.swap(chunk->m_generatedBlockTypes);
+	cachedChunk.m_numBytes += cachedChunk.m_generatedBlockTypes.size() * sizeof(std::pair<int const, uint8_t>);
+
+	//and the finished mesh, so coming back doesn't have to redo it unless something around the chunk changed
+	if (chunk->m_isMeshBaked && !chunk->m_areVertsDirty)
+	{
+		cachedChunk.m_hasBakedMesh = true;
+		cachedChunk.m_meshInputHash = chunk->m_meshInputHash;
+		cachedChunk.m_meshFaces.swap(chunk->m_meshFaces);
+		cachedChunk.m_numBytes += cachedChunk.m_meshFaces.size() * sizeof(ChunkMeshFace);
+	}
+
+	m_lruOrder.push_front(chunk->m_chunkCoords);
+	cachedChunk.m_lruPosition = m_lruOrder.begin();
+	m_numBytesUsed += cachedChunk.m_numBytes;
+
+	//make room by dropping the chunks that have gone the longest without being needed
+	while (m_numBytesUsed > m_maxBytes && !m_lruOrder.empty())
+	{
+		EvictLeastRecentlyUsedChunk();
+	}
+
+	return true;
+}
+
+
+bool ChunkCache::RestoreChunk(IntVec2 chunkCoords, Chunk* chunk)
+{
+	auto cachedChunkFound = m_cachedChunks.find(chunkCoords);
+	if (cachedChunkFound == m_cachedChunks.end())
+	{
+		m_numMisses++;
+		return false;
+	}
+
+	CachedChunk& cachedChunk = cachedChunkFound->second;
+
+	//compressed sections go back in evicted, so they only get decompressed once something actually reads them
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		if (cachedChunk.m_sharedSections[sectionIndex] != nullptr)
+		{
+			chunk->m_sections[sectionIndex] = cachedChunk.m_sharedSections[sectionIndex];
+		}
+		else
+		{
+			chunk->m_sections[sectionIndex].reset();
+			chunk->m_evictedSectionData[sectionIndex].swap(cachedChunk.m_compressedSections[sectionIndex]);
+			chunk->m_hasSectionChangedSinceSharing[sectionIndex] = true;
+		}
+	}
+
+	memcpy(chunk->m_columnMinSolidZ, cachedChunk.m_columnMinSolidZ, sizeof(cachedChunk.m_columnMinSolidZ));
+	memcpy(chunk->m_columnMaxSolidZ, cachedChunk.m_columnMaxSolidZ, sizeof(cachedChunk.m_columnMaxSolidZ));
+	memcpy(chunk->m_sectionNonAirCounts, cachedChunk.m_sectionNonAirCounts, sizeof(cachedChunk.m_sectionNonAirCounts));
+	memcpy(chunk->m_sectionOpaqueCounts, cachedChunk.m_sectionOpaqueCounts, sizeof(cachedChunk.m_sectionOpaqueCounts));
+	memcpy(chunk->m_sectionVisibleCounts, cachedChunk.m_sectionVisibleCounts, sizeof(cachedChunk.m_sectionVisibleCounts));
+	chunk->m_highestNonAirZ = cachedChunk.m_highestNonAirZ;
+	chunk->m_numOpaqueBlocks = cachedChunk.m_numOpaqueBlocks;
+	chunk->m_numVisibleBlocks = cachedChunk.m_numVisibleBlocks;
+	chunk->m_lightEmitterIndices.swap(cachedChunk.m_lightEmitterIndices);
+	chunk->m_isGeneratedBaselineKnown = cachedChunk.m_isGeneratedBaselineKnown;
+	chunk->m_generatedBlockTypes.swap(cachedChunk.m_generatedBlockTypes);
+
+	chunk->m_hasCachedLighting = true;
+	if (cachedChunk.m_hasBakedMesh)
+	{
+		chunk->m_meshFaces.swap(cachedChunk.m_meshFaces);
+		chunk->m_meshInputHash = cachedChunk.m_meshInputHash;
+		chunk->m_hasCachedMesh = true;
+	}
+	chunk->m_needsSaving = false;	//chunks are always saved before being cached
+	chunk->m_version++;
+
+	//the chunk is live again, so it doesn't belong in the cache anymore
+	m_numBytesUsed -= cachedChunk.m_numBytes;
+	m_lruOrder.erase(cachedChunk.m_lruPosition);
+	m_cachedChunks.erase(cachedChunkFound);
+
+	m_numHits++;
+	return true;
+}
+
+
+void ChunkCache::RemoveChunk(IntVec2 chunkCoords)
+{
+	auto cachedChunkFound = m_cachedChunks.find(chunkCoords);
+	if (cachedChunkFound == m_cachedChunks.end())
+	{
+		return;
+	}
+
+	m_numBytesUsed -= cachedChunkFound->second.m_numBytes;
+	m_lruOrder.erase(cachedChunkFound->second.m_lruPosition);
+	m_cachedChunks.erase(cachedChunkFound);
+}
+
+
+void ChunkCache::Clear()
+{
+	m_cachedChunks.clear();
+	m_lruOrder.clear();
+	m_numBytesUsed = 0;
+
+	//stats start over too, so they cover the same stretch as the world's full view timer
+	m_numHits = 0;
+	m_numMisses = 0;
+	m_numEvictions = 0;
+	m_numSkipped = 0;
+}
+
+
+//
+//public stats functions
+//
+float ChunkCache::GetHitRate() const
+{
+	int numLookups = m_numHits + m_numMisses;
+	if (numLookups == 0)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(m_numHits) / static_cast<float>(numLookups);
+}
+
+
+float ChunkCache::GetMemoryUsedMB() const
+{
+	return static_cast<float>(m_numBytesUsed) / (1024.0f * 1024.0f);
+}
+
+
+int ChunkCache::GetNumCachedChunks() const
+{
+	return static_cast<int>(m_cachedChunks.size());
+}
+
+
+//
+//private cache management functions
+//
+void ChunkCache::EvictLeastRecentlyUsedChunk()
+{
+	IntVec2 leastRecentlyUsedCoords = m_lruOrder.back();
+	RemoveChunk(leastRecentlyUsedCoords);
+
+	m_numEvictions++;
+}
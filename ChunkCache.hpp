@@ -0,0 +1,70 @@
+#pragma once
+#include "Game/Chunk.hpp"
+#include <list>
+#include <map>
+
+
+//compressed copy of a deactivated chunk's blocks (including lighting) and summary, kept so reactivating it doesn't need the disk or the generator
+struct CachedChunk
+{
+	std::shared_ptr<ChunkSection> m_sharedSections[CHUNK_NUM_SECTIONS];		//sections that were pooled (these don't cost the cache anything)
+	std::vector<uint8_t>		  m_compressedSections[CHUNK_NUM_SECTIONS];	//run-length encoded blocks for every other section
+
+	int				 m_columnMinSolidZ[CHUNK_LAYER_SIZE];
+	int				 m_columnMaxSolidZ[CHUNK_LAYER_SIZE];
+	int				 m_highestNonAirZ = -1;
+	int				 m_sectionNonAirCounts[CHUNK_NUM_SECTIONS] = {};
+	int				 m_sectionOpaqueCounts[CHUNK_NUM_SECTIONS] = {};
+	int				 m_sectionVisibleCounts[CHUNK_NUM_SECTIONS] = {};
+	int				 m_numOpaqueBlocks = 0;
+	int				 m_numVisibleBlocks = 0;
+	std::vector<int> m_lightEmitterIndices;
+
+	bool				   m_isGeneratedBaselineKnown = false;
+	std::map<int, uint8_t> m_generatedBlockTypes;
+
+	bool					   m_hasBakedMesh = false;
+	uint64_t				   m_meshInputHash = 0;
+	std::vector<ChunkMeshFace> m_meshFaces;
+
+	size_t m_numBytes = 0;
+	std::list<IntVec2>::iterator m_lruPosition;
+};
+
+
+//least-recently-used cache of deactivated chunks, capped at a memory budget
+//only used from the main thread
+class ChunkCache
+{
+//public member functions
+public:
+	//cache management functions
+	void SetMemoryBudget(size_t maxBytes);
+	bool AddChunk(Chunk* chunk);
+	bool RestoreChunk(IntVec2 chunkCoords, Chunk* chunk);
+	void RemoveChunk(IntVec2 chunkCoords);
+	void Clear();
+
+	//stats functions
+	float  GetHitRate() const;
+	float  GetMemoryUsedMB() const;
+	int	   GetNumCachedChunks() const;
+
+//private member functions
+private:
+	void EvictLeastRecentlyUsedChunk();
+
+//public member variables
+public:
+	int m_numHits = 0;
+	int m_numMisses = 0;
+	int m_numEvictions = 0;
+	int m_numSkipped = 0;
+
+//private member variables
+private:
+	std::map<IntVec2, CachedChunk> m_cachedChunks;
+	std::list<IntVec2>			   m_lruOrder;	//most recently cached at the front
+	size_t						   m_maxBytes = 0;
+	size_t						   m_numBytesUsed = 0;
+};
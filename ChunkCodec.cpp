@@ -0,0 +1,719 @@
+#include "Game/ChunkCodec.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/World.hpp"
+#include "Game/Game.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/Time.hpp"
+#include <cstring>
+
+
+//
+//public encoding and decoding functions
+//
+void ChunkCodec::EncodeBlockTypes(ChunkCodecType codec, uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data)
+{
+	switch (codec)
+	{
+		case ChunkCodecType::PALETTE_RLE:	EncodePaletteRLE(blockTypes, numBlocks, out_data);	break;
+		case ChunkCodecType::LZ:			EncodeLZ(blockTypes, numBlocks, out_data);			break;
+		default:							EncodeRLE(blockTypes, numBlocks, out_data);			break;
+	}
+}
+
+
+bool ChunkCodec::DecodeBlockRuns(uint8_t version, uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockRun>& out_runs, std::string& out_errorText)
+{
+	out_runs.clear();
+
+	switch (static_cast<ChunkCodecType>(version))
+	{
+		case ChunkCodecType::RLE:			return DecodeRLE(data, dataSize, out_runs, out_errorText);
+		case ChunkCodecType::PALETTE_RLE:	return DecodePaletteRLE(data, dataSize, out_runs, out_errorText);
+		case ChunkCodecType::LZ:			return DecodeLZ(data, dataSize, numBlocks, out_runs, out_errorText);
+		default:
+			out_errorText = Stringf("unsupported version %i", static_cast<int>(version));
+			return false;
+	}
+}
+
+
+void ChunkCodec::EncodeBlockEdits(std::vector<BlockEdit> const& edits, std::vector<uint8_t>& out_data)
+{
+	//edit count, then each edit as the gap since the previous edited block and its block type (edits have to be in increasing block order)
+	WriteVarint(static_cast<uint32_t>(edits.size()), out_data);
+
+	int previousBlockIndex = -1;
+	for (int editIndex = 0; editIndex < static_cast<int>(edits.size()); editIndex++)
+	{
+		WriteVarint(static_cast<uint32_t>(edits[editIndex].m_blockIndex - previousBlockIndex - 1), out_data);
+		out_data.push_back(edits[editIndex].m_blockType);
+		previousBlockIndex = edits[editIndex].m_blockIndex;
+	}
+}
+
+
+bool ChunkCodec::DecodeBlockEdits(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockEdit>& out_edits, std::string& out_errorText)
+{
+	out_edits.clear();
+
+	size_t readIndex = 0;
+	uint32_t numEdits = 0;
+	if (!ReadVarint(data, dataSize, readIndex, numEdits) || numEdits > static_cast<uint32_t>(numBlocks))
+	{
+		out_errorText = "has a bad edit count";
+		return false;
+	}
+
+	out_edits.reserve(numEdits);
+	int64_t previousBlockIndex = -1;
+	for (uint32_t editIndex = 0; editIndex < numEdits; editIndex++)
+	{
+		uint32_t blockIndexGap = 0;
+		if (!ReadVarint(data, dataSize, readIndex, blockIndexGap) || readIndex >= dataSize)
+		{
+			out_errorText = "ends in the middle of an edit";
+			return false;
+		}
+
+		int64_t blockIndex = previousBlockIndex + 1 + blockIndexGap;
+		if (blockIndex >= numBlocks)
+		{
+			out_errorText = Stringf("has an edit past the end of the chunk (block %lli)", static_cast<long long>(blockIndex));
+			return false;
+		}
+
+		BlockEdit edit;
+		edit.m_blockIndex = static_cast<int>(blockIndex);
+		edit.m_blockType = data[readIndex++];
+		out_edits.push_back(edit);
+		previousBlockIndex = blockIndex;
+	}
+
+	if (readIndex != dataSize)
+	{
+		out_errorText = "has extra data after its edits";
+		return false;
+	}
+
+	return true;
+}
+
+
+void ChunkCodec::EncodeMeshFaces(std::vector<ChunkMeshFace> const& faces, std::vector<uint8_t>& out_data)
+{
+	//face count, then each face as the gap since the previous face's block, which side it's on, and its two light values (faces have to be in block order)
+	WriteVarint(static_cast<uint32_t>(faces.size()), out_data);
+
+	int previousBlockIndex = 0;
+	for (int faceIndex = 0; faceIndex < static_cast<int>(faces.size()); faceIndex++)
+	{
+		ChunkMeshFace const& face = faces[faceIndex];
+		WriteVarint(face.m_blockIndex - static_cast<uint32_t>(previousBlockIndex), out_data);
+		out_data.push_back(static_cast<uint8_t>(face.m_face));
+		out_data.push_back(face.m_outdoorLight);
+		out_data.push_back(face.m_indoorLight);
+		previousBlockIndex = static_cast<int>(face.m_blockIndex);
+	}
+}
+
+
+bool ChunkCodec::DecodeMeshFaces(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<ChunkMeshFace>& out_faces, std::string& out_errorText)
+{
+	out_faces.clear();
+
+	size_t readIndex = 0;
+	uint32_t numFaces = 0;
+	if (!ReadVarint(data, dataSize, readIndex, numFaces) || numFaces > static_cast<uint32_t>(numBlocks) * static_cast<uint32_t>(BlockFace::COUNT))
+	{
+		out_errorText = "has a bad mesh face count";
+		return false;
+	}
+
+	out_faces.reserve(numFaces);
+	int64_t previousBlockIndex = 0;
+	for (uint32_t faceIndex = 0; faceIndex < numFaces; faceIndex++)
+	{
+		uint32_t blockIndexGap = 0;
+		if (!ReadVarint(data, dataSize, readIndex, blockIndexGap) || dataSize - readIndex < 3)
+		{
+			out_errorText = "ends in the middle of a mesh face";
+			return false;
+		}
+
+		int64_t blockIndex = previousBlockIndex + blockIndexGap;
+		if (blockIndex >= numBlocks || data[readIndex] >= static_cast<uint8_t>(BlockFace::COUNT))
+		{
+			out_errorText = Stringf("has a bad mesh face (block %lli, side %i)", static_cast<long long>(blockIndex), static_cast<int>(data[readIndex]));
+			return false;
+		}
+
+		ChunkMeshFace face;
+		face.m_blockIndex = static_cast<uint32_t>(blockIndex);
+		face.m_face = static_cast<BlockFace>(data[readIndex]);
+		face.m_outdoorLight = data[readIndex + 1];
+		face.m_indoorLight = data[readIndex + 2];
+		readIndex += 3;
+		out_faces.push_back(face);
+		previousBlockIndex = blockIndex;
+	}
+
+	if (readIndex != dataSize)
+	{
+		out_errorText = "has extra data after its mesh faces";
+		return false;
+	}
+
+	return true;
+}
+
+
+//
+//public codec utilities
+//
+bool ChunkCodec::IsSupportedVersion(uint8_t version)
+{
+	return version == static_cast<uint8_t>(ChunkCodecType::RLE) || version == static_cast<uint8_t>(ChunkCodecType::PALETTE_RLE) || version == static_cast<uint8_t>(ChunkCodecType::LZ);
+}
+
+
+bool ChunkCodec::GetCodecFromName(std::string const& codecName, ChunkCodecType& out_codec)
+{
+	if (codecName == "rle")
+	{
+		out_codec = ChunkCodecType::RLE;
+		return true;
+	}
+	if (codecName == "palette")
+	{
+		out_codec = ChunkCodecType::PALETTE_RLE;
+		return true;
+	}
+	if (codecName == "lz")
+	{
+		out_codec = ChunkCodecType::LZ;
+		return true;
+	}
+
+	return false;
+}
+
+
+char const* ChunkCodec::GetCodecName(ChunkCodecType codec)
+{
+	switch (codec)
+	{
+		case ChunkCodecType::RLE:			return "rle";
+		case ChunkCodecType::PALETTE_RLE:	return "palette";
+		case ChunkCodecType::LZ:			return "lz";
+		default:							return "unknown";
+	}
+}
+
+
+bool ChunkCodec::Event_BenchmarkChunkCodecs(EventArgs& args)
+{
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk codec benchmark needs a world, so start the game first");
+		return false;
+	}
+
+	int numChunks = args.GetValue("chunks", 64);
+	if (numChunks < 1 || numChunks > 1024)
+	{
+		numChunks = 64;
+	}
+
+	//grab the block types of real generated chunks, away from the player so the active world isn't touched
+	std::vector<uint8_t> allBlockTypes(static_cast<size_t>(numChunks) * CHUNK_TOTAL_BLOCKS);
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		Chunk* chunk = new Chunk(IntVec2(2000 + chunkIndex, 2100), world);
+		chunk->PopulateBlocks();
+
+		uint8_t* blockTypes = &allBlockTypes[static_cast<size_t>(chunkIndex) * CHUNK_TOTAL_BLOCKS];
+		for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
+		{
+			blockTypes[blockIndex] = chunk->GetBlock(blockIndex)->m_blockType;
+		}
+
+		delete chunk;
+	}
+
+	double rawMB = static_cast<double>(allBlockTypes.size()) / (1024.0 * 1024.0);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Chunk codec benchmark (%i generated chunks, %.1f MB of raw block types):", numChunks, rawMB));
+
+	ChunkCodecType const codecs[] = { ChunkCodecType::RLE, ChunkCodecType::PALETTE_RLE, ChunkCodecType::LZ };
+	for (ChunkCodecType codec : codecs)
+	{
+		std::vector<std::vector<uint8_t>> encodedChunks(numChunks);
+		size_t totalEncodedBytes = 0;
+
+		double startTime = GetCurrentTimeSeconds();
+		for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+		{
+			EncodeBlockTypes(codec, &allBlockTypes[static_cast<size_t>(chunkIndex) * CHUNK_TOTAL_BLOCKS], CHUNK_TOTAL_BLOCKS, encodedChunks[chunkIndex]);
+			totalEncodedBytes += encodedChunks[chunkIndex].size();
+		}
+		double encodeSeconds = GetCurrentTimeSeconds() - startTime;
+
+		std::vector<std::vector<BlockRun>> decodedRuns(numChunks);
+		bool didAllDecode = true;
+		startTime = GetCurrentTimeSeconds();
+		for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+		{
+			std::string errorText;
+			didAllDecode = DecodeBlockRuns(static_cast<uint8_t>(codec), encodedChunks[chunkIndex].data(), encodedChunks[chunkIndex].size(), CHUNK_TOTAL_BLOCKS, decodedRuns[chunkIndex], errorText) && didAllDecode;
+		}
+		double decodeSeconds = GetCurrentTimeSeconds() - startTime;
+
+		//make sure every block came back the same
+		bool didMatch = didAllDecode;
+		for (int chunkIndex = 0; chunkIndex < numChunks && didMatch; chunkIndex++)
+		{
+			uint8_t const* blockTypes = &allBlockTypes[static_cast<size_t>(chunkIndex) * CHUNK_TOTAL_BLOCKS];
+			int blockIndex = 0;
+			for (BlockRun const& run : decodedRuns[chunkIndex])
+			{
+				for (int runIndex = 0; runIndex < run.m_length && didMatch; runIndex++, blockIndex++)
+				{
+					didMatch = blockIndex < CHUNK_TOTAL_BLOCKS && blockTypes[blockIndex] == run.m_blockType;
+				}
+			}
+			didMatch = didMatch && blockIndex == CHUNK_TOTAL_BLOCKS;
+		}
+
+		double compressionRatio = static_cast<double>(allBlockTypes.size()) / static_cast<double>(totalEncodedBytes);
+		g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" %-8s %6.1f:1 (%5.2f KB/chunk), encode %7.1f MB/s, decode %7.1f MB/s%s", GetCodecName(codec), compressionRatio,
+			static_cast<double>(totalEncodedBytes) / (1024.0 * numChunks), rawMB / encodeSeconds, rawMB / decodeSeconds, didMatch ? "" : " (MISMATCH)"));
+	}
+
+	return true;
+}
+
+
+//
+//private rle functions
+//
+void ChunkCodec::EncodeRLE(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data)
+{
+	int blockIndex = 0;
+	while (blockIndex < numBlocks)
+	{
+		uint8_t runBlockType = blockTypes[blockIndex];
+		int runLength = 1;
+		while (runLength < 255 && blockIndex + runLength < numBlocks && blockTypes[blockIndex + runLength] == runBlockType)
+		{
+			runLength++;
+		}
+
+		out_data.push_back(runBlockType);
+		out_data.push_back(static_cast<uint8_t>(runLength));
+
+		blockIndex += runLength;
+	}
+}
+
+
+bool ChunkCodec::DecodeRLE(uint8_t const* data, size_t dataSize, std::vector<BlockRun>& out_runs, std::string& out_errorText)
+{
+	if ((dataSize & 1) != 0)
+	{
+		out_errorText = "ends partway through a run";
+		return false;
+	}
+
+	out_runs.reserve(dataSize / 2);
+	for (size_t readIndex = 0; readIndex < dataSize; readIndex += 2)
+	{
+		BlockRun run;
+		run.m_blockType = data[readIndex];
+		run.m_length = data[readIndex + 1];
+		out_runs.push_back(run);
+	}
+
+	return true;
+}
+
+
+//
+//private palette rle functions
+//
+void ChunkCodec::EncodePaletteRLE(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data)
+{
+	//build palette in order of first appearance
+	int paletteIndices[256];
+	for (int blockType = 0; blockType < 256; blockType++)
+	{
+		paletteIndices[blockType] = -1;
+	}
+
+	std::vector<uint8_t> palette;
+	for (int blockIndex = 0; blockIndex < numBlocks; blockIndex++)
+	{
+		uint8_t blockType = blockTypes[blockIndex];
+		if (paletteIndices[blockType] < 0)
+		{
+			paletteIndices[blockType] = static_cast<int>(palette.size());
+			palette.push_back(blockType);
+		}
+	}
+
+	//nothing to encode, but the palette still needs an entry to be valid
+	if (palette.empty())
+	{
+		out_data.push_back(0);
+		out_data.push_back(0);
+		return;
+	}
+
+	out_data.push_back(static_cast<uint8_t>(palette.size() - 1));
+	out_data.insert(out_data.end(), palette.begin(), palette.end());
+
+	//small palettes pack the index and a short run into one byte, and everything else spills into a varint
+	bool isSmallPalette = palette.size() <= 16;
+
+	int blockIndex = 0;
+	while (blockIndex < numBlocks)
+	{
+		uint8_t runBlockType = blockTypes[blockIndex];
+		int runLength = 1;
+		while (blockIndex + runLength < numBlocks && blockTypes[blockIndex + runLength] == runBlockType)
+		{
+			runLength++;
+		}
+
+		uint32_t extraLength = static_cast<uint32_t>(runLength - 1);
+		if (isSmallPalette)
+		{
+			uint8_t shortLength = extraLength < 15 ? static_cast<uint8_t>(extraLength) : 15;
+			out_data.push_back(static_cast<uint8_t>((paletteIndices[runBlockType] << 4) | shortLength));
+			if (shortLength == 15)
+			{
+				WriteVarint(extraLength - 15, out_data);
+			}
+		}
+		else
+		{
+			out_data.push_back(static_cast<uint8_t>(paletteIndices[runBlockType]));
+			WriteVarint(extraLength, out_data);
+		}
+
+		blockIndex += runLength;
+	}
+}
+
+
+bool ChunkCodec::DecodePaletteRLE(uint8_t const* data, size_t dataSize, std::vector<BlockRun>& out_runs, std::string& out_errorText)
+{
+	if (dataSize < 1)
+	{
+		out_errorText = "is missing its palette";
+		return false;
+	}
+
+	size_t paletteSize = static_cast<size_t>(data[0]) + 1;
+	if (dataSize < 1 + paletteSize)
+	{
+		out_errorText = "ends partway through its palette";
+		return false;
+	}
+
+	uint8_t const* palette = data + 1;
+	bool isSmallPalette = paletteSize <= 16;
+
+	size_t readIndex = 1 + paletteSize;
+	while (readIndex < dataSize)
+	{
+		uint32_t paletteIndex = 0;
+		uint32_t extraLength = 0;
+
+		if (isSmallPalette)
+		{
+			uint8_t token = data[readIndex++];
+			paletteIndex = token >> 4;
+			extraLength = token & 15;
+			if (extraLength == 15)
+			{
+				uint32_t longLength = 0;
+				if (!ReadVarint(data, dataSize, readIndex, longLength))
+				{
+					out_errorText = "has a damaged run length";
+					return false;
+				}
+				extraLength += longLength;
+			}
+		}
+		else
+		{
+			paletteIndex = data[readIndex++];
+			if (!ReadVarint(data, dataSize, readIndex, extraLength))
+			{
+				out_errorText = "has a damaged run length";
+				return false;
+			}
+		}
+
+		if (paletteIndex >= paletteSize)
+		{
+			out_errorText = Stringf("uses palette entry %u but the palette only has %i", paletteIndex, static_cast<int>(paletteSize));
+			return false;
+		}
+		if (extraLength >= static_cast<uint32_t>(CHUNK_TOTAL_BLOCKS))
+		{
+			out_errorText = Stringf("has a run longer than a chunk (%u blocks)", extraLength + 1);
+			return false;
+		}
+
+		BlockRun run;
+		run.m_blockType = palette[paletteIndex];
+		run.m_length = static_cast<int>(extraLength) + 1;
+		out_runs.push_back(run);
+	}
+
+	return true;
+}
+
+
+//
+//private lz functions
+//
+void ChunkCodec::EncodeLZ(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data)
+{
+	//sequences are a token (literal count and match length nibbles, 15 meaning more follows in 255-chained bytes), the literals,
+	//then a two-byte offset back into the output for the match; the last sequence is only literals
+	int hashTable[1 << CHUNK_CODEC_LZ_HASH_BITS];
+	for (int hashIndex = 0; hashIndex < (1 << CHUNK_CODEC_LZ_HASH_BITS); hashIndex++)
+	{
+		hashTable[hashIndex] = -1;
+	}
+
+	auto writeLength = [&out_data](int length)
+		{
+			while (length >= 255)
+			{
+				out_data.push_back(255);
+				length -= 255;
+			}
+			out_data.push_back(static_cast<uint8_t>(length));
+		};
+
+	auto writeSequence = [&](int literalStart, int literalLength, int matchOffset, int matchLength)
+		{
+			int extraMatchLength = matchLength > 0 ? matchLength - CHUNK_CODEC_LZ_MIN_MATCH : 0;
+			uint8_t literalNibble = literalLength < 15 ? static_cast<uint8_t>(literalLength) : 15;
+			uint8_t matchNibble = extraMatchLength < 15 ? static_cast<uint8_t>(extraMatchLength) : 15;
+			out_data.push_back(static_cast<uint8_t>((literalNibble << 4) | matchNibble));
+
+			if (literalNibble == 15)
+			{
+				writeLength(literalLength - 15);
+			}
+			out_data.insert(out_data.end(), blockTypes + literalStart, blockTypes + literalStart + literalLength);
+
+			if (matchLength > 0)
+			{
+				out_data.push_back(static_cast<uint8_t>(matchOffset));
+				out_data.push_back(static_cast<uint8_t>(matchOffset >> 8));
+				if (matchNibble == 15)
+				{
+					writeLength(extraMatchLength - 15);
+				}
+			}
+		};
+
+	int literalStart = 0;
+	int blockIndex = 0;
+	while (blockIndex + CHUNK_CODEC_LZ_MIN_MATCH <= numBlocks)
+	{
+		uint32_t sequence;
+		memcpy(&sequence, blockTypes + blockIndex, sizeof(sequence));
+		uint32_t hashIndex = (sequence * 2654435761u) >> (32 - CHUNK_CODEC_LZ_HASH_BITS);
+
+		int candidateIndex = hashTable[hashIndex];
+		hashTable[hashIndex] = blockIndex;
+
+		if (candidateIndex >= 0 && blockIndex - candidateIndex <= CHUNK_CODEC_LZ_MAX_OFFSET && memcmp(blockTypes + candidateIndex, blockTypes + blockIndex, CHUNK_CODEC_LZ_MIN_MATCH) == 0)
+		{
+			int matchLength = CHUNK_CODEC_LZ_MIN_MATCH;
+			while (blockIndex + matchLength < numBlocks && blockTypes[candidateIndex + matchLength] == blockTypes[blockIndex + matchLength])
+			{
+				matchLength++;
+			}
+
+			writeSequence(literalStart, blockIndex - literalStart, blockIndex - candidateIndex, matchLength);
+
+			blockIndex += matchLength;
+			literalStart = blockIndex;
+		}
+		else
+		{
+			blockIndex++;
+		}
+	}
+
+	writeSequence(literalStart, numBlocks - literalStart, 0, 0);
+}
+
+
+bool ChunkCodec::DecodeLZ(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockRun>& out_runs, std::string& out_errorText)
+{
+	std::vector<uint8_t> blockTypes(numBlocks);
+	int writeIndex = 0;
+
+	auto readLength = [data, dataSize](size_t& inout_readIndex, int& inout_length)
+		{
+			uint8_t lengthByte = 255;
+			while (lengthByte == 255)
+			{
+				if (inout_readIndex >= dataSize)
+				{
+					return false;
+				}
+				lengthByte = data[inout_readIndex++];
+				inout_length += lengthByte;
+			}
+			return true;
+		};
+
+	size_t readIndex = 0;
+	while (true)
+	{
+		if (readIndex >= dataSize)
+		{
+			out_errorText = "ends before its last sequence";
+			return false;
+		}
+
+		uint8_t token = data[readIndex++];
+
+		//literals
+		int literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(readIndex, literalLength))
+		{
+			out_errorText = "has a damaged literal length";
+			return false;
+		}
+		if (literalLength > numBlocks - writeIndex || static_cast<size_t>(literalLength) > dataSize - readIndex)
+		{
+			out_errorText = "has literals running past the end of the chunk or the data";
+			return false;
+		}
+
+		memcpy(blockTypes.data() + writeIndex, data + readIndex, literalLength);
+		writeIndex += literalLength;
+		readIndex += literalLength;
+
+		//a sequence with nothing after its literals is the last one
+		if (readIndex == dataSize)
+		{
+			break;
+		}
+
+		//match
+		if (dataSize - readIndex < 2)
+		{
+			out_errorText = "ends partway through a match offset";
+			return false;
+		}
+
+		int matchOffset = data[readIndex] | (data[readIndex + 1] << 8);
+		readIndex += 2;
+
+		int matchLength = token & 15;
+		if (matchLength == 15 && !readLength(readIndex, matchLength))
+		{
+			out_errorText = "has a damaged match length";
+			return false;
+		}
+		matchLength += CHUNK_CODEC_LZ_MIN_MATCH;
+
+		if (matchOffset == 0 || matchOffset > writeIndex || matchLength > numBlocks - writeIndex)
+		{
+			out_errorText = Stringf("has a bad match (offset %i, length %i at block %i)", matchOffset, matchLength, writeIndex);
+			return false;
+		}
+
+		//runs of one block type come through as offset 1, and anything else that overlaps what it's writing has to go one at a time
+		uint8_t* matchDestination = blockTypes.data() + writeIndex;
+		if (matchOffset == 1)
+		{
+			memset(matchDestination, matchDestination[-1], matchLength);
+		}
+		else if (matchOffset >= matchLength)
+		{
+			memcpy(matchDestination, matchDestination - matchOffset, matchLength);
+		}
+		else
+		{
+			for (int matchIndex = 0; matchIndex < matchLength; matchIndex++)
+			{
+				matchDestination[matchIndex] = matchDestination[matchIndex - matchOffset];
+			}
+		}
+		writeIndex += matchLength;
+	}
+
+	if (writeIndex != numBlocks)
+	{
+		out_errorText = Stringf("only covers %i of %i blocks", writeIndex, numBlocks);
+		return false;
+	}
+
+	//turn the raw block types back into runs
+	int runStartIndex = 0;
+	for (int blockIndex = 1; blockIndex <= numBlocks; blockIndex++)
+	{
+		if (blockIndex == numBlocks || blockTypes[blockIndex] != blockTypes[runStartIndex])
+		{
+			BlockRun run;
+			run.m_blockType = blockTypes[runStartIndex];
+			run.m_length = blockIndex - runStartIndex;
+			out_runs.push_back(run);
+
+			runStartIndex = blockIndex;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//private varint helpers
+//
+void ChunkCodec::WriteVarint(uint32_t value, std::vector<uint8_t>& out_data)
+{
+	//7 bits at a time, lowest first, with the high bit set on every byte but the last
+	while (value >= 0x80)
+	{
+		out_data.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out_data.push_back(static_cast<uint8_t>(value));
+}
+
+
+bool ChunkCodec::ReadVarint(uint8_t const* data, size_t dataSize, size_t& inout_readIndex, uint32_t& out_value)
+{
+	out_value = 0;
+
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (inout_readIndex >= dataSize)
+		{
+			return false;
+		}
+
+		uint8_t varintByte = data[inout_readIndex++];
+		out_value |= static_cast<uint32_t>(varintByte & 0x7F) << shift;
+		if ((varintByte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include <string>
+#include <vector>
+
+
+//codec types (each one is also the version byte written in the chunk save header)
+enum class ChunkCodecType : uint8_t
+{
+	RLE = 3,			//(block type, run length) byte pairs, runs capped at 255
+	PALETTE_RLE = 4,	//per-chunk palette, then palette index + varint run length tokens
+	LZ = 5				//LZ77-style byte-aligned compression of the raw block types
+};
+
+
+//constants
+constexpr int CHUNK_CODEC_LZ_HASH_BITS = 12;
+constexpr int CHUNK_CODEC_LZ_MIN_MATCH = 4;
+constexpr int CHUNK_CODEC_LZ_MAX_OFFSET = 0xFFFF;
+
+
+//one run of identical block types, in block index order
+struct BlockRun
+{
+	uint8_t m_blockType = 0;
+	int		m_length = 0;
+};
+
+
+//one block that differs from what the generator makes, for overlay saves
+struct BlockEdit
+{
+	int		m_blockIndex = 0;
+	uint8_t m_blockType = 0;
+};
+
+
+//which side of a block a mesh face is on (also the order a block's faces are added to its mesh)
+enum class BlockFace : uint8_t
+{
+	EAST,
+	WEST,
+	NORTH,
+	SOUTH,
+	SKYWARD,
+	DOWNWARD,
+	COUNT
+};
+
+
+//one visible block face of a finished chunk mesh, which is everything needed to rebuild its quad without looking at any neighbors
+struct ChunkMeshFace
+{
+	uint32_t m_blockIndex = 0;	//full width, so chunks can be taller than 65536 blocks (saves store the gap between faces as a varint, so they don't care)
+	BlockFace m_face = BlockFace::EAST;
+	uint8_t	 m_outdoorLight = 0;	//already mapped to the vertex color range
+	uint8_t	 m_indoorLight = 0;
+};
+
+
+//encoders and decoders for the block data part of a chunk save (everything after the header)
+//none of these touch any shared state, so they're safe to call from save and load threads
+class ChunkCodec
+{
+//public member functions
+public:
+	//encoding and decoding
+	static void EncodeBlockTypes(ChunkCodecType codec, uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data);
+	static bool DecodeBlockRuns(uint8_t version, uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockRun>& out_runs, std::string& out_errorText);
+	static void EncodeBlockEdits(std::vector<BlockEdit> const& edits, std::vector<uint8_t>& out_data);
+	static bool DecodeBlockEdits(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockEdit>& out_edits, std::string& out_errorText);
+	static void EncodeMeshFaces(std::vector<ChunkMeshFace> const& faces, std::vector<uint8_t>& out_data);
+	static bool DecodeMeshFaces(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<ChunkMeshFace>& out_faces, std::string& out_errorText);
+
+	//codec utilities
+	static bool		   IsSupportedVersion(uint8_t version);
+	static bool		   GetCodecFromName(std::string const& codecName, ChunkCodecType& out_codec);
+	static char const* GetCodecName(ChunkCodecType codec);
+	static bool		   Event_BenchmarkChunkCodecs(EventArgs& args);
+
+//private member functions
+private:
+	//rle
+	static void EncodeRLE(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data);
+	static bool DecodeRLE(uint8_t const* data, size_t dataSize, std::vector<BlockRun>& out_runs, std::string& out_errorText);
+
+	//palette rle
+	static void EncodePaletteRLE(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data);
+	static bool DecodePaletteRLE(uint8_t const* data, size_t dataSize, std::vector<BlockRun>& out_runs, std::string& out_errorText);
+
+	//lz
+	static void EncodeLZ(uint8_t const* blockTypes, int numBlocks, std::vector<uint8_t>& out_data);
+	static bool DecodeLZ(uint8_t const* data, size_t dataSize, int numBlocks, std::vector<BlockRun>& out_runs, std::string& out_errorText);
+
+	//varint helpers
+	static void WriteVarint(uint32_t value, std::vector<uint8_t>& out_data);
+	static bool ReadVarint(uint8_t const* data, size_t dataSize, size_t& inout_readIndex, uint32_t& out_value);
+};
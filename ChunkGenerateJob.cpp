@@ -3,6 +3,12 @@
 
 void ChunkGenerateJob::Execute()
 {
+	//don't bother generating anything if the player already moved away
+	if (m_chunk->m_isCancelled)
+	{
+		return;
+	}
+
 	m_chunk->m_state = ChunkState::GENERATING;
 	
 	m_chunk->PopulateBlocks();
@@ -0,0 +1,23 @@
+#include "Game/ChunkLoadJob.hpp"
+
+
+void ChunkLoadJob::Execute()
+{
+	//don't bother reading anything if the player already moved away
+	if (m_chunk->m_isCancelled)
+	{
+		return;
+	}
+
+	m_chunk->m_state = ChunkState::LOADING;
+
+	//a pending save from another seed would be another world's blocks, so that falls back to the disk copy (or the generator) too
+	bool didLoadPendingSave = m_pendingSave != nullptr && m_chunk->LoadChunkFromSnapshot(*m_pendingSave);
+	m_pendingSave.reset();
+	if (!didLoadPendingSave)
+	{
+		m_chunk->LoadChunk();
+	}
+
+	m_chunk->m_state = ChunkState::COMPLETED;
+}
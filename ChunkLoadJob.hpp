@@ -0,0 +1,23 @@
+#pragma once
+#include "Game/Chunk.hpp"
+#include "Game/ChunkSnapshot.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include <memory>
+
+
+class ChunkLoadJob : public Job
+{
+//public member functions
+public:
+	ChunkLoadJob(Chunk* chunk, std::shared_ptr<ChunkSnapshot const> const& pendingSave = nullptr)
+		: m_chunk(chunk)
+		, m_pendingSave(pendingSave)
+	{}
+
+	virtual void Execute() override;
+
+//public member variables
+public:
+	Chunk* m_chunk = nullptr;
+	std::shared_ptr<ChunkSnapshot const> m_pendingSave;	//set if the chunk was still waiting in the save queue, since the disk copy would be stale
+};
@@ -0,0 +1,28 @@
+#include "Game/ChunkMeshJob.hpp"
+#include "Engine/Core/Time.hpp"
+
+
+void ChunkMeshJob::Execute()
+{
+	double startTime = GetCurrentTimeSeconds();
+
+	//a baked mesh can be used as-is, as long as nothing it was built from has changed since
+	m_meshInputHash = m_useBakedMeshes ? m_snapshot->GetMeshInputHash() : 0;
+	m_didReuseCachedMesh = m_hasCachedMesh && m_useBakedMeshes && m_meshInputHash == m_cachedMeshInputHash;
+	if (m_didReuseCachedMesh)
+	{
+		m_meshFaces.swap(m_cachedMeshFaces);
+	}
+	else
+	{
+		m_snapshot->BuildMeshFaces(m_meshFaces);
+	}
+
+	//both meshers work from the same visible faces, so baked meshes are shared between them
+	m_snapshot->AddVertsForMeshFaces(m_verts, m_meshFaces, m_mesherType, m_useIndexedQuads);
+
+	//the sections are only needed for the build, so let go of them now instead of making the next edit copy a section for nothing
+	m_snapshot.reset();
+
+	m_buildSeconds = GetCurrentTimeSeconds() - startTime;
+}
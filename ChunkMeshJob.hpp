@@ -0,0 +1,44 @@
+#pragma once
+#include "Game/Chunk.hpp"
+#include "Game/ChunkSnapshot.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include <memory>
+#include <vector>
+
+
+//builds one chunk's mesh off the main thread, from a snapshot of the chunk and the sides of its four neighbors
+//the job never touches the live chunk, so the world can deactivate it mid-build and just throw the results away when they come back
+class ChunkMeshJob : public Job
+{
+//public member functions
+public:
+	ChunkMeshJob(IntVec2 chunkCoords, std::shared_ptr<ChunkSnapshot const> const& snapshot, ChunkMesherType mesherType, bool useIndexedQuads, bool useBakedMeshes)
+		: m_chunkCoords(chunkCoords)
+		, m_snapshot(snapshot)
+		, m_mesherType(mesherType)
+		, m_useIndexedQuads(useIndexedQuads)
+		, m_useBakedMeshes(useBakedMeshes)
+	{}
+
+	virtual void Execute() override;
+
+//public member variables
+public:
+	IntVec2								 m_chunkCoords = IntVec2();
+	std::shared_ptr<ChunkSnapshot const> m_snapshot;
+	ChunkMesherType						 m_mesherType = ChunkMesherType::PER_FACE;
+	bool								 m_useIndexedQuads = true;
+	bool								 m_useBakedMeshes = true;
+
+	//a baked mesh from a save or the chunk cache, which only gets used if the snapshot still hashes the same
+	bool					   m_hasCachedMesh = false;
+	uint64_t				   m_cachedMeshInputHash = 0;
+	std::vector<ChunkMeshFace> m_cachedMeshFaces;
+
+	//results
+	std::vector<ChunkMeshFace> m_meshFaces;
+	uint64_t				   m_meshInputHash = 0;
+	bool					   m_didReuseCachedMesh = false;
+	std::vector<Vertex_PCU>	   m_verts;	//only live until the upload, since the chunk just keeps the count
+	double					   m_buildSeconds = 0.0;
+};
@@ -0,0 +1,13 @@
+#include "Game/ChunkSaveJob.hpp"
+#include "Game/World.hpp"
+
+
+void ChunkSaveJob::Execute()
+{
+	std::vector<uint8_t> chunkBuffer;
+	m_snapshot->WriteSaveBuffer(chunkBuffer, m_world->m_saveCodec, m_world->m_useOverlaySaves);
+	m_wasSaved = m_world->WriteSavedChunk(m_chunkCoords, chunkBuffer, m_snapshot->m_worldSeed);
+
+	//let go of the snapshot now, so its sections can be freed without waiting for the main thread to claim this job
+	m_snapshot.reset();
+}
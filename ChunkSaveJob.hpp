@@ -0,0 +1,32 @@
+#pragma once
+#include "Game/ChunkSnapshot.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <memory>
+
+
+//forward declarations
+class World;
+
+
+//encodes one chunk snapshot and writes it to its region file, so flushing lots of chunks at once can use every worker
+//(the region file mutex still serializes the actual writes, but encoding is most of the work)
+class ChunkSaveJob : public Job
+{
+//public member functions
+public:
+	ChunkSaveJob(World* world, std::shared_ptr<ChunkSnapshot const> const& snapshot)
+		: m_world(world)
+		, m_snapshot(snapshot)
+		, m_chunkCoords(snapshot->m_chunkCoords)
+	{}
+
+	virtual void Execute() override;
+
+//public member variables
+public:
+	World*								 m_world = nullptr;
+	std::shared_ptr<ChunkSnapshot const> m_snapshot;
+	IntVec2								 m_chunkCoords;
+	bool								 m_wasSaved = false;
+};
@@ -0,0 +1,304 @@
+#include "Game/ChunkSaveQueue.hpp"
+#include "Game/World.hpp"
+#include "Game/RegionFile.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Time.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+//
+//public queue flow functions
+//
+void ChunkSaveQueue::Startup(World* world)
+{
+	m_world = world;
+	m_isQuitting = false;
+	m_saveThread = std::thread(&ChunkSaveQueue::ThreadMain, this);
+}
+
+
+void ChunkSaveQueue::Shutdown()
+{
+	//the thread writes out whatever is still queued before it exits
+	{
+		std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+		m_isQuitting = true;
+	}
+	m_saveQueuedCondition.notify_all();
+
+	if (m_saveThread.joinable())
+	{
+		m_saveThread.join();
+	}
+}
+
+
+uint64_t ChunkSaveQueue::QueueChunkSave(std::shared_ptr<ChunkSnapshot const> const& snapshot)
+{
+	uint64_t saveTicket = 0;
+	{
+		std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+		//a newer save of the same chunk replaces the old one, since only the latest blocks matter
+		std::pair<unsigned int, IntVec2> saveKey = std::make_pair(snapshot->m_worldSeed, snapshot->m_chunkCoords);
+		std::shared_ptr<ChunkSnapshot const>& pendingSave = m_pendingSaves[saveKey];
+		if (pendingSave != nullptr)
+		{
+			m_numSavesReplaced++;
+		}
+		pendingSave = snapshot;
+
+		saveTicket = ++m_lastSaveTicket;
+		m_pendingSaveTickets[saveKey] = saveTicket;
+	}
+
+	m_saveQueuedCondition.notify_one();
+	return saveTicket;
+}
+
+
+void ChunkSaveQueue::TakeWrittenSaves(std::vector<WrittenChunkSave>& out_writtenSaves)
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	out_writtenSaves.clear();
+	out_writtenSaves.swap(m_writtenSaves);
+}
+
+
+bool ChunkSaveQueue::GetPendingSave(IntVec2 chunkCoords, unsigned int worldSeed, std::shared_ptr<ChunkSnapshot const>& out_snapshot)
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	auto pendingSaveFound = m_pendingSaves.find(std::make_pair(worldSeed, chunkCoords));
+	if (pendingSaveFound == m_pendingSaves.end())
+	{
+		return false;
+	}
+
+	out_snapshot = pendingSaveFound->second;
+	return true;
+}
+
+
+bool ChunkSaveQueue::GetPendingSaveTicket(IntVec2 chunkCoords, unsigned int worldSeed, uint64_t& out_saveTicket)
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	auto saveTicketFound = m_pendingSaveTickets.find(std::make_pair(worldSeed, chunkCoords));
+	if (saveTicketFound == m_pendingSaveTickets.end())
+	{
+		return false;
+	}
+
+	out_saveTicket = saveTicketFound->second;
+	return true;
+}
+
+
+void ChunkSaveQueue::GetPendingSaves(std::vector<std::shared_ptr<ChunkSnapshot const>>& out_snapshots)
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	out_snapshots.clear();
+	for (auto pendingSaveIndex = m_pendingSaves.begin(); pendingSaveIndex != m_pendingSaves.end(); pendingSaveIndex++)
+	{
+		out_snapshots.push_back(pendingSaveIndex->second);
+	}
+}
+
+
+bool ChunkSaveQueue::Flush()
+{
+	std::unique_lock<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	//failed saves are retried right away instead of waiting out their backoff, so the next batch has everything still pending
+	for (auto failedSaveIndex = m_failedSaves.begin(); failedSaveIndex != m_failedSaves.end(); failedSaveIndex++)
+	{
+		failedSaveIndex->second.m_retryTime = 0.0;
+	}
+	int flushBatchNumber = m_numBatchesStarted + 1;
+	m_saveQueuedCondition.notify_one();
+
+	m_saveWrittenCondition.wait(pendingSavesLock, [this, flushBatchNumber]() { return m_pendingSaves.empty() || m_numBatchesWritten >= flushBatchNumber || !m_saveThread.joinable(); });
+	return m_failedSaves.empty() && (m_pendingSaves.empty() || m_saveThread.joinable());
+}
+
+
+//
+//public stats functions
+//
+int ChunkSaveQueue::GetNumPendingSaves()
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+	return static_cast<int>(m_pendingSaves.size());
+}
+
+
+int ChunkSaveQueue::GetNumPendingSaves(unsigned int worldSeed)
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+	int numPendingSaves = 0;
+	for (auto pendingSaveIndex = m_pendingSaves.begin(); pendingSaveIndex != m_pendingSaves.end(); pendingSaveIndex++)
+	{
+		if (pendingSaveIndex->first.first == worldSeed)
+		{
+			numPendingSaves++;
+		}
+	}
+
+	return numPendingSaves;
+}
+
+
+int ChunkSaveQueue::GetNumRetryingSaves()
+{
+	std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+	return static_cast<int>(m_failedSaves.size());
+}
+
+
+//
+//private queue flow functions
+//
+void ChunkSaveQueue::ThreadMain()
+{
+	std::vector<std::shared_ptr<ChunkSnapshot const>> batch;
+	std::vector<uint8_t> chunkBuffer;
+	std::vector<bool> wasSaved;
+
+	while (true)
+	{
+		//grab everything that's queued up as one batch, except failed saves that are still backing off
+		{
+			std::unique_lock<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+			batch.clear();
+			while (true)
+			{
+				double currentTime = GetCurrentTimeSeconds();
+				double nextRetryTime = -1.0;
+				for (auto pendingSaveIndex = m_pendingSaves.begin(); pendingSaveIndex != m_pendingSaves.end(); pendingSaveIndex++)
+				{
+					//quitting gives every failed save one last try
+					auto failedSaveFound = m_failedSaves.find(pendingSaveIndex->first);
+					if (!m_isQuitting && failedSaveFound != m_failedSaves.end() && failedSaveFound->second.m_retryTime > currentTime)
+					{
+						if (nextRetryTime < 0.0 || failedSaveFound->second.m_retryTime < nextRetryTime)
+						{
+							nextRetryTime = failedSaveFound->second.m_retryTime;
+						}
+						continue;
+					}
+
+					batch.push_back(pendingSaveIndex->second);
+				}
+
+				if (!batch.empty() || (m_isQuitting && m_pendingSaves.empty()))
+				{
+					break;
+				}
+
+				if (nextRetryTime < 0.0)
+				{
+					m_saveQueuedCondition.wait(pendingSavesLock);
+				}
+				else
+				{
+					m_saveQueuedCondition.wait_for(pendingSavesLock, std::chrono::duration<double>(nextRetryTime - currentTime));
+				}
+			}
+
+			if (batch.empty())
+			{
+				break;
+			}
+			m_numBatchesStarted++;
+		}
+
+		//write chunks region by region, so each region file only gets opened once per batch
+		std::sort(batch.begin(), batch.end(), [](std::shared_ptr<ChunkSnapshot const> const& a, std::shared_ptr<ChunkSnapshot const> const& b)
+			{
+				if (a->m_worldSeed != b->m_worldSeed) return a->m_worldSeed < b->m_worldSeed;
+				IntVec2 regionA = RegionFile::GetRegionCoordsForChunk(a->m_chunkCoords);
+				IntVec2 regionB = RegionFile::GetRegionCoordsForChunk(b->m_chunkCoords);
+				if (regionA.x != regionB.x) return regionA.x < regionB.x;
+				if (regionA.y != regionB.y) return regionA.y < regionB.y;
+				if (a->m_chunkCoords.x != b->m_chunkCoords.x) return a->m_chunkCoords.x < b->m_chunkCoords.x;
+				return a->m_chunkCoords.y < b->m_chunkCoords.y;
+			});
+
+		wasSaved.assign(batch.size(), false);
+		for (int batchIndex = 0; batchIndex < static_cast<int>(batch.size()); batchIndex++)
+		{
+			chunkBuffer.clear();
+			batch[batchIndex]->WriteSaveBuffer(chunkBuffer, m_world->m_saveCodec, m_world->m_useOverlaySaves);
+			wasSaved[batchIndex] = m_world->WriteSavedChunk(batch[batchIndex]->m_chunkCoords, chunkBuffer, batch[batchIndex]->m_worldSeed);
+		}
+
+		//only drop saves that were written and weren't replaced by a newer one in the meantime, failed ones stay queued for a retry
+		{
+			std::lock_guard<std::mutex> pendingSavesLock(m_pendingSavesMutex);
+
+			double currentTime = GetCurrentTimeSeconds();
+			for (int batchIndex = 0; batchIndex < static_cast<int>(batch.size()); batchIndex++)
+			{
+				IntVec2 chunkCoords = batch[batchIndex]->m_chunkCoords;
+				std::pair<unsigned int, IntVec2> saveKey = std::make_pair(batch[batchIndex]->m_worldSeed, chunkCoords);
+				auto pendingSaveFound = m_pendingSaves.find(saveKey);
+				bool isLatestSave = pendingSaveFound != m_pendingSaves.end() && pendingSaveFound->second == batch[batchIndex];
+
+				if (!wasSaved[batchIndex])
+				{
+					m_numFailedSaves++;
+					if (m_isQuitting)
+					{
+						//that was its last try, so there's nothing left to do but say so
+						DebuggerPrintf("Chunk %i, %i couldn't be saved before quitting, its changes are lost\n", chunkCoords.x, chunkCoords.y);
+						if (isLatestSave)
+						{
+							m_pendingSaves.erase(pendingSaveFound);
+							m_pendingSaveTickets.erase(saveKey);
+						}
+						m_failedSaves.erase(saveKey);
+						continue;
+					}
+
+					FailedChunkSave& failedSave = m_failedSaves[saveKey];
+					failedSave.m_numFailures++;
+					double retryDelay = SAVE_RETRY_MIN_SECONDS * static_cast<double>(1 << std::min(failedSave.m_numFailures - 1, 16));
+					failedSave.m_retryTime = currentTime + std::min(retryDelay, SAVE_RETRY_MAX_SECONDS);
+					DebuggerPrintf("Chunk %i, %i failed to save (%i times), retrying in %.1f s\n", chunkCoords.x, chunkCoords.y, failedSave.m_numFailures, failedSave.m_retryTime - currentTime);
+					continue;
+				}
+
+				//a replaced save isn't reported, since the chunk is waiting on the newer one's ticket
+				m_failedSaves.erase(saveKey);
+				if (isLatestSave)
+				{
+					m_pendingSaves.erase(pendingSaveFound);
+
+					auto saveTicketFound = m_pendingSaveTickets.find(saveKey);
+					WrittenChunkSave writtenSave;
+					writtenSave.m_chunkCoords = chunkCoords;
+					writtenSave.m_worldSeed = saveKey.first;
+					writtenSave.m_saveTicket = saveTicketFound->second;
+					m_writtenSaves.push_back(writtenSave);
+					m_pendingSaveTickets.erase(saveTicketFound);
+				}
+				m_numChunksSaved++;
+			}
+
+			m_numBatchesWritten++;
+		}
+		m_saveWrittenCondition.notify_all();
+
+		//let go of the snapshots so their sections can be freed
+		batch.clear();
+	}
+
+	m_saveWrittenCondition.notify_all();
+}
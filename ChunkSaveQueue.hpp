@@ -0,0 +1,86 @@
+#pragma once
+#include "Game/ChunkSnapshot.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//forward declarations
+class World;
+
+
+//failed writes stay queued and get retried, waiting twice as long after each failure
+constexpr double SAVE_RETRY_MIN_SECONDS = 0.5;
+constexpr double SAVE_RETRY_MAX_SECONDS = 30.0;
+
+
+//a chunk whose last write failed, and when to try it again
+struct FailedChunkSave
+{
+	int	   m_numFailures = 0;
+	double m_retryTime = 0.0;
+};
+
+
+//a save the thread finished writing, so the main thread can tell the chunk it's safely on disk
+struct WrittenChunkSave
+{
+	IntVec2		 m_chunkCoords = IntVec2();
+	unsigned int m_worldSeed = 0;
+	uint64_t	 m_saveTicket = 0;
+};
+
+
+//background save queue with its own I/O thread, so encoding and writing deactivated chunks never lands inside a frame
+//queued snapshots stay in the queue until they're written, so reactivating a chunk can pull its blocks from here instead of stale disk contents
+class ChunkSaveQueue
+{
+//public member functions
+public:
+	//queue flow functions
+	void Startup(World* world);
+	void Shutdown();
+	uint64_t QueueChunkSave(std::shared_ptr<ChunkSnapshot const> const& snapshot);	//returns the save's ticket, which shows up in TakeWrittenSaves once it's on disk
+	void	 TakeWrittenSaves(std::vector<WrittenChunkSave>& out_writtenSaves);
+	bool GetPendingSave(IntVec2 chunkCoords, unsigned int worldSeed, std::shared_ptr<ChunkSnapshot const>& out_snapshot);
+	bool GetPendingSaveTicket(IntVec2 chunkCoords, unsigned int worldSeed, uint64_t& out_saveTicket);
+	void GetPendingSaves(std::vector<std::shared_ptr<ChunkSnapshot const>>& out_snapshots);
+	bool Flush();	//false if anything is still waiting to be retried after failing to write
+
+	//stats functions
+	int GetNumPendingSaves();
+	int GetNumPendingSaves(unsigned int worldSeed);	//including ones waiting on a retry
+	int GetNumRetryingSaves();
+
+//private member functions
+private:
+	void ThreadMain();
+
+//public member variables
+public:
+	std::atomic<int> m_numChunksSaved = 0;
+	std::atomic<int> m_numBatchesWritten = 0;
+	std::atomic<int> m_numSavesReplaced = 0;
+	std::atomic<int> m_numFailedSaves = 0;	//failed writes, counting every retry
+
+//private member variables
+private:
+	World*		m_world = nullptr;
+	std::thread m_saveThread;
+	bool		m_isQuitting = false;
+
+	//keyed by seed too (like the world's open region files), since saves from the seed before an F9 switch can still be waiting or retrying
+	std::map<std::pair<unsigned int, IntVec2>, std::shared_ptr<ChunkSnapshot const>> m_pendingSaves;
+	std::map<std::pair<unsigned int, IntVec2>, uint64_t>	  m_pendingSaveTickets;
+	std::vector<WrittenChunkSave> m_writtenSaves;
+	uint64_t					  m_lastSaveTicket = 0;
+	std::map<std::pair<unsigned int, IntVec2>, FailedChunkSave> m_failedSaves;	//chunks whose last write failed, kept even if a newer snapshot replaces the failed one
+	int							  m_numBatchesStarted = 0;
+	std::mutex				m_pendingSavesMutex;
+	std::condition_variable m_saveQueuedCondition;
+	std::condition_variable m_saveWrittenCondition;
+};
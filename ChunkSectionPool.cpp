@@ -0,0 +1,113 @@
+#include "Game/ChunkSectionPool.hpp"
+#include <cstring>
+
+
+//static variable declaration
+std::unordered_multimap<uint64_t, std::shared_ptr<ChunkSection>> ChunkSectionPool::s_pooledSections;
+
+
+//
+//static functions
+//
+std::shared_ptr<ChunkSection> ChunkSectionPool::GetSharedSection(std::shared_ptr<ChunkSection> const& section)
+{
+	uint64_t sectionHash = GetSectionHash(*section);
+
+	//check for an identical section that's already pooled
+	auto hashRange = s_pooledSections.equal_range(sectionHash);
+	for (auto sectionIndex = hashRange.first; sectionIndex != hashRange.second; sectionIndex++)
+	{
+		if (sectionIndex->second == section)
+		{
+			return section;
+		}
+		
+		if (memcmp(sectionIndex->second->m_blocks, section->m_blocks, sizeof(ChunkSection::m_blocks)) == 0)
+		{
+			return sectionIndex->second;
+		}
+	}
+
+	//otherwise, this section becomes the pooled copy
+	s_pooledSections.emplace(sectionHash, section);
+	return section;
+}
+
+
+std::shared_ptr<ChunkSection> ChunkSectionPool::GetEmptySection()
+{
+	static std::shared_ptr<ChunkSection> const s_emptySection = std::make_shared<ChunkSection>();
+
+	return GetSharedSection(s_emptySection);
+}
+
+
+std::shared_ptr<ChunkSection> ChunkSectionPool::GetOpenSkySection()
+{
+	//air that can see the sky, with full outdoor light and no indoor light
+	static std::shared_ptr<ChunkSection> s_openSkySection;
+	if (s_openSkySection == nullptr)
+	{
+		s_openSkySection = std::make_shared<ChunkSection>();
+		for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			s_openSkySection->m_blocks[blockIndex].SetIsSky(true);
+			s_openSkySection->m_blocks[blockIndex].SetOutdoorLightLevel(15);
+		}
+	}
+
+	return GetSharedSection(s_openSkySection);
+}
+
+
+bool ChunkSectionPool::IsSectionPooled(std::shared_ptr<ChunkSection> const& section)
+{
+	auto hashRange = s_pooledSections.equal_range(GetSectionHash(*section));
+	for (auto sectionIndex = hashRange.first; sectionIndex != hashRange.second; sectionIndex++)
+	{
+		if (sectionIndex->second == section)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void ChunkSectionPool::PruneUnusedSections()
+{
+	for (auto sectionIndex = s_pooledSections.begin(); sectionIndex != s_pooledSections.end();)
+	{
+		//if the pool is the only thing left holding the section, drop it
+		if (sectionIndex->second.use_count() == 1)
+		{
+			sectionIndex = s_pooledSections.erase(sectionIndex);
+		}
+		else
+		{
+			sectionIndex++;
+		}
+	}
+}
+
+
+uint64_t ChunkSectionPool::GetSectionHash(ChunkSection const& section)
+{
+	//64-bit FNV-1a over the raw block bytes
+	uint8_t const* sectionBytes = reinterpret_cast<uint8_t const*>(section.m_blocks);
+	uint64_t hash = 14695981039346656037ULL;
+	for (int byteIndex = 0; byteIndex < sizeof(ChunkSection::m_blocks); byteIndex++)
+	{
+		hash ^= sectionBytes[byteIndex];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+int ChunkSectionPool::GetNumPooledSections()
+{
+	return static_cast<int>(s_pooledSections.size());
+}
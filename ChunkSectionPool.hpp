@@ -0,0 +1,25 @@
+#pragma once
+#include "Game/Chunk.hpp"
+#include <memory>
+#include <unordered_map>
+
+
+//content-hashed registry of immutable chunk sections, so identical sections (open sky, ocean, etc.) across chunks share one copy
+//the pool holds a reference to every section in it, so a chunk writing into a pooled section always copies it first
+//only used from the main thread
+class ChunkSectionPool
+{
+//public member functions
+public:
+	static std::shared_ptr<ChunkSection> GetSharedSection(std::shared_ptr<ChunkSection> const& section);
+	static std::shared_ptr<ChunkSection> GetEmptySection();
+	static std::shared_ptr<ChunkSection> GetOpenSkySection();
+	static bool		IsSectionPooled(std::shared_ptr<ChunkSection> const& section);
+	static void		PruneUnusedSections();
+	static uint64_t GetSectionHash(ChunkSection const& section);
+	static int		GetNumPooledSections();
+
+//public member variables
+public:
+	static std::unordered_multimap<uint64_t, std::shared_ptr<ChunkSection>> s_pooledSections;
+};
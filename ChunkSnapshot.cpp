@@ -0,0 +1,737 @@
+#include "Game/ChunkSnapshot.hpp"
+#include "Game/BlockDefinition.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include <cstring>
+
+
+//
+//public block accessors
+//
+Block const* ChunkSnapshot::GetBlock(int blockIndex) const
+{
+	ChunkSection const* section = m_sections[blockIndex >> CHUNK_SECTION_BITS].get();
+	
+	return &section->m_blocks[blockIndex & (CHUNK_SECTION_TOTAL_BLOCKS - 1)];
+}
+
+
+uint8_t ChunkSnapshot::GetBlockType(int blockIndex) const
+{
+	return GetBlock(blockIndex)->m_blockType;
+}
+
+
+bool ChunkSnapshot::IsBlockOpaque(int blockIndex) const
+{
+	int blockDefIndex = GetBlock(blockIndex)->m_blockType;
+
+	return BlockDefinition::s_blockDefs[blockDefIndex].m_isOpaque;
+}
+
+
+//
+//public neighbor accessors
+//
+bool ChunkSnapshot::GetEastNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localX = blockIndex & (CHUNK_SIZE_X - 1);
+	if (localX < CHUNK_MAX_X)
+	{
+		out_block = GetBlock(blockIndex + 1);
+		return true;
+	}
+
+	if (m_eastNeighbor == nullptr)
+	{
+		return false;
+	}
+
+	out_block = m_eastNeighbor->GetBlock(blockIndex - CHUNK_MAX_X);
+	return true;
+}
+
+
+bool ChunkSnapshot::GetWestNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localX = blockIndex & (CHUNK_SIZE_X - 1);
+	if (localX > 0)
+	{
+		out_block = GetBlock(blockIndex - 1);
+		return true;
+	}
+
+	if (m_westNeighbor == nullptr)
+	{
+		return false;
+	}
+
+	out_block = m_westNeighbor->GetBlock(blockIndex + CHUNK_MAX_X);
+	return true;
+}
+
+
+bool ChunkSnapshot::GetNorthNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localY = (blockIndex >> CHUNK_BITS_X) & (CHUNK_SIZE_Y - 1);
+	if (localY < CHUNK_MAX_Y)
+	{
+		out_block = GetBlock(blockIndex + CHUNK_SIZE_X);
+		return true;
+	}
+
+	if (m_northNeighbor == nullptr)
+	{
+		return false;
+	}
+
+	out_block = m_northNeighbor->GetBlock(blockIndex - (CHUNK_MAX_Y << CHUNK_BITS_X));
+	return true;
+}
+
+
+bool ChunkSnapshot::GetSouthNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localY = (blockIndex >> CHUNK_BITS_X) & (CHUNK_SIZE_Y - 1);
+	if (localY > 0)
+	{
+		out_block = GetBlock(blockIndex - CHUNK_SIZE_X);
+		return true;
+	}
+
+	if (m_southNeighbor == nullptr)
+	{
+		return false;
+	}
+
+	out_block = m_southNeighbor->GetBlock(blockIndex + (CHUNK_MAX_Y << CHUNK_BITS_X));
+	return true;
+}
+
+
+bool ChunkSnapshot::GetSkywardNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+	if (localZ == CHUNK_MAX_Z)
+	{
+		return false;
+	}
+
+	out_block = GetBlock(blockIndex + CHUNK_LAYER_SIZE);
+	return true;
+}
+
+
+bool ChunkSnapshot::GetDownwardNeighborBlock(int blockIndex, Block const*& out_block) const
+{
+	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+	if (localZ == 0)
+	{
+		return false;
+	}
+
+	out_block = GetBlock(blockIndex - CHUNK_LAYER_SIZE);
+	return true;
+}
+
+
+//
+//public save functions
+//
+void ChunkSnapshot::WriteSaveBuffer(std::vector<uint8_t>& out_chunkBuffer, ChunkCodecType codec, bool allowOverlay) const
+{
+	out_chunkBuffer.clear();
+	out_chunkBuffer.reserve(CHUNK_SAVE_HEADER_SIZE + 4096);
+
+	//gather block types, lighting, and sky flags a section at a time
+	std::vector<uint8_t> blockTypes(CHUNK_TOTAL_BLOCKS);
+	std::vector<uint8_t> lightingValues(CHUNK_TOTAL_BLOCKS);
+	std::vector<uint8_t> skyFlags(CHUNK_TOTAL_BLOCKS);
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		Block const* sectionBlocks = m_sections[sectionIndex]->m_blocks;
+		int sectionStartIndex = sectionIndex << CHUNK_SECTION_BITS;
+		for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			Block const& block = sectionBlocks[blockIndex];
+			blockTypes[sectionStartIndex + blockIndex] = block.m_blockType;
+			lightingValues[sectionStartIndex + blockIndex] = block.m_lighting;
+			skyFlags[sectionStartIndex + blockIndex] = block.m_bitFlags & BLOCK_BIT_IS_SKY;
+		}
+	}
+
+	//save header (the version byte says which codec the blocks are in, and whether lighting and the mesh were saved too)
+	uint8_t versionByte = static_cast<uint8_t>(codec) | (m_hasSettledLighting ? CHUNK_SAVE_LIGHTING_FLAG : 0) | (m_hasBakedMesh ? CHUNK_SAVE_MESH_FLAG : 0);
+	uint8_t const header[CHUNK_SAVE_HEADER_SIZE] =
+	{
+		'G', 'C', 'H', 'K',
+		versionByte,
+		static_cast<uint8_t>(CHUNK_BITS_X), static_cast<uint8_t>(CHUNK_BITS_Y), static_cast<uint8_t>(CHUNK_BITS_Z),
+		static_cast<uint8_t>(m_worldSeed), static_cast<uint8_t>(m_worldSeed >> 8), static_cast<uint8_t>(m_worldSeed >> 16), static_cast<uint8_t>(m_worldSeed >> 24)
+	};
+	out_chunkBuffer.insert(out_chunkBuffer.end(), header, header + CHUNK_SAVE_HEADER_SIZE);
+
+	//lighting that's still being worked on can't be trusted later, so it's only saved once it's settled
+	//(the codecs work on any per-block bytes, and lighting and sky flags have long runs just like block types)
+	auto writeUint32 = [&out_chunkBuffer](uint32_t value)
+		{
+			out_chunkBuffer.push_back(static_cast<uint8_t>(value));
+			out_chunkBuffer.push_back(static_cast<uint8_t>(value >> 8));
+			out_chunkBuffer.push_back(static_cast<uint8_t>(value >> 16));
+			out_chunkBuffer.push_back(static_cast<uint8_t>(value >> 24));
+		};
+
+	if (m_hasSettledLighting)
+	{
+		std::vector<uint8_t> lightingData;
+		ChunkCodec::EncodeBlockTypes(ChunkCodecType::PALETTE_RLE, lightingValues.data(), CHUNK_TOTAL_BLOCKS, lightingData);
+		std::vector<uint8_t> skyData;
+		ChunkCodec::EncodeBlockTypes(ChunkCodecType::PALETTE_RLE, skyFlags.data(), CHUNK_TOTAL_BLOCKS, skyData);
+
+		writeUint32(Chunk::GetLightingStamp());
+		writeUint32(static_cast<uint32_t>(lightingData.size()));
+		out_chunkBuffer.insert(out_chunkBuffer.end(), lightingData.begin(), lightingData.end());
+		writeUint32(static_cast<uint32_t>(skyData.size()));
+		out_chunkBuffer.insert(out_chunkBuffer.end(), skyData.begin(), skyData.end());
+	}
+
+	//the baked mesh lets a warm start skip meshing, as long as the hash of everything it was built from still matches on load
+	if (m_hasBakedMesh)
+	{
+		std::vector<uint8_t> meshData;
+		ChunkCodec::EncodeMeshFaces(m_meshFaces, meshData);
+
+		writeUint32(Chunk::GetMeshStamp());
+		writeUint32(static_cast<uint32_t>(m_meshInputHash));
+		writeUint32(static_cast<uint32_t>(m_meshInputHash >> 32));
+		writeUint32(static_cast<uint32_t>(meshData.size()));
+		out_chunkBuffer.insert(out_chunkBuffer.end(), meshData.begin(), meshData.end());
+	}
+
+	//if we know what the generator made, try storing just the blocks that are different from it
+	if (allowOverlay && m_isGeneratedBaselineKnown)
+	{
+		std::vector<BlockEdit> blockEdits;
+		for (auto generatedBlock = m_generatedBlockTypes.begin(); generatedBlock != m_generatedBlockTypes.end(); generatedBlock++)
+		{
+			//blocks changed back to what was generated don't need saving
+			if (blockTypes[generatedBlock->first] != generatedBlock->second)
+			{
+				BlockEdit edit;
+				edit.m_blockIndex = generatedBlock->first;
+				edit.m_blockType = blockTypes[generatedBlock->first];
+				blockEdits.push_back(edit);
+			}
+		}
+
+		std::vector<uint8_t> editData;
+		ChunkCodec::EncodeBlockEdits(blockEdits, editData);
+
+		//a heavily edited chunk can end up smaller saved in full, so only use the overlay when it actually wins
+		std::vector<uint8_t> fullData;
+		ChunkCodec::EncodeBlockTypes(codec, blockTypes.data(), CHUNK_TOTAL_BLOCKS, fullData);
+		if (editData.size() + 4 < fullData.size())
+		{
+			out_chunkBuffer[4] = CHUNK_SAVE_OVERLAY_VERSION | (versionByte & (CHUNK_SAVE_LIGHTING_FLAG | CHUNK_SAVE_MESH_FLAG));
+			writeUint32(Chunk::GetGeneratorStamp());
+			out_chunkBuffer.insert(out_chunkBuffer.end(), editData.begin(), editData.end());
+		}
+		else
+		{
+			out_chunkBuffer.insert(out_chunkBuffer.end(), fullData.begin(), fullData.end());
+		}
+
+		return;
+	}
+
+	ChunkCodec::EncodeBlockTypes(codec, blockTypes.data(), CHUNK_TOTAL_BLOCKS, out_chunkBuffer);
+}
+
+
+
+//
+//public mesh functions
+//
+void ChunkSnapshot::BuildMeshFaces(std::vector<ChunkMeshFace>& faces) const
+{
+	faces.clear();
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		//skip over sections with nothing to draw (usually the sky), or that are too far away to be resident
+		if (m_sectionVisibleCounts[sectionIndex] == 0 || !m_isSectionResident[sectionIndex])
+		{
+			continue;
+		}
+
+		int firstBlockIndex = sectionIndex << CHUNK_SECTION_BITS;
+		for (int blockIndex = firstBlockIndex; blockIndex < firstBlockIndex + CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			AddFacesForBlock(faces, blockIndex);
+		}
+	}
+}
+
+
+void ChunkSnapshot::AddVertsForMeshFaces(std::vector<Vertex_PCU>& verts, std::vector<ChunkMeshFace> const& faces, ChunkMesherType mesher, bool useIndexedQuads) const
+{
+	if (mesher == ChunkMesherType::GREEDY)
+	{
+		AddVertsForGreedyFaces(verts, faces, useIndexedQuads);
+		return;
+	}
+
+	for (int faceIndex = 0; faceIndex < static_cast<int>(faces.size()); faceIndex++)
+	{
+		AddVertsForFace(verts, faces[faceIndex], useIndexedQuads);
+	}
+}
+
+
+uint64_t ChunkSnapshot::GetMeshInputHash() const
+{
+	//64-bit FNV-1a over the types and lighting of every block the mesh looks at: this chunk's resident sections and the neighbor blocks touching its sides
+	//(sky and dirty-lighting flags don't change the mesh, so they're left out)
+	uint64_t hash = 14695981039346656037ULL;
+	auto addToHash = [&hash](uint32_t value)
+		{
+			hash = (hash ^ value) * 1099511628211ULL;
+		};
+	auto addBlockToHash = [&addToHash](Block const* block)
+		{
+			addToHash(static_cast<uint32_t>(block->m_blockType) | (static_cast<uint32_t>(block->m_lighting) << 8));
+		};
+
+	addToHash(static_cast<uint32_t>(g_enableHiddenSurfaceRemoval));
+	for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+	{
+		addToHash(static_cast<uint32_t>(m_isSectionResident[sectionIndex]));
+		if (!m_isSectionResident[sectionIndex])
+		{
+			continue;
+		}
+
+		Block const* sectionBlocks = GetBlock(sectionIndex << CHUNK_SECTION_BITS);
+		for (int blockIndex = 0; blockIndex < CHUNK_SECTION_TOTAL_BLOCKS; blockIndex++)
+		{
+			addBlockToHash(&sectionBlocks[blockIndex]);
+		}
+	}
+
+	ChunkSnapshot const* sideNeighbors[4] = { m_eastNeighbor.get(), m_westNeighbor.get(), m_northNeighbor.get(), m_southNeighbor.get() };
+	for (int neighborIndex = 0; neighborIndex < 4; neighborIndex++)
+	{
+		addToHash(sideNeighbors[neighborIndex] != nullptr ? 1 : 0);
+	}
+
+	//only the neighbor blocks beside sections that actually get meshed matter (and touching the rest could restore evicted sections for nothing)
+	for (int blockZ = 0; blockZ < CHUNK_SIZE_Z; blockZ++)
+	{
+		int sectionIndex = blockZ / CHUNK_SECTION_SIZE_Z;
+		if (m_sectionVisibleCounts[sectionIndex] == 0 || !m_isSectionResident[sectionIndex])
+		{
+			continue;
+		}
+
+		for (int blockY = 0; blockY < CHUNK_SIZE_Y; blockY++)
+		{
+			if (m_eastNeighbor != nullptr) addBlockToHash(m_eastNeighbor->GetBlock(Chunk::GetBlockIndexFromLocalCoords(0, blockY, blockZ)));
+			if (m_westNeighbor != nullptr) addBlockToHash(m_westNeighbor->GetBlock(Chunk::GetBlockIndexFromLocalCoords(CHUNK_MAX_X, blockY, blockZ)));
+		}
+		for (int blockX = 0; blockX < CHUNK_SIZE_X; blockX++)
+		{
+			if (m_northNeighbor != nullptr) addBlockToHash(m_northNeighbor->GetBlock(Chunk::GetBlockIndexFromLocalCoords(blockX, 0, blockZ)));
+			if (m_southNeighbor != nullptr) addBlockToHash(m_southNeighbor->GetBlock(Chunk::GetBlockIndexFromLocalCoords(blockX, CHUNK_MAX_Y, blockZ)));
+		}
+	}
+
+	return hash;
+}
+
+
+//
+//private mesh functions
+//
+void ChunkSnapshot::AddFacesForBlock(std::vector<ChunkMeshFace>& faces, int blockIndex) const
+{
+	BlockDefinition const* blockDef = BlockDefinition::GetBlockDefFromID(GetBlock(blockIndex)->m_blockType);
+	if (!blockDef->m_isVisible)
+	{
+		return;
+	}
+
+	bool drawWestFace = true;
+	bool drawEastFace = true;
+	bool drawSouthFace = true;
+	bool drawNorthFace = true;
+	bool drawDownwardFace = true;
+	bool drawSkywardFace = true;
+
+	Block const* eastNeighbor = nullptr;
+	Block const* westNeighbor = nullptr;
+	Block const* northNeighbor = nullptr;
+	Block const* southNeighbor = nullptr;
+	Block const* skywardNeighbor = nullptr;
+	Block const* downwardNeighbor = nullptr;
+	bool hasEastNeighbor = GetEastNeighborBlock(blockIndex, eastNeighbor);
+	bool hasWestNeighbor = GetWestNeighborBlock(blockIndex, westNeighbor);
+	bool hasNorthNeighbor = GetNorthNeighborBlock(blockIndex, northNeighbor);
+	bool hasSouthNeighbor = GetSouthNeighborBlock(blockIndex, southNeighbor);
+	bool hasSkywardNeighbor = GetSkywardNeighborBlock(blockIndex, skywardNeighbor);
+	bool hasDownwardNeighbor = GetDownwardNeighborBlock(blockIndex, downwardNeighbor);
+
+	if (g_enableHiddenSurfaceRemoval)	//only bother with checking surrounding blocks if hidden surface removal is turned on
+	{
+		//check west (-x) block
+		if (hasWestNeighbor)
+		{
+			BlockDefinition const* westBlockDef = BlockDefinition::GetBlockDefFromID(westNeighbor->m_blockType);
+			if (westBlockDef->m_isOpaque)
+			{
+				drawWestFace = false;
+			}
+		}
+
+		//check east (+x) block
+		if (hasEastNeighbor)
+		{
+			BlockDefinition const* eastBlockDef = BlockDefinition::GetBlockDefFromID(eastNeighbor->m_blockType);
+			if (eastBlockDef->m_isOpaque)
+			{
+				drawEastFace = false;
+			}
+		}
+
+		//check south (-y) block
+		if (hasSouthNeighbor)
+		{
+			BlockDefinition const* southBlockDef = BlockDefinition::GetBlockDefFromID(southNeighbor->m_blockType);
+			if (southBlockDef->m_isOpaque)
+			{
+				drawSouthFace = false;
+			}
+		}
+
+		//check north (+y) block
+		if (hasNorthNeighbor)
+		{
+			BlockDefinition const* northBlockDef = BlockDefinition::GetBlockDefFromID(northNeighbor->m_blockType);
+			if (northBlockDef->m_isOpaque)
+			{
+				drawNorthFace = false;
+			}
+		}
+
+		//check downward (-z) block
+		if (hasDownwardNeighbor)
+		{
+			BlockDefinition const* downwardBlockDef = BlockDefinition::GetBlockDefFromID(downwardNeighbor->m_blockType);
+			if (downwardBlockDef->m_isOpaque)
+			{
+				drawDownwardFace = false;
+			}
+		}
+
+		//check skyward (+z) block
+		if (hasSkywardNeighbor)
+		{
+			BlockDefinition const* skywardBlockDef = BlockDefinition::GetBlockDefFromID(skywardNeighbor->m_blockType);
+			if (skywardBlockDef->m_isOpaque)
+			{
+				drawSkywardFace = false;
+			}
+		}
+	}
+
+	//get light values of surrounding blocks
+	unsigned char westOutdoorLightValue = 0;
+	unsigned char westIndoorLightValue = 0;
+	unsigned char eastOutdoorLightValue = 0;
+	unsigned char eastIndoorLightValue = 0;
+	unsigned char northOutdoorLightValue = 0;
+	unsigned char northIndoorLightValue = 0;
+	unsigned char southOutdoorLightValue = 0;
+	unsigned char southIndoorLightValue = 0;
+	unsigned char skywardOutdoorLightValue = 0;
+	unsigned char skywardIndoorLightValue = 0;
+	unsigned char downwardOutdoorLightValue = 0;
+	unsigned char downwardIndoorLightValue = 0;
+
+	if (hasEastNeighbor && drawEastFace)
+	{
+		eastOutdoorLightValue = eastNeighbor->GetOutdoorLightLevel();
+		float eastOutdoorLightValueNormalized = NormalizeByte(eastOutdoorLightValue);
+		eastOutdoorLightValueNormalized = RangeMapClamped(eastOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		eastOutdoorLightValue = DenormalizeByte(eastOutdoorLightValueNormalized);
+
+		eastIndoorLightValue = eastNeighbor->GetIndoorLightLevel();
+		float eastIndoorLightValueNormalized = NormalizeByte(eastIndoorLightValue);
+		eastIndoorLightValueNormalized = RangeMapClamped(eastIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		eastIndoorLightValue = DenormalizeByte(eastIndoorLightValueNormalized);
+	}
+	if (hasWestNeighbor && drawWestFace)
+	{
+		westOutdoorLightValue = westNeighbor->GetOutdoorLightLevel();
+		float westOutdoorLightValueNormalized = NormalizeByte(westOutdoorLightValue);
+		westOutdoorLightValueNormalized = RangeMapClamped(westOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		westOutdoorLightValue = DenormalizeByte(westOutdoorLightValueNormalized);
+
+		westIndoorLightValue = westNeighbor->GetIndoorLightLevel();
+		float westIndoorLightValueNormalized = NormalizeByte(westIndoorLightValue);
+		westIndoorLightValueNormalized = RangeMapClamped(westIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		westIndoorLightValue = DenormalizeByte(westIndoorLightValueNormalized);
+	}
+	if (hasNorthNeighbor && drawNorthFace)
+	{
+		northOutdoorLightValue = northNeighbor->GetOutdoorLightLevel();
+		float northOutdoorLightValueNormalized = NormalizeByte(northOutdoorLightValue);
+		northOutdoorLightValueNormalized = RangeMapClamped(northOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		northOutdoorLightValue = DenormalizeByte(northOutdoorLightValueNormalized);
+
+		northIndoorLightValue = northNeighbor->GetIndoorLightLevel();
+		float northIndoorLightValueNormalized = NormalizeByte(northIndoorLightValue);
+		northIndoorLightValueNormalized = RangeMapClamped(northIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		northIndoorLightValue = DenormalizeByte(northIndoorLightValueNormalized);
+	}
+	if (hasSouthNeighbor && drawSouthFace)
+	{
+		southOutdoorLightValue = southNeighbor->GetOutdoorLightLevel();
+		float southOutdoorLightValueNormalized = NormalizeByte(southOutdoorLightValue);
+		southOutdoorLightValueNormalized = RangeMapClamped(southOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		southOutdoorLightValue = DenormalizeByte(southOutdoorLightValueNormalized);
+
+		southIndoorLightValue = southNeighbor->GetIndoorLightLevel();
+		float southIndoorLightValueNormalized = NormalizeByte(southIndoorLightValue);
+		southIndoorLightValueNormalized = RangeMapClamped(southIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		southIndoorLightValue = DenormalizeByte(southIndoorLightValueNormalized);
+	}
+	if (hasSkywardNeighbor && drawSkywardFace)
+	{
+		skywardOutdoorLightValue = skywardNeighbor->GetOutdoorLightLevel();
+		float skywardOutdoorLightValueNormalized = NormalizeByte(skywardOutdoorLightValue);
+		skywardOutdoorLightValueNormalized = RangeMapClamped(skywardOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		skywardOutdoorLightValue = DenormalizeByte(skywardOutdoorLightValueNormalized);
+
+		skywardIndoorLightValue = skywardNeighbor->GetIndoorLightLevel();
+		float skywardIndoorLightValueNormalized = NormalizeByte(skywardIndoorLightValue);
+		skywardIndoorLightValueNormalized = RangeMapClamped(skywardIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		skywardIndoorLightValue = DenormalizeByte(skywardIndoorLightValueNormalized);
+	}
+	if (hasDownwardNeighbor && drawDownwardFace)
+	{
+		downwardOutdoorLightValue = downwardNeighbor->GetOutdoorLightLevel();
+		float downwardOutdoorLightValueNormalized = NormalizeByte(downwardOutdoorLightValue);
+		downwardOutdoorLightValueNormalized = RangeMapClamped(downwardOutdoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		downwardOutdoorLightValue = DenormalizeByte(downwardOutdoorLightValueNormalized);
+
+		downwardIndoorLightValue = downwardNeighbor->GetIndoorLightLevel();
+		float downwardIndoorLightValueNormalized = NormalizeByte(downwardIndoorLightValue);
+		downwardIndoorLightValueNormalized = RangeMapClamped(downwardIndoorLightValueNormalized, 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+		downwardIndoorLightValue = DenormalizeByte(downwardIndoorLightValueNormalized);
+	}
+	
+	auto addFace = [&faces, blockIndex](BlockFace face, unsigned char outdoorLightValue, unsigned char indoorLightValue)
+		{
+			ChunkMeshFace meshFace;
+			meshFace.m_blockIndex = static_cast<uint32_t>(blockIndex);
+			meshFace.m_face = face;
+			meshFace.m_outdoorLight = outdoorLightValue;
+			meshFace.m_indoorLight = indoorLightValue;
+			faces.push_back(meshFace);
+		};
+
+	if (drawEastFace)
+	{
+		addFace(BlockFace::EAST, eastOutdoorLightValue, eastIndoorLightValue);
+	}
+	if (drawWestFace)
+	{
+		addFace(BlockFace::WEST, westOutdoorLightValue, westIndoorLightValue);
+	}
+	if (drawNorthFace)
+	{
+		addFace(BlockFace::NORTH, northOutdoorLightValue, northIndoorLightValue);
+	}
+	if (drawSouthFace)
+	{
+		addFace(BlockFace::SOUTH, southOutdoorLightValue, southIndoorLightValue);
+	}
+	if (drawSkywardFace)
+	{
+		addFace(BlockFace::SKYWARD, skywardOutdoorLightValue, skywardIndoorLightValue);
+	}
+	if (drawDownwardFace)
+	{
+		addFace(BlockFace::DOWNWARD, downwardOutdoorLightValue, downwardIndoorLightValue);
+	}
+}
+
+
+void ChunkSnapshot::AddVertsForFace(std::vector<Vertex_PCU>& verts, ChunkMeshFace const& face, bool useIndexedQuads) const
+{
+	int blockIndex = static_cast<int>(face.m_blockIndex);
+	int localX = blockIndex & (CHUNK_SIZE_X - 1);
+	int localY = (blockIndex >> CHUNK_BITS_X) & (CHUNK_SIZE_Y - 1);
+	int localZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+
+	IntVec3 blockMins = IntVec3(localX, localY, localZ);
+	IntVec3 blockMaxs = IntVec3(localX + 1, localY + 1, localZ + 1);
+	uint8_t outdoorLightLevel = ChunkVertex::GetLightLevelFromColorValue(face.m_outdoorLight);
+	uint8_t indoorLightLevel = ChunkVertex::GetLightLevelFromColorValue(face.m_indoorLight);
+	AddVertsForBoxFace(verts, m_chunkCoords, blockMins, blockMaxs, face.m_face, GetSpriteIndexForFace(face), outdoorLightLevel, indoorLightLevel, IntVec2(1, 1), false, useIndexedQuads);
+}
+
+
+void ChunkSnapshot::AddVertsForGreedyFaces(std::vector<Vertex_PCU>& verts, std::vector<ChunkMeshFace> const& faces, bool useIndexedQuads) const
+{
+	//every face direction gets its own set of slices through the chunk (one per block layer along the face normal), and each slice is a grid of face keys
+	//a key is the sprite and both light values plus one, so faces only merge when they'd look identical, and zero means no face
+	//merging clears every cell it uses, so the grid is all zeroes again by the time it's done and can be kept around per thread
+	thread_local std::vector<uint32_t> s_faceKeys(static_cast<size_t>(BlockFace::COUNT) * CHUNK_TOTAL_BLOCKS, 0);
+	bool isSliceUsed[static_cast<int>(BlockFace::COUNT)][CHUNK_SIZE_Z] = {};
+
+	//slice axis, then the two axes across the slice (a runs fastest), as local x/y/z indices
+	static int const s_sliceAxes[static_cast<int>(BlockFace::COUNT)][3] =
+	{
+		{ 0, 1, 2 },	//east
+		{ 0, 1, 2 },	//west
+		{ 1, 0, 2 },	//north
+		{ 1, 0, 2 },	//south
+		{ 2, 0, 1 },	//skyward
+		{ 2, 0, 1 }		//downward
+	};
+	static int const s_axisSizes[3] = { CHUNK_SIZE_X, CHUNK_SIZE_Y, CHUNK_SIZE_Z };
+
+	for (int faceIndex = 0; faceIndex < static_cast<int>(faces.size()); faceIndex++)
+	{
+		ChunkMeshFace const& face = faces[faceIndex];
+		int blockIndex = static_cast<int>(face.m_blockIndex);
+		int localCoords[3] = { blockIndex & CHUNK_MAX_X, (blockIndex >> CHUNK_BITS_X) & CHUNK_MAX_Y, blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y) };
+		int direction = static_cast<int>(face.m_face);
+		int const* axes = s_sliceAxes[direction];
+		int slice = localCoords[axes[0]];
+		int cellIndex = (slice * s_axisSizes[axes[1]] * s_axisSizes[axes[2]]) + (localCoords[axes[2]] * s_axisSizes[axes[1]]) + localCoords[axes[1]];
+
+		uint32_t faceKey = 1 + ((static_cast<uint32_t>(GetSpriteIndexForFace(face)) << 16) | (static_cast<uint32_t>(face.m_outdoorLight) << 8) | face.m_indoorLight);
+		s_faceKeys[(direction * CHUNK_TOTAL_BLOCKS) + cellIndex] = faceKey;
+		isSliceUsed[direction][slice] = true;
+	}
+
+	for (int direction = 0; direction < static_cast<int>(BlockFace::COUNT); direction++)
+	{
+		int const* axes = s_sliceAxes[direction];
+		int sizeA = s_axisSizes[axes[1]];
+		int sizeB = s_axisSizes[axes[2]];
+		for (int slice = 0; slice < s_axisSizes[axes[0]]; slice++)
+		{
+			if (!isSliceUsed[direction][slice])
+			{
+				continue;
+			}
+
+			uint32_t* sliceKeys = s_faceKeys.data() + (direction * CHUNK_TOTAL_BLOCKS) + (slice * sizeA * sizeB);
+			for (int cellB = 0; cellB < sizeB; cellB++)
+			{
+				for (int cellA = 0; cellA < sizeA; cellA++)
+				{
+					uint32_t faceKey = sliceKeys[(cellB * sizeA) + cellA];
+					if (faceKey == 0)
+					{
+						continue;
+					}
+
+					//grow along a as far as the key matches, then along b for as long as the whole row matches
+					int width = 1;
+					while (cellA + width < sizeA && width < CHUNK_GREEDY_MAX_QUAD_TILES && sliceKeys[(cellB * sizeA) + cellA + width] == faceKey)
+					{
+						width++;
+					}
+					int height = 1;
+					bool canGrow = true;
+					while (canGrow && cellB + height < sizeB && height < CHUNK_GREEDY_MAX_QUAD_TILES)
+					{
+						for (int rowA = cellA; rowA < cellA + width && canGrow; rowA++)
+						{
+							canGrow = sliceKeys[((cellB + height) * sizeA) + rowA] == faceKey;
+						}
+						height += canGrow ? 1 : 0;
+					}
+					for (int rowB = cellB; rowB < cellB + height; rowB++)
+					{
+						memset(sliceKeys + (rowB * sizeA) + cellA, 0, width * sizeof(uint32_t));
+					}
+
+					//the merged rectangle as a box of blocks, whose face on this side is the quad
+					IntVec3 boxMins = IntVec3(0, 0, 0);
+					IntVec3 boxSize = IntVec3(1, 1, 1);
+					int* boxMinsAxes[3] = { &boxMins.x, &boxMins.y, &boxMins.z };
+					int* boxSizeAxes[3] = { &boxSize.x, &boxSize.y, &boxSize.z };
+					*boxMinsAxes[axes[0]] = slice;
+					*boxMinsAxes[axes[1]] = cellA;
+					*boxMinsAxes[axes[2]] = cellB;
+					*boxSizeAxes[axes[1]] = width;
+					*boxSizeAxes[axes[2]] = height;
+
+					//uvs count whole tiles from the corner the per-face quad puts its sprite's uv mins at (ChunkVertex::BuildVertex offsets them into the sprite's own stride)
+					int spriteIndex = static_cast<int>((faceKey - 1) >> 16);
+					BlockFace blockFace = static_cast<BlockFace>(direction);
+					bool isHorizontalFace = blockFace == BlockFace::SKYWARD || blockFace == BlockFace::DOWNWARD;
+					IntVec2 tileCounts = isHorizontalFace ? IntVec2(boxSize.y, boxSize.x) : IntVec2(blockFace == BlockFace::NORTH || blockFace == BlockFace::SOUTH ? boxSize.x : boxSize.y, boxSize.z);
+
+					uint8_t outdoorLightLevel = ChunkVertex::GetLightLevelFromColorValue(static_cast<uint8_t>((faceKey - 1) >> 8));
+					uint8_t indoorLightLevel = ChunkVertex::GetLightLevelFromColorValue(static_cast<uint8_t>(faceKey - 1));
+					AddVertsForBoxFace(verts, m_chunkCoords, boxMins, IntVec3(boxMins.x + boxSize.x, boxMins.y + boxSize.y, boxMins.z + boxSize.z), blockFace, spriteIndex, outdoorLightLevel, indoorLightLevel, tileCounts, true, useIndexedQuads);
+				}
+			}
+		}
+	}
+}
+
+
+int ChunkSnapshot::GetSpriteIndexForFace(ChunkMeshFace const& face) const
+{
+	BlockDefinition const* blockDef = BlockDefinition::GetBlockDefFromID(GetBlock(static_cast<int>(face.m_blockIndex))->m_blockType);
+	if (face.m_face == BlockFace::SKYWARD)
+	{
+		return blockDef->m_topSpriteIndex;
+	}
+	if (face.m_face == BlockFace::DOWNWARD)
+	{
+		return blockDef->m_bottomSpriteIndex;
+	}
+	return blockDef->m_sideSpriteIndex;
+}
+
+
+void ChunkSnapshot::AddVertsForBoxFace(std::vector<Vertex_PCU>& verts, IntVec2 const& chunkCoords, IntVec3 const& boxMins, IntVec3 const& boxMaxs, BlockFace face, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, IntVec2 const& tileCounts, bool hasTiledUVs, bool isIndexed)
+{
+	IntVec3 bottomLeftBack = IntVec3(boxMins.x, boxMaxs.y, boxMins.z);
+	IntVec3 bottomRightBack = IntVec3(boxMins.x, boxMins.y, boxMins.z);
+	IntVec3 topLeftBack = IntVec3(boxMins.x, boxMaxs.y, boxMaxs.z);
+	IntVec3 topRightBack = IntVec3(boxMins.x, boxMins.y, boxMaxs.z);
+	IntVec3 bottomLeftFront = IntVec3(boxMaxs.x, boxMaxs.y, boxMins.z);
+	IntVec3 bottomRightFront = IntVec3(boxMaxs.x, boxMins.y, boxMins.z);
+	IntVec3 topLeftFront = IntVec3(boxMaxs.x, boxMaxs.y, boxMaxs.z);
+	IntVec3 topRightFront = IntVec3(boxMaxs.x, boxMins.y, boxMaxs.z);
+
+	//the quad's bottom left, bottom right, top left and top right corners, as seen from outside the face
+	IntVec3 corners[4];
+	switch (face)
+	{
+		case BlockFace::EAST:		corners[0] = bottomRightFront;	corners[1] = bottomLeftFront;	corners[2] = topRightFront;	corners[3] = topLeftFront;	break;	//+x (east) face
+		case BlockFace::WEST:		corners[0] = bottomLeftBack;	corners[1] = bottomRightBack;	corners[2] = topLeftBack;	corners[3] = topRightBack;	break;	//-x (west) face
+		case BlockFace::NORTH:		corners[0] = bottomLeftFront;	corners[1] = bottomLeftBack;	corners[2] = topLeftFront;	corners[3] = topLeftBack;	break;	//+y (north) face
+		case BlockFace::SOUTH:		corners[0] = bottomRightBack;	corners[1] = bottomRightFront;	corners[2] = topRightBack;	corners[3] = topRightFront;	break;	//-y (south) face
+		case BlockFace::SKYWARD:	corners[0] = topLeftBack;		corners[1] = topRightBack;		corners[2] = topLeftFront;	corners[3] = topRightFront;	break;	//+z (skyward) face
+		case BlockFace::DOWNWARD:	corners[0] = bottomLeftFront;	corners[1] = bottomRightFront;	corners[2] = bottomLeftBack;	corners[3] = bottomRightBack;	break;	//-z (downward) face
+		default:					return;
+	}
+
+	//indexed quads are just their 4 corners, and unindexed ones repeat corners to make the same two triangles AddVertsForQuad3D makes
+	int numQuadVerts = isIndexed ? 4 : 6;
+	for (int quadVertIndex = 0; quadVertIndex < numQuadVerts; quadVertIndex++)
+	{
+		int corner = isIndexed ? quadVertIndex : CHUNK_QUAD_TRIANGLE_CORNERS[quadVertIndex];
+		IntVec2 cornerTiles = IntVec2((corner & 1) * tileCounts.x, (corner >> 1) * tileCounts.y);
+		verts.push_back(ChunkVertex::BuildVertex(chunkCoords, corners[corner], cornerTiles, spriteIndex, outdoorLightLevel, indoorLightLevel, hasTiledUVs));
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Game/Chunk.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/ChunkVertex.hpp"
+#include <memory>
+
+
+//read-only, versioned view of a chunk's blocks that worker jobs can hold onto while the main thread keeps editing the live chunk
+//snapshots pin the chunk's sections, so the next write to a pinned section copies just that section instead of blocking or tearing the reader
+class ChunkSnapshot
+{
+	friend class Chunk;
+
+//public member functions
+public:
+	//block accessors
+	Block const* GetBlock(int blockIndex) const;
+	uint8_t		 GetBlockType(int blockIndex) const;
+	bool		 IsBlockOpaque(int blockIndex) const;
+
+	//neighbor accessors (follow the same rules as block iterators, so they return false when the neighbor isn't available)
+	bool GetEastNeighborBlock(int blockIndex, Block const*& out_block) const;
+	bool GetWestNeighborBlock(int blockIndex, Block const*& out_block) const;
+	bool GetNorthNeighborBlock(int blockIndex, Block const*& out_block) const;
+	bool GetSouthNeighborBlock(int blockIndex, Block const*& out_block) const;
+	bool GetSkywardNeighborBlock(int blockIndex, Block const*& out_block) const;
+	bool GetDownwardNeighborBlock(int blockIndex, Block const*& out_block) const;
+
+	//save functions (safe to call off the main thread, since snapshots never change)
+	void WriteSaveBuffer(std::vector<uint8_t>& out_chunkBuffer, ChunkCodecType codec, bool allowOverlay = false) const;
+
+	//mesh functions (same deal, but only for snapshots from Chunk::TakeMeshSnapshot, which pin every section a mesh build reads)
+	void	 BuildMeshFaces(std::vector<ChunkMeshFace>& faces) const;
+	void	 AddVertsForMeshFaces(std::vector<Vertex_PCU>& verts, std::vector<ChunkMeshFace> const& faces, ChunkMesherType mesher, bool useIndexedQuads) const;
+	uint64_t GetMeshInputHash() const;
+
+//private member functions
+private:
+	//mesh functions
+	void AddFacesForBlock(std::vector<ChunkMeshFace>& faces, int blockIndex) const;
+	void AddVertsForFace(std::vector<Vertex_PCU>& verts, ChunkMeshFace const& face, bool useIndexedQuads) const;
+	void AddVertsForGreedyFaces(std::vector<Vertex_PCU>& verts, std::vector<ChunkMeshFace> const& faces, bool useIndexedQuads) const;
+	int	 GetSpriteIndexForFace(ChunkMeshFace const& face) const;
+
+	static void AddVertsForBoxFace(std::vector<Vertex_PCU>& verts, IntVec2 const& chunkCoords, IntVec3 const& boxMins, IntVec3 const& boxMaxs, BlockFace face, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, IntVec2 const& tileCounts, bool hasTiledUVs, bool isIndexed);
+
+//public member variables
+public:
+	IntVec2		 m_chunkCoords = IntVec2();
+	unsigned int m_worldSeed = 0;
+	unsigned int m_version = 0;
+	bool		 m_hasSettledLighting = false;	//true if the chunk was active with no dirty lighting, so its lighting is worth keeping
+
+	bool					   m_hasBakedMesh = false;	//true if the chunk's finished mesh came along too (only with settled lighting)
+	uint64_t				   m_meshInputHash = 0;
+	std::vector<ChunkMeshFace> m_meshFaces;
+
+	bool				   m_isGeneratedBaselineKnown = false;
+	std::map<int, uint8_t> m_generatedBlockTypes;
+
+	std::shared_ptr<ChunkSection const> m_sections[CHUNK_NUM_SECTIONS];
+
+	//only filled out by Chunk::TakeSnapshotWithNeighbors and Chunk::TakeMeshSnapshot
+	std::shared_ptr<ChunkSnapshot const> m_eastNeighbor;
+	std::shared_ptr<ChunkSnapshot const> m_westNeighbor;
+	std::shared_ptr<ChunkSnapshot const> m_northNeighbor;
+	std::shared_ptr<ChunkSnapshot const> m_southNeighbor;
+
+	//only filled out by Chunk::TakeMeshSnapshot (sections that aren't meshed or next to a meshed one can be left null)
+	bool m_isSectionResident[CHUNK_NUM_SECTIONS] = {};
+	int	 m_sectionVisibleCounts[CHUNK_NUM_SECTIONS] = {};
+};
@@ -0,0 +1,138 @@
+#include "Game/ChunkVertex.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Renderer/SpriteSheet.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+
+//the packed layout only has room for chunks, quads and sprite sheets up to these sizes
+static_assert(CHUNK_SIZE_X < 32 && CHUNK_SIZE_Y < 32 && CHUNK_SIZE_Z < (1 << CHUNK_VERTEX_Z_BITS), "chunk vertexes can't hold local positions for chunks this big");
+static_assert(CHUNK_SIZE_X < (1 << CHUNK_VERTEX_CORNER_U_BITS) && CHUNK_SIZE_Y < (1 << CHUNK_VERTEX_CORNER_U_BITS), "greedy quads can't cover more horizontal tiles than a corner's u can hold");
+static_assert(CHUNK_SIZE_Z < (1 << CHUNK_VERTEX_CORNER_V_BITS), "greedy quads can't cover more vertical tiles than a corner's v can hold");
+static_assert(WORLD_SPRITE_SHEET_WIDTH * WORLD_SPRITE_SHEET_HEIGHT <= (1 << CHUNK_VERTEX_SPRITE_BITS), "chunk vertexes can't address every sprite in the world sprite sheet");
+
+
+ChunkVertex::ChunkVertex(IntVec3 const& localPosition, IntVec2 const& cornerTiles, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, bool hasTiledUVs)
+{
+	m_position = static_cast<uint32_t>(localPosition.x) | (static_cast<uint32_t>(localPosition.y) << 5) | (static_cast<uint32_t>(localPosition.z) << 10);
+	m_position |= static_cast<uint32_t>(cornerTiles.x) << (10 + CHUNK_VERTEX_Z_BITS);
+
+	m_spriteAndLight = static_cast<uint32_t>(spriteIndex) | (static_cast<uint32_t>(outdoorLightLevel & 0x0F) << CHUNK_VERTEX_SPRITE_BITS) | (static_cast<uint32_t>(indoorLightLevel & 0x0F) << (CHUNK_VERTEX_SPRITE_BITS + 4));
+	m_spriteAndLight |= hasTiledUVs ? (1u << (CHUNK_VERTEX_SPRITE_BITS + 8)) : 0u;
+	m_spriteAndLight |= static_cast<uint32_t>(cornerTiles.y) << (CHUNK_VERTEX_SPRITE_BITS + 9);
+}
+
+
+//
+//public accessors
+//
+IntVec3 ChunkVertex::GetLocalPosition() const
+{
+	return IntVec3(static_cast<int>(m_position & 0x1F), static_cast<int>((m_position >> 5) & 0x1F), static_cast<int>((m_position >> 10) & ((1u << CHUNK_VERTEX_Z_BITS) - 1)));
+}
+
+
+IntVec2 ChunkVertex::GetCornerTiles() const
+{
+	int cornerU = static_cast<int>((m_position >> (10 + CHUNK_VERTEX_Z_BITS)) & ((1u << CHUNK_VERTEX_CORNER_U_BITS) - 1));
+	int cornerV = static_cast<int>((m_spriteAndLight >> (CHUNK_VERTEX_SPRITE_BITS + 9)) & ((1u << CHUNK_VERTEX_CORNER_V_BITS) - 1));
+	return IntVec2(cornerU, cornerV);
+}
+
+
+int ChunkVertex::GetSpriteIndex() const
+{
+	return static_cast<int>(m_spriteAndLight & ((1u << CHUNK_VERTEX_SPRITE_BITS) - 1));
+}
+
+
+uint8_t ChunkVertex::GetOutdoorLightLevel() const
+{
+	return static_cast<uint8_t>((m_spriteAndLight >> CHUNK_VERTEX_SPRITE_BITS) & 0x0F);
+}
+
+
+uint8_t ChunkVertex::GetIndoorLightLevel() const
+{
+	return static_cast<uint8_t>((m_spriteAndLight >> (CHUNK_VERTEX_SPRITE_BITS + 4)) & 0x0F);
+}
+
+
+bool ChunkVertex::HasTiledUVs() const
+{
+	return ((m_spriteAndLight >> (CHUNK_VERTEX_SPRITE_BITS + 8)) & 1u) != 0;
+}
+
+
+//
+//public decoding functions
+//
+Vertex_PCU ChunkVertex::Decode(IntVec2 const& chunkCoords) const
+{
+	return BuildVertex(chunkCoords, GetLocalPosition(), GetCornerTiles(), GetSpriteIndex(), GetOutdoorLightLevel(), GetIndoorLightLevel(), HasTiledUVs());
+}
+
+
+void ChunkVertex::DecodeVerts(std::vector<ChunkVertex> const& verts, IntVec2 const& chunkCoords, std::vector<Vertex_PCU>& out_verts)
+{
+	out_verts.clear();
+	out_verts.reserve(verts.size());
+	for (int vertIndex = 0; vertIndex < static_cast<int>(verts.size()); vertIndex++)
+	{
+		out_verts.push_back(verts[vertIndex].Decode(chunkCoords));
+	}
+}
+
+
+Vertex_PCU ChunkVertex::BuildVertex(IntVec2 const& chunkCoords, IntVec3 const& localPosition, IntVec2 const& cornerTiles, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, bool hasTiledUVs)
+{
+	Vec3 position = Vec3(static_cast<float>((chunkCoords.x * CHUNK_SIZE_X) + localPosition.x), static_cast<float>((chunkCoords.y * CHUNK_SIZE_Y) + localPosition.y), static_cast<float>(localPosition.z));
+	Rgba8 color = Rgba8(GetColorValueFromLightLevel(outdoorLightLevel), GetColorValueFromLightLevel(indoorLightLevel), 255);
+
+	//tiled quads count tiles from the sprite's coords in uv stride units (see CHUNK_GREEDY_UV_SPRITE_STRIDE), and per-face quads just pick a corner of the sprite's uvs
+	Vec2 uv;
+	if (hasTiledUVs)
+	{
+		Vec2 spriteOrigin = Vec2(static_cast<float>(spriteIndex % WORLD_SPRITE_SHEET_WIDTH), static_cast<float>(spriteIndex / WORLD_SPRITE_SHEET_WIDTH)) * CHUNK_GREEDY_UV_SPRITE_STRIDE;
+		uv = spriteOrigin + Vec2(static_cast<float>(cornerTiles.x), static_cast<float>(cornerTiles.y));
+	}
+	else
+	{
+		AABB2 spriteUVs = g_worldSpriteSheet->GetSpriteUVs(spriteIndex);
+		uv.x = (cornerTiles.x == 0) ? spriteUVs.m_mins.x : spriteUVs.m_maxs.x;
+		uv.y = (cornerTiles.y == 0) ? spriteUVs.m_mins.y : spriteUVs.m_maxs.y;
+	}
+
+	return Vertex_PCU(position, color, uv);
+}
+
+
+void ChunkVertex::AddIndexesForQuads(std::vector<unsigned int>& indexes, int numQuads)
+{
+	indexes.reserve(indexes.size() + (static_cast<size_t>(numQuads) * 6));
+	for (int quadIndex = 0; quadIndex < numQuads; quadIndex++)
+	{
+		unsigned int firstVertIndex = static_cast<unsigned int>(quadIndex) * 4;
+		for (int triangleCornerIndex = 0; triangleCornerIndex < 6; triangleCornerIndex++)
+		{
+			indexes.push_back(firstVertIndex + static_cast<unsigned int>(CHUNK_QUAD_TRIANGLE_CORNERS[triangleCornerIndex]));
+		}
+	}
+}
+
+
+//
+//public light utilities
+//
+uint8_t ChunkVertex::GetLightLevelFromColorValue(uint8_t colorValue)
+{
+	return static_cast<uint8_t>(((static_cast<int>(colorValue) * 15) + 127) / 255);
+}
+
+
+uint8_t ChunkVertex::GetColorValueFromLightLevel(uint8_t lightLevel)
+{
+	//the same mapping the mesher uses when it reads a neighbor's light, so levels round trip to the exact color value
+	float lightValueNormalized = RangeMapClamped(NormalizeByte(lightLevel), 0.0f, (15.0f / 255.0f), 0.0f, 1.0f);
+	return DenormalizeByte(lightValueNormalized);
+}
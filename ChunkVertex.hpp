@@ -0,0 +1,57 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/Vertex_PCU.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include "Engine/Math/IntVec3.hpp"
+#include <vector>
+
+
+//packed layout, lowest bits first
+//position word: chunk-local x and y (5 bits each, since corners can sit on the chunk's far edge), local z (11 bits), corner u in tiles from the quad's uv mins (5 bits), then 6 spare bits
+//sprite word: sprite index (12 bits), outdoor and indoor light levels (4 bits each), tiled uv flag, corner v in tiles from the quad's uv mins (11 bits)
+constexpr int CHUNK_VERTEX_Z_BITS = 11;
+constexpr int CHUNK_VERTEX_CORNER_U_BITS = 5;
+constexpr int CHUNK_VERTEX_CORNER_V_BITS = 11;
+constexpr int CHUNK_VERTEX_SPRITE_BITS = 12;
+
+//quad corners are bottom left, bottom right, top left, top right (as seen from the front), and these are their two triangles
+//unindexed quads repeat corners in this order, and the shared quad index buffer points at them in the same order
+constexpr int CHUNK_QUAD_TRIANGLE_CORNERS[6] = { 0, 1, 3, 0, 3, 2 };
+
+
+//one corner of a chunk mesh quad, packed into 8 bytes (a third of a Vertex_PCU)
+//block faces only ever need small integer positions inside their chunk, a corner, a sprite and two light levels, so everything else is rebuilt when the vertex is decoded
+//the world shader can't read this layout yet, so meshers build Vertex_PCU straight from the same fields with BuildVertex instead of packing and decoding every vert
+class ChunkVertex
+{
+//public member functions
+public:
+	ChunkVertex() = default;
+	ChunkVertex(IntVec3 const& localPosition, IntVec2 const& cornerTiles, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, bool hasTiledUVs);
+
+	//accessors
+	IntVec3 GetLocalPosition() const;
+	IntVec2 GetCornerTiles() const;
+	int		GetSpriteIndex() const;
+	uint8_t GetOutdoorLightLevel() const;
+	uint8_t GetIndoorLightLevel() const;
+	bool	HasTiledUVs() const;
+
+	//decoding (expands to exactly the Vertex_PCU the mesher builds from the same fields, so it's also how tests check packed verts)
+	Vertex_PCU		  Decode(IntVec2 const& chunkCoords) const;
+	static void		  DecodeVerts(std::vector<ChunkVertex> const& verts, IntVec2 const& chunkCoords, std::vector<Vertex_PCU>& out_verts);
+	static Vertex_PCU BuildVertex(IntVec2 const& chunkCoords, IntVec3 const& localPosition, IntVec2 const& cornerTiles, int spriteIndex, uint8_t outdoorLightLevel, uint8_t indoorLightLevel, bool hasTiledUVs);
+
+	//indexed quads (4 verts each, all drawn through one index buffer built by this)
+	static void AddIndexesForQuads(std::vector<unsigned int>& indexes, int numQuads);
+
+	//light utilities (levels are 0-15, color values are what mesh faces and vertex colors hold)
+	static uint8_t GetLightLevelFromColorValue(uint8_t colorValue);
+	static uint8_t GetColorValueFromLightLevel(uint8_t lightLevel);
+
+//public member variables
+public:
+	uint32_t m_position = 0;
+	uint32_t m_spriteAndLight = 0;
+};
+static_assert(sizeof(ChunkVertex) == 8, "chunk vertexes are meant to pack into 8 bytes");
@@ -0,0 +1,476 @@
+#include "Game/EditJournal.hpp"
+#include "Game/World.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/BlockDefinition.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Time.hpp"
+#include <ctime>
+#include <io.h>
+
+
+//
+//public journal flow functions
+//
+void EditJournal::Startup(World* world)
+{
+	m_world = world;
+	m_batch.clear();
+	m_editedChunks.clear();
+	m_compactingChunks.clear();
+	m_isCompacting = false;
+	m_lastFlushTime = GetCurrentTimeSeconds();
+
+	//anything still in a journal means the game didn't shut down cleanly, so get those edits into the chunk saves before anything loads
+	ReplayLeftoverJournals();
+
+	OpenNewJournal();
+	FlushBatch();
+}
+
+
+void EditJournal::Shutdown()
+{
+	FlushBatch();
+
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+
+	//a journal with nothing in it isn't worth leaving around
+	if (m_journalSizeBytes <= EDIT_JOURNAL_HEADER_SIZE && !m_isCompacting && m_world != nullptr)
+	{
+		std::remove(GetJournalFilePath(m_world->m_worldSeed).c_str());
+	}
+}
+
+
+void EditJournal::Update()
+{
+	static double flushIntervalSeconds = static_cast<double>(g_gameConfigBlackboard.GetValue("editJournalFlushSeconds", 0.5f));
+	static int maxBatchEdits = g_gameConfigBlackboard.GetValue("editJournalMaxBatchEdits", 64);
+	static int compactionSizeBytes = g_gameConfigBlackboard.GetValue("editJournalCompactKB", 64) * 1024;
+
+	if (!m_batch.empty())
+	{
+		bool isBatchFull = GetNumBufferedEdits() >= maxBatchEdits;
+		bool isBatchDue = GetCurrentTimeSeconds() - m_lastFlushTime >= flushIntervalSeconds;
+		if (isBatchFull || isBatchDue)
+		{
+			FlushBatch();
+		}
+	}
+
+	if (m_isCompacting)
+	{
+		UpdateCompaction();
+	}
+	else if (m_journalSizeBytes >= compactionSizeBytes * (1 + m_numFailedCompactions))
+	{
+		BeginCompaction();
+	}
+}
+
+
+void EditJournal::RecordEdit(IntVec2 chunkCoords, int blockIndex, uint8_t oldBlockType, uint8_t newBlockType)
+{
+	int worldX = (chunkCoords.x * CHUNK_SIZE_X) + (blockIndex & CHUNK_MAX_X);
+	int worldY = (chunkCoords.y * CHUNK_SIZE_Y) + ((blockIndex >> CHUNK_BITS_X) & CHUNK_MAX_Y);
+	int worldZ = blockIndex >> (CHUNK_BITS_X + CHUNK_BITS_Y);
+	uint32_t timestamp = static_cast<uint32_t>(std::time(nullptr));
+
+	uint8_t record[EDIT_JOURNAL_RECORD_SIZE] =
+	{
+		static_cast<uint8_t>(worldX), static_cast<uint8_t>(worldX >> 8), static_cast<uint8_t>(worldX >> 16), static_cast<uint8_t>(worldX >> 24),
+		static_cast<uint8_t>(worldY), static_cast<uint8_t>(worldY >> 8), static_cast<uint8_t>(worldY >> 16), static_cast<uint8_t>(worldY >> 24),
+		static_cast<uint8_t>(worldZ), static_cast<uint8_t>(worldZ >> 8), static_cast<uint8_t>(worldZ >> 16), static_cast<uint8_t>(worldZ >> 24),
+		oldBlockType, newBlockType, 0, 0,
+		static_cast<uint8_t>(timestamp), static_cast<uint8_t>(timestamp >> 8), static_cast<uint8_t>(timestamp >> 16), static_cast<uint8_t>(timestamp >> 24)
+	};
+
+	//check byte lets a replay tell a real record from a half-written one at the end of the file
+	uint8_t checkByte = 0xA5;
+	for (int byteIndex = 0; byteIndex < EDIT_JOURNAL_RECORD_SIZE; byteIndex++)
+	{
+		checkByte ^= record[byteIndex];
+	}
+	record[14] = checkByte;
+
+	m_batch.insert(m_batch.end(), record, record + EDIT_JOURNAL_RECORD_SIZE);
+	m_editedChunks.insert(chunkCoords);
+	m_numEditsRecorded++;
+}
+
+
+void EditJournal::FlushBatch()
+{
+	m_lastFlushTime = GetCurrentTimeSeconds();
+
+	if (m_batch.empty())
+	{
+		return;
+	}
+
+	if (m_file == nullptr)
+	{
+		DebuggerPrintf("Edit journal isn't open, so %i edits won't survive a crash\n", GetNumBufferedEdits());
+		m_batch.clear();
+		return;
+	}
+
+	//one sequential append per batch, pushed out to the OS so it survives the game crashing
+	bool wasWriteSuccessful = fwrite(m_batch.data(), 1, m_batch.size(), m_file) == m_batch.size();
+	wasWriteSuccessful = (fflush(m_file) == 0) && wasWriteSuccessful;
+	if (!wasWriteSuccessful)
+	{
+		//the batch stays buffered, so the next flush tries it again
+		DebuggerPrintf("Couldn't append %i edits to the edit journal, trying again next flush\n", GetNumBufferedEdits());
+		TruncateToLastRecord();
+		return;
+	}
+
+	m_journalSizeBytes += static_cast<int>(m_batch.size());
+	m_batch.clear();
+	m_numBatchesFlushed++;
+}
+
+
+void EditJournal::Reset()
+{
+	//only called once every chunk has been saved and the save queue is empty, so everything journaled so far is already on disk
+	//a save that's still failing means it isn't, so both journals stay until it goes through or the edits get replayed next time
+	if (m_world->m_chunkSaveQueue.GetNumRetryingSaves() > 0)
+	{
+		DebuggerPrintf("Chunk saves are still failing, keeping the edit journal\n");
+		FlushBatch();
+		return;
+	}
+
+	m_batch.clear();
+	m_world->FlushRegionFiles();
+
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+	std::remove(GetCompactingJournalFilePath(m_world->m_worldSeed).c_str());
+
+	m_editedChunks.clear();
+	m_compactingChunks.clear();
+	m_isCompacting = false;
+
+	OpenNewJournal();
+}
+
+
+void EditJournal::OnChunkSaveWritten(WrittenChunkSave const& writtenSave)
+{
+	//tickets only go up, so a newer save of the chunk covers everything the one it replaced would have
+	auto chunkFound = m_compactingChunks.find(writtenSave.m_chunkCoords);
+	if (chunkFound != m_compactingChunks.end() && writtenSave.m_saveTicket >= chunkFound->second)
+	{
+		m_compactingChunks.erase(chunkFound);
+	}
+}
+
+
+//
+//public stats functions
+//
+int EditJournal::GetJournalSizeBytes() const
+{
+	return m_journalSizeBytes;
+}
+
+
+int EditJournal::GetNumBufferedEdits() const
+{
+	return static_cast<int>(m_batch.size()) / EDIT_JOURNAL_RECORD_SIZE;
+}
+
+
+//
+//static journal utilities
+//
+std::string EditJournal::GetJournalFilePath(unsigned int worldSeed)
+{
+	return Stringf("Saves/World_%u/Edits.journal", worldSeed);
+}
+
+
+std::string EditJournal::GetCompactingJournalFilePath(unsigned int worldSeed)
+{
+	return Stringf("Saves/World_%u/Edits.old.journal", worldSeed);
+}
+
+
+bool EditJournal::ReadJournalFile(std::string const& filePath, unsigned int worldSeed, std::vector<JournalEdit>& out_edits)
+{
+	FILE* file = nullptr;
+	fopen_s(&file, filePath.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	uint8_t header[EDIT_JOURNAL_HEADER_SIZE] = {};
+	bool isHeaderValid = fread(header, 1, EDIT_JOURNAL_HEADER_SIZE, file) == EDIT_JOURNAL_HEADER_SIZE;
+	isHeaderValid = isHeaderValid && header[0] == 'G' && header[1] == 'E' && header[2] == 'J' && header[3] == 'L' && (header[4] == EDIT_JOURNAL_VERSION || header[4] == 1);
+
+	unsigned int journalWorldSeed = static_cast<unsigned int>(header[8]) | (static_cast<unsigned int>(header[9]) << 8) | (static_cast<unsigned int>(header[10]) << 16) | (static_cast<unsigned int>(header[11]) << 24);
+	if (!isHeaderValid || journalWorldSeed != worldSeed)
+	{
+		DebuggerPrintf("Edit journal %s has a bad header, ignoring it\n", filePath.c_str());
+		fclose(file);
+		return false;
+	}
+
+	//journals left over from before z got 4 bytes are still replayed, since they can hold edits that never made it into a save
+	bool isVersion1 = header[4] == 1;
+	int recordSize = isVersion1 ? EDIT_JOURNAL_V1_RECORD_SIZE : EDIT_JOURNAL_RECORD_SIZE;
+	int typesOffset = isVersion1 ? 9 : 12;
+	int timestampOffset = isVersion1 ? 12 : 16;
+	auto readUint32 = [](uint8_t const* bytes)
+		{
+			return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+		};
+
+	//read records until the end of the file, or until one was only partly written when the game went down
+	uint8_t record[EDIT_JOURNAL_RECORD_SIZE];
+	while (fread(record, 1, recordSize, file) == static_cast<size_t>(recordSize))
+	{
+		uint8_t checkByte = 0xA5;
+		for (int byteIndex = 0; byteIndex < recordSize; byteIndex++)
+		{
+			checkByte ^= record[byteIndex];
+		}
+		int worldZ = isVersion1 ? static_cast<int>(record[8]) : static_cast<int>(readUint32(record + 8));
+		if (checkByte != 0 || worldZ < 0 || worldZ >= CHUNK_SIZE_Z)
+		{
+			DebuggerPrintf("Edit journal %s has a damaged record, ignoring everything after it\n", filePath.c_str());
+			break;
+		}
+
+		JournalEdit edit;
+		edit.m_worldX = static_cast<int>(readUint32(record));
+		edit.m_worldY = static_cast<int>(readUint32(record + 4));
+		edit.m_worldZ = worldZ;
+		edit.m_oldBlockType = record[typesOffset];
+		edit.m_newBlockType = record[typesOffset + 1];
+		edit.m_timestamp = readUint32(record + timestampOffset);
+		out_edits.push_back(edit);
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+//
+//private journal flow functions
+//
+bool EditJournal::OpenNewJournal()
+{
+	std::string journalFilePath = GetJournalFilePath(m_world->m_worldSeed);
+	fopen_s(&m_file, journalFilePath.c_str(), "wb");
+	if (m_file == nullptr)
+	{
+		DebuggerPrintf("Couldn't open edit journal %s\n", journalFilePath.c_str());
+		m_journalSizeBytes = 0;
+		return false;
+	}
+
+	unsigned int worldSeed = m_world->m_worldSeed;
+	uint8_t const header[EDIT_JOURNAL_HEADER_SIZE] =
+	{
+		'G', 'E', 'J', 'L',
+		EDIT_JOURNAL_VERSION, 0, 0, 0,
+		static_cast<uint8_t>(worldSeed), static_cast<uint8_t>(worldSeed >> 8), static_cast<uint8_t>(worldSeed >> 16), static_cast<uint8_t>(worldSeed >> 24)
+	};
+	fwrite(header, 1, EDIT_JOURNAL_HEADER_SIZE, m_file);
+	fflush(m_file);
+
+	m_journalSizeBytes = EDIT_JOURNAL_HEADER_SIZE;
+	return true;
+}
+
+
+void EditJournal::TruncateToLastRecord()
+{
+	//a short append can leave part of a record at the end, and replay stops at the first bad record, so everything appended after it would be lost
+	//the file gets cut back to the last whole record instead (closing it first, so nothing half-written is still sitting in the stdio buffer)
+	std::string journalFilePath = GetJournalFilePath(m_world->m_worldSeed);
+	fclose(m_file);
+	m_file = nullptr;
+
+	FILE* file = nullptr;
+	fopen_s(&file, journalFilePath.c_str(), "r+b");
+	bool wasTruncated = file != nullptr && _chsize_s(_fileno(file), m_journalSizeBytes) == 0;
+	if (file != nullptr)
+	{
+		fclose(file);
+	}
+	if (!wasTruncated)
+	{
+		//appending behind a torn record would only add edits a replay can't reach, so the journal stays closed and edits just go out with chunk saves
+		DebuggerPrintf("Couldn't cut edit journal %s back to its last whole record, closing it\n", journalFilePath.c_str());
+		return;
+	}
+
+	fopen_s(&m_file, journalFilePath.c_str(), "ab");
+	if (m_file == nullptr)
+	{
+		DebuggerPrintf("Couldn't reopen edit journal %s\n", journalFilePath.c_str());
+	}
+}
+
+
+void EditJournal::ReplayLeftoverJournals()
+{
+	unsigned int worldSeed = m_world->m_worldSeed;
+	std::string journalFilePath = GetJournalFilePath(worldSeed);
+	std::string compactingJournalFilePath = GetCompactingJournalFilePath(worldSeed);
+
+	//a journal that was mid-compaction is older than the current one, so it goes first
+	std::vector<JournalEdit> journalEdits;
+	ReadJournalFile(compactingJournalFilePath, worldSeed, journalEdits);
+	ReadJournalFile(journalFilePath, worldSeed, journalEdits);
+
+	//group edits by chunk, keeping them in the order they were made
+	std::map<IntVec2, std::vector<JournalEdit>> editsByChunk;
+	for (int editIndex = 0; editIndex < static_cast<int>(journalEdits.size()); editIndex++)
+	{
+		JournalEdit const& edit = journalEdits[editIndex];
+		editsByChunk[IntVec2(edit.m_worldX >> CHUNK_BITS_X, edit.m_worldY >> CHUNK_BITS_Y)].push_back(edit);
+	}
+
+	//load each chunk the normal way, replay its edits on top, and save it straight back
+	int numChunksReplayed = 0;
+	int numEditsReplayed = 0;
+	for (auto chunkEdits = editsByChunk.begin(); chunkEdits != editsByChunk.end(); chunkEdits++)
+	{
+		Chunk* chunk = new Chunk(chunkEdits->first, m_world);
+		chunk->LoadChunk();
+
+		//a record can pass its check byte and still name a block type this build doesn't have (say, a journal from a build with more blocks)
+		std::vector<JournalEdit> edits;
+		for (int editIndex = 0; editIndex < static_cast<int>(chunkEdits->second.size()); editIndex++)
+		{
+			JournalEdit const& edit = chunkEdits->second[editIndex];
+			if (edit.m_newBlockType >= BlockDefinition::s_blockDefs.size())
+			{
+				DebuggerPrintf("Journaled edit at %i, %i, %i has unknown block type %i, skipping it\n", edit.m_worldX, edit.m_worldY, edit.m_worldZ, static_cast<int>(edit.m_newBlockType));
+				continue;
+			}
+			edits.push_back(edit);
+		}
+
+		for (int editIndex = 0; editIndex < static_cast<int>(edits.size()); editIndex++)
+		{
+			int blockIndex = chunk->GetBlockIndexFromLocalCoords(edits[editIndex].m_worldX & CHUNK_MAX_X, edits[editIndex].m_worldY & CHUNK_MAX_Y, edits[editIndex].m_worldZ);
+			chunk->SetBlockType(blockIndex, edits[editIndex].m_newBlockType);
+		}
+
+		//if the save doesn't go through, carry the edits over into the new journal so they aren't lost
+		if (chunk->SaveChunk())
+		{
+			numChunksReplayed++;
+			numEditsReplayed += static_cast<int>(edits.size());
+		}
+		else
+		{
+			for (int editIndex = 0; editIndex < static_cast<int>(edits.size()); editIndex++)
+			{
+				int blockIndex = chunk->GetBlockIndexFromLocalCoords(edits[editIndex].m_worldX & CHUNK_MAX_X, edits[editIndex].m_worldY & CHUNK_MAX_Y, edits[editIndex].m_worldZ);
+				RecordEdit(chunkEdits->first, blockIndex, edits[editIndex].m_oldBlockType, edits[editIndex].m_newBlockType);
+			}
+		}
+
+		delete chunk;
+	}
+
+	if (!journalEdits.empty())
+	{
+		DebuggerPrintf("Replayed %i journaled edits into %i chunks\n", numEditsReplayed, numChunksReplayed);
+	}
+
+	m_numEditsReplayed += numEditsReplayed;
+
+	m_world->FlushRegionFiles();
+	std::remove(compactingJournalFilePath.c_str());
+	std::remove(journalFilePath.c_str());
+}
+
+
+void EditJournal::BeginCompaction()
+{
+	FlushBatch();
+
+	unsigned int worldSeed = m_world->m_worldSeed;
+	std::string journalFilePath = GetJournalFilePath(worldSeed);
+	std::string compactingJournalFilePath = GetCompactingJournalFilePath(worldSeed);
+
+	//set the current journal aside, and keep appending to a fresh one while it gets compacted
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+	std::remove(compactingJournalFilePath.c_str());
+	if (std::rename(journalFilePath.c_str(), compactingJournalFilePath.c_str()) != 0)
+	{
+		//keep appending to the journal we have rather than lose it, and try again once it's grown some more
+		DebuggerPrintf("Couldn't set aside edit journal %s for compaction\n", journalFilePath.c_str());
+		fopen_s(&m_file, journalFilePath.c_str(), "ab");
+		m_numFailedCompactions++;
+		return;
+	}
+	OpenNewJournal();
+
+	//every edited chunk that's still active gets saved now (unless a save of its current blocks is already queued), and the rest were queued when they were deactivated
+	//each one waits on the ticket of its latest queued save, and chunks with nothing queued are already on disk
+	m_compactingChunks.clear();
+	for (auto chunkCoords = m_editedChunks.begin(); chunkCoords != m_editedChunks.end(); chunkCoords++)
+	{
+		uint64_t saveTicket = 0;
+		m_world->m_chunkSaveQueue.GetPendingSaveTicket(*chunkCoords, m_world->m_worldSeed, saveTicket);
+
+		auto chunkFound = m_world->m_activeChunks.find(*chunkCoords);
+		if (chunkFound != m_world->m_activeChunks.end() && chunkFound->second->m_needsSaving)
+		{
+			Chunk* chunk = chunkFound->second;
+			if (chunk->m_queuedSaveTicket == 0)
+			{
+				chunk->m_queuedSaveTicket = m_world->m_chunkSaveQueue.QueueChunkSave(chunk->TakeSnapshot());
+			}
+			saveTicket = chunk->m_queuedSaveTicket;
+		}
+
+		if (saveTicket != 0)
+		{
+			m_compactingChunks[*chunkCoords] = saveTicket;
+		}
+	}
+
+	m_editedChunks.clear();
+	m_isCompacting = true;
+}
+
+
+void EditJournal::UpdateCompaction()
+{
+	//the old journal has to stay until the save thread has confirmed writing every chunk in it, and while any save is failing
+	if (!m_compactingChunks.empty() || m_world->m_chunkSaveQueue.GetNumRetryingSaves() > 0)
+	{
+		return;
+	}
+
+	m_world->FlushRegionFiles();
+	std::remove(GetCompactingJournalFilePath(m_world->m_worldSeed).c_str());
+
+	m_isCompacting = false;
+	m_numCompactions++;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+
+
+//journal constants
+constexpr int EDIT_JOURNAL_HEADER_SIZE = 12;	//4CC, version, 3 padding bytes, world seed
+constexpr int EDIT_JOURNAL_RECORD_SIZE = 20;	//world x, y and z (4 bytes each), old type, new type, check byte, padding, timestamp (4 bytes)
+constexpr uint8_t EDIT_JOURNAL_VERSION = 2;
+constexpr int EDIT_JOURNAL_V1_RECORD_SIZE = 16;	//version 1 records only had one byte for z: world x and y (4 bytes each), z, old type, new type, check byte, timestamp (4 bytes)
+
+
+//forward declarations
+class World;
+struct WrittenChunkSave;
+
+
+//one block edit as it's stored in the journal
+struct JournalEdit
+{
+	int		 m_worldX = 0;
+	int		 m_worldY = 0;
+	int		 m_worldZ = 0;
+	uint8_t	 m_oldBlockType = 0;
+	uint8_t	 m_newBlockType = 0;
+	uint32_t m_timestamp = 0;	//seconds since the unix epoch
+};
+
+
+//append-only write-ahead log of player block edits, so a crash can't lose edits to chunks that haven't been saved yet
+//edits are buffered and appended in batches, and once the journal gets big enough every chunk it touched is saved and the old journal is thrown away
+//only used from the main thread (the actual chunk saves go through the save queue)
+class EditJournal
+{
+//public member functions
+public:
+	//journal flow functions
+	void Startup(World* world);
+	void Shutdown();
+	void Update();
+	void RecordEdit(IntVec2 chunkCoords, int blockIndex, uint8_t oldBlockType, uint8_t newBlockType);
+	void FlushBatch();
+	void Reset();
+	void OnChunkSaveWritten(WrittenChunkSave const& writtenSave);
+
+	//stats functions
+	int GetJournalSizeBytes() const;
+	int GetNumBufferedEdits() const;
+
+	//static journal utilities
+	static std::string GetJournalFilePath(unsigned int worldSeed);
+	static std::string GetCompactingJournalFilePath(unsigned int worldSeed);
+	static bool		   ReadJournalFile(std::string const& filePath, unsigned int worldSeed, std::vector<JournalEdit>& out_edits);
+
+//private member functions
+private:
+	bool OpenNewJournal();
+	void TruncateToLastRecord();
+	void ReplayLeftoverJournals();
+	void BeginCompaction();
+	void UpdateCompaction();
+
+//public member variables
+public:
+	int m_numEditsRecorded = 0;
+	int m_numBatchesFlushed = 0;
+	int m_numCompactions = 0;
+	int m_numEditsReplayed = 0;
+	int m_numFailedCompactions = 0;
+
+//private member variables
+private:
+	World* m_world = nullptr;
+	FILE*  m_file = nullptr;
+	int	   m_journalSizeBytes = 0;
+
+	std::vector<uint8_t> m_batch;
+	double				 m_lastFlushTime = 0.0;
+
+	std::set<IntVec2>			m_editedChunks;		//chunks edited since the current journal was started
+	std::map<IntVec2, uint64_t> m_compactingChunks;	//chunks from the previous journal that still have saves waiting to be written, and the save queue ticket each one is waiting on
+	bool						m_isCompacting = false;
+};
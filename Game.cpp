@@ -1,6 +1,11 @@
 #include "Game/Game.hpp"
 #include "Game/Player.hpp"
 #include "Game/World.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/SaveMigrator.hpp"
+#include "Game/WorldBackup.hpp"
 #include "Game/BlockDefinition.hpp"
 #include "Game/BlockTemplate.hpp"
 #include "Game/App.hpp"
@@ -21,6 +26,7 @@
 #include "Engine/Core/FileUtils.hpp"
 #include "Engine/Renderer/DebugRenderSystem.hpp"
 #include "Engine/Renderer/ConstantBuffer.hpp"
+#include "Engine/Renderer/IndexBuffer.hpp"
 #include "Engine/JobSystem/JobSystem.hpp"
 
 
@@ -33,6 +39,12 @@ void Game::Startup()
 	//initialize world shader
 	g_worldShader = g_theRenderer->CreateShader("Data/Shaders/World");
 	m_gameCBO = g_theRenderer->CreateConstantBuffer(sizeof(ShaderGameConstants));
+
+	//every indexed chunk mesh is just quads, so they can all share one index buffer that's built once, big enough for the worst chunk
+	std::vector<unsigned int> quadIndexes;
+	ChunkVertex::AddIndexesForQuads(quadIndexes, CHUNK_MAX_MESH_QUADS);
+	g_chunkQuadIndexBuffer = g_theRenderer->CreateIndexBuffer(quadIndexes.size() * sizeof(unsigned int));
+	g_theRenderer->CopyCPUToGPU(quadIndexes.data(), quadIndexes.size() * sizeof(unsigned int), g_chunkQuadIndexBuffer);
 	
 	//create world
 	BlockDefinition::InitializeBlockDefs();
@@ -62,6 +74,18 @@ void Game::Startup()
 
 	g_theJobSystem->CreateWorkers(numWorkerThreads);
 
+	//dev console commands
+	SubscribeEventCallbackFunction("benchmarkregions", RegionFile::Event_BenchmarkRegionFiles);
+	SubscribeEventCallbackFunction("benchmarkdecode", Chunk::Event_BenchmarkChunkDecoding);
+	SubscribeEventCallbackFunction("benchmarkmappedreads", Chunk::Event_BenchmarkMappedReads);
+	SubscribeEventCallbackFunction("benchmarkflush", World::Event_BenchmarkChunkFlush);
+	SubscribeEventCallbackFunction("benchmarkcodecs", ChunkCodec::Event_BenchmarkChunkCodecs);
+	SubscribeEventCallbackFunction("migratesaves", SaveMigrator::Event_MigrateSaves);
+	SubscribeEventCallbackFunction("backupworld", WorldBackup::Event_BackupWorld);
+	SubscribeEventCallbackFunction("restorebackup", WorldBackup::Event_RestoreBackup);
+	SubscribeEventCallbackFunction("benchmarkmeshing", Chunk::Event_BenchmarkChunkMeshing);
+	SubscribeEventCallbackFunction("measuresectionsharing", World::Event_MeasureSectionSharing);
+
 	EnterAttractMode();
 }
 
@@ -117,6 +141,59 @@ void Game::Update()
 
 	std::string chunkInfo = Stringf("Chunks: %i / %i", m_world->m_activeChunks.size(), 1024);
 	DebugAddMessage(chunkInfo, 0.0f);
+
+	if (m_isDebugView)
+	{
+		int totalSections = 0;
+		int uniqueSections = 0;
+		m_world->GetSectionSharingStats(totalSections, uniqueSections);
+		//the saving is estimated from the section count, the "measuresectionsharing" command measures it against process memory
+		float savedMB = static_cast<float>((totalSections - uniqueSections) * sizeof(ChunkSection)) / (1024.0f * 1024.0f);
+		std::string sectionInfo = Stringf("Sections: %i unique / %i total (~%.1f MB saved by sharing, estimated), process: %.1f MB", uniqueSections, totalSections, savedMB, World::GetProcessMemoryUsedMB());
+		DebugAddMessage(sectionInfo, 0.0f);
+
+		std::string residencyInfo = Stringf("Resident sections: %i / %i", m_world->GetNumResidentSections(), static_cast<int>(m_world->m_activeChunks.size()) * CHUNK_NUM_SECTIONS);
+		DebugAddMessage(residencyInfo, 0.0f);
+
+		ChunkCache const& chunkCache = m_world->m_chunkCache;
+		std::string cacheInfo = Stringf("Chunk cache: %.1f%% hit rate (%i hits, %i misses, %i evicted, %i skipped), %i chunks, %.1f MB", chunkCache.GetHitRate() * 100.0f, chunkCache.m_numHits, chunkCache.m_numMisses, chunkCache.m_numEvictions, chunkCache.m_numSkipped, chunkCache.GetNumCachedChunks(), chunkCache.GetMemoryUsedMB());
+		DebugAddMessage(cacheInfo, 0.0f);
+
+		ChunkSaveQueue& saveQueue = m_world->m_chunkSaveQueue;
+		std::string saveQueueInfo = Stringf("Save queue: %i pending, %i saved in %i batches, %i replaced, %i autosaved, %i failed writes (%i chunks retrying)", saveQueue.GetNumPendingSaves(), saveQueue.m_numChunksSaved.load(),
+			saveQueue.m_numBatchesWritten.load(), saveQueue.m_numSavesReplaced.load(), m_world->m_numChunksAutosaved, saveQueue.m_numFailedSaves.load(), saveQueue.GetNumRetryingSaves());
+		DebugAddMessage(saveQueueInfo, 0.0f);
+
+		EditJournal& editJournal = m_world->m_editJournal;
+		std::string editJournalInfo = Stringf("Edit journal: %i edits, %.1f KB, %i batches, %i compactions, %i replayed", editJournal.m_numEditsRecorded, static_cast<float>(editJournal.GetJournalSizeBytes()) / 1024.0f, editJournal.m_numBatchesFlushed, editJournal.m_numCompactions, editJournal.m_numEditsReplayed);
+		DebugAddMessage(editJournalInfo, 0.0f);
+
+		std::string fullViewTime = m_world->m_fullViewSeconds >= 0.0 ? Stringf("%.2fs", m_world->m_fullViewSeconds) : std::string("pending");
+		std::string bakedMeshInfo = Stringf("Baked meshes: %s, %i of %i reused, full view %s", m_world->m_useBakedMeshes ? "on" : "off", m_world->m_numBakedMeshHits, m_world->m_numBakedMeshChecks, fullViewTime.c_str());
+		DebugAddMessage(bakedMeshInfo, 0.0f);
+
+		int numMeshVerts = 0;
+		for (auto chunkIndex = m_world->m_activeChunks.begin(); chunkIndex != m_world->m_activeChunks.end(); chunkIndex++)
+		{
+			numMeshVerts += chunkIndex->second->GetNumMeshVerts();
+		}
+		float gpuMeshMB = static_cast<float>(numMeshVerts * sizeof(Vertex_PCU)) / (1024.0f * 1024.0f);
+		double averageMeshMilliseconds = m_world->m_numMeshesBuilt > 0 ? m_world->m_meshBuildSeconds * 1000.0 / static_cast<double>(m_world->m_numMeshesBuilt) : 0.0;
+		std::string meshingInfo = Stringf("Meshing: %s, %s quads%s, %i verts (%.1f MB on gpu) in active chunks, avg build %.3f ms, %i jobs running", Chunk::GetMesherName(m_world->m_mesherType), m_world->m_useIndexedQuads ? "indexed" : "unindexed",
+			m_world->m_useMeshJobs ? "" : " (main thread)", numMeshVerts, gpuMeshMB, averageMeshMilliseconds, m_world->m_numMeshJobsRunning);
+		DebugAddMessage(meshingInfo, 0.0f);
+
+		double averageFrameMilliseconds = 0.0;
+		double frameDeviationMilliseconds = 0.0;
+		m_world->GetStreamingFrameStats(averageFrameMilliseconds, frameDeviationMilliseconds);
+		std::string remeshInfo = Stringf("Remeshing: %i waiting, streaming frames %.2f ms avg, %.2f ms deviation over %i frames", m_world->m_numRemeshesWaiting, averageFrameMilliseconds, frameDeviationMilliseconds, m_world->m_numStreamingFrames);
+		DebugAddMessage(remeshInfo, 0.0f);
+
+		WorldBackup& worldBackup = m_world->m_worldBackup;
+		std::string lastBackupInfo = worldBackup.m_lastSnapshotIndex >= 0 ? Stringf(", last was #%i: %i chunks, %i unchanged, %i new objects in %.2fs", worldBackup.m_lastSnapshotIndex, worldBackup.m_lastNumChunks, worldBackup.m_lastNumChunksReused, worldBackup.m_lastNumObjectsWritten, worldBackup.m_lastBackupSeconds) : std::string();
+		std::string backupInfo = Stringf("Backups: %i taken%s%s", worldBackup.m_numBackupsTaken, worldBackup.IsBackupRunning() ? ", one running" : "", lastBackupInfo.c_str());
+		DebugAddMessage(backupInfo, 0.0f);
+	}
 }
 
 
@@ -154,7 +231,7 @@ void Game::Render() const
 void Game::Shutdown()
 {
 	//deactivate all chunks
-	m_world->DeactivateAllChunks();
+	m_world->DeactivateAllChunks(World::PrintChunkFlushProgress);
 	
 	//delete all allocated pointers here
 	if (m_world != nullptr)
@@ -167,6 +244,12 @@ void Game::Shutdown()
 		delete m_gameCBO;
 	}
 
+	if (g_chunkQuadIndexBuffer != nullptr)
+	{
+		delete g_chunkQuadIndexBuffer;
+		g_chunkQuadIndexBuffer = nullptr;
+	}
+
 	//clear the job system of all its leftover jobs
 	g_theJobSystem->ClearJobSystem();
 }
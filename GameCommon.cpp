@@ -16,6 +16,7 @@ bool g_enableHiddenSurfaceRemoval = false;
 Texture* g_worldSpriteSheetTexture = nullptr;
 SpriteSheet* g_worldSpriteSheet = nullptr;
 Shader* g_worldShader = nullptr;
+IndexBuffer* g_chunkQuadIndexBuffer = nullptr;
 
 
 //
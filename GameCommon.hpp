@@ -6,6 +6,7 @@
 struct Vec2;
 struct Rgba8;
 class App;
+class Game;
 class Renderer;
 class InputSystem;
 class AudioSystem;
@@ -14,9 +15,11 @@ class RandomNumberGenerator;
 class Texture;
 class SpriteSheet;
 class Shader;
+class IndexBuffer;
 
 //external declarations
 extern App* g_theApp;
+extern Game* g_theGame;
 extern Renderer* g_theRenderer;
 extern InputSystem* g_theInput;
 extern AudioSystem* g_theAudio;
@@ -26,6 +29,7 @@ extern RandomNumberGenerator g_rng;
 extern Texture* g_worldSpriteSheetTexture;
 extern SpriteSheet* g_worldSpriteSheet;
 extern Shader* g_worldShader;
+extern IndexBuffer* g_chunkQuadIndexBuffer;
 
 extern bool g_enableHiddenSurfaceRemoval;
 
@@ -2,12 +2,30 @@
 #include "Game/GameCommon.hpp"
 #define WIN32_LEAN_AND_MEAN		// Always #define this before #including <windows.h>
 #include <windows.h>			// #include this (massive, platform-specific) header in very few places
+#include <cstdio>
 
 
 //-----------------------------------------------------------------------------------------------
 int WINAPI WinMain( HINSTANCE , HINSTANCE, LPSTR commandLineString, int )
 {
-	UNUSED( commandLineString );
+	//anything on the command line is a headless tool command, which runs without ever opening a window
+	if ( commandLineString != nullptr && commandLineString[0] != '\0' )
+	{
+		//print to the console the tool was started from, if there is one
+		if ( AttachConsole( ATTACH_PARENT_PROCESS ) )
+		{
+			FILE* consoleOutput = nullptr;
+			freopen_s( &consoleOutput, "CONOUT$", "w", stdout );
+		}
+
+		g_theApp = new App();
+		int exitCode = g_theApp->RunHeadless( commandLineString );
+
+		delete g_theApp;
+		g_theApp = nullptr;
+
+		return exitCode;
+	}
 
 	g_theApp = new App();
 	g_theApp->Startup();
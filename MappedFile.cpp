@@ -0,0 +1,179 @@
+#include "Game/MappedFile.hpp"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//
+//constructor and destructor
+//
+MappedFile::MappedFile(std::string const& filePath)
+{
+#if defined(_WIN32)
+	//share writes, since the region file stays open for saving while its chunks are being read out of the mapping
+	HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	HANDLE mappingHandle = NULL;
+	if (GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+
+	//the view keeps its own reference to the file, so neither handle needs to stay open
+	if (mappingHandle != NULL)
+	{
+		void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (view != NULL)
+		{
+			m_data = static_cast<uint8_t const*>(view);
+			m_size = static_cast<size_t>(fileSize.QuadPart);
+		}
+		CloseHandle(mappingHandle);
+	}
+	CloseHandle(fileHandle);
+#else
+	int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return;
+	}
+
+	struct stat fileStats = {};
+	if (fstat(fileDescriptor, &fileStats) == 0 && fileStats.st_size > 0)
+	{
+		void* view = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+		if (view != MAP_FAILED)
+		{
+			m_data = static_cast<uint8_t const*>(view);
+			m_size = static_cast<size_t>(fileStats.st_size);
+		}
+	}
+	close(fileDescriptor);
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+	if (m_data == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_data);
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+
+//
+//public accessors
+//
+bool MappedFile::IsOpen() const
+{
+	return m_data != nullptr;
+}
+
+
+uint8_t const* MappedFile::GetData() const
+{
+	return m_data;
+}
+
+
+size_t MappedFile::GetSize() const
+{
+	return m_size;
+}
+
+
+//
+//public access hint functions
+//
+void MappedFile::AdviseSequential()
+{
+	if (m_data == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	//windows has no per-view equivalent, but page faults on a mapped file already read ahead in clusters
+#else
+	//loads walk outward from the player, which mostly means walking forward through each region's table
+	madvise(const_cast<uint8_t*>(m_data), m_size, MADV_SEQUENTIAL);
+#endif
+}
+
+
+void MappedFile::AdviseWillNeed(size_t offset, size_t size)
+{
+	if (m_data == nullptr || offset >= m_size)
+	{
+		return;
+	}
+
+	if (size > m_size - offset)
+	{
+		size = m_size - offset;
+	}
+
+#if defined(_WIN32)
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t*>(m_data + offset);
+	range.NumberOfBytes = size;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	//madvise wants a page-aligned start, so round down and cover the extra bytes
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t alignedOffset = offset - (offset % pageSize);
+	madvise(const_cast<uint8_t*>(m_data + alignedOffset), size + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+
+//
+//static mapping utilities
+//
+bool MappedFile::EvictFromPageCache(std::string const& filePath)
+{
+	//only used to measure cold-cache reads, so this just needs to work for files nobody else has mapped
+#if defined(_WIN32)
+	//opening a file unbuffered makes windows flush and drop whatever it had cached for it
+	HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	CloseHandle(fileHandle);
+	return true;
+#else
+	int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	//dirty pages can't be dropped, so get them written out first
+	fdatasync(fileDescriptor);
+	bool wasEvicted = posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fileDescriptor);
+
+	return wasEvicted;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include <string>
+
+
+//read-only memory mapping of a whole file, so saves can be decoded straight out of the OS page cache instead of being copied into a buffer first
+//the view is a snapshot of the file's size when it was mapped, so anything written past that end needs a fresh mapping to be seen
+//nothing in here touches shared state, so separate mapped files are safe to use from any thread
+class MappedFile
+{
+//public member functions
+public:
+	//constructor and destructor
+	MappedFile(std::string const& filePath);
+	~MappedFile();
+	MappedFile(MappedFile const& copyFrom) = delete;
+	MappedFile& operator=(MappedFile const& copyFrom) = delete;
+
+	//accessors
+	bool		   IsOpen() const;
+	uint8_t const* GetData() const;
+	size_t		   GetSize() const;
+
+	//access hints (only hints, so failures are ignored)
+	void AdviseSequential();
+	void AdviseWillNeed(size_t offset, size_t size);
+
+	//static mapping utilities
+	static bool EvictFromPageCache(std::string const& filePath);
+
+//private member variables
+private:
+	uint8_t const* m_data = nullptr;
+	size_t		   m_size = 0;
+};
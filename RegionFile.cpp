@@ -0,0 +1,600 @@
+#include "Game/RegionFile.hpp"
+#include "Game/MappedFile.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/Time.hpp"
+#include <windows.h>
+
+
+//
+//constructor and destructor
+//
+RegionFile::RegionFile(std::string const& filePath)
+	: m_filePath(filePath)
+{
+	//don't create the file until a chunk actually gets written to it
+	OpenFile(false);
+}
+
+
+RegionFile::~RegionFile()
+{
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+
+//
+//public chunk access functions
+//
+bool RegionFile::HasChunk(IntVec2 chunkCoords) const
+{
+	return m_payloadSizes[GetTableIndexForChunk(chunkCoords)] > 0;
+}
+
+
+bool RegionFile::ReadChunk(IntVec2 chunkCoords, std::vector<uint8_t>& out_chunkBuffer)
+{
+	int tableIndex = GetTableIndexForChunk(chunkCoords);
+	uint32_t payloadSize = m_payloadSizes[tableIndex];
+	if (m_file == nullptr || payloadSize == 0)
+	{
+		return false;
+	}
+
+	//same bounds check as a mapped read, so a payload that runs past the end of the file never gets a buffer allocated for it
+	uint64_t payloadOffset = static_cast<uint64_t>(m_firstSectors[tableIndex]) * REGION_SECTOR_SIZE;
+	fseek(m_file, 0, SEEK_END);
+	long fileSize = ftell(m_file);
+	if (fileSize < 0 || payloadOffset + payloadSize > static_cast<uint64_t>(fileSize))
+	{
+		return false;
+	}
+
+	out_chunkBuffer.resize(payloadSize);
+	fseek(m_file, static_cast<long>(payloadOffset), SEEK_SET);
+	size_t numBytesRead = fread(out_chunkBuffer.data(), 1, payloadSize, m_file);
+
+	return numBytesRead == payloadSize;
+}
+
+
+bool RegionFile::ReadChunkMapped(IntVec2 chunkCoords, std::shared_ptr<MappedFile>& out_mappedFile, uint8_t const*& out_chunkData, size_t& out_chunkSize)
+{
+	int tableIndex = GetTableIndexForChunk(chunkCoords);
+	uint32_t payloadSize = m_payloadSizes[tableIndex];
+	if (m_file == nullptr || payloadSize == 0)
+	{
+		return false;
+	}
+
+	size_t payloadOffset = static_cast<size_t>(m_firstSectors[tableIndex]) * REGION_SECTOR_SIZE;
+	size_t payloadEnd = payloadOffset + payloadSize;
+
+	//the file only ever grows while it's open, so a chunk past the end of the view just means it was written after the file got mapped
+	if (m_mappedFile == nullptr || m_mappedFile->GetSize() < payloadEnd)
+	{
+		fflush(m_file);
+		m_mappedFile = std::make_shared<MappedFile>(m_filePath);
+		if (!m_mappedFile->IsOpen() || m_mappedFile->GetSize() < payloadEnd)
+		{
+			m_mappedFile.reset();
+			return false;
+		}
+
+		m_mappedFile->AdviseSequential();
+	}
+
+	m_mappedFile->AdviseWillNeed(payloadOffset, payloadSize);
+
+	out_mappedFile = m_mappedFile;
+	out_chunkData = m_mappedFile->GetData() + payloadOffset;
+	out_chunkSize = payloadSize;
+	return true;
+}
+
+
+bool RegionFile::WriteChunk(IntVec2 chunkCoords, std::vector<uint8_t> const& chunkBuffer)
+{
+	if (m_file == nullptr && !OpenFile(true))
+	{
+		return false;
+	}
+
+	int tableIndex = GetTableIndexForChunk(chunkCoords);
+	uint32_t payloadSize = static_cast<uint32_t>(chunkBuffer.size());
+	int numSectors = static_cast<int>((payloadSize + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE);
+
+	//write payload into freshly allocated sectors, padding out the last one so every payload stays sector-aligned
+	int firstSector = AllocateSectors(numSectors);
+	fseek(m_file, static_cast<long>(firstSector) * REGION_SECTOR_SIZE, SEEK_SET);
+	bool wasWriteSuccessful = fwrite(chunkBuffer.data(), 1, payloadSize, m_file) == payloadSize;
+
+	int numPaddingBytes = (numSectors * REGION_SECTOR_SIZE) - static_cast<int>(payloadSize);
+	if (numPaddingBytes > 0)
+	{
+		std::vector<uint8_t> padding(numPaddingBytes, 0);
+		wasWriteSuccessful = wasWriteSuccessful && fwrite(padding.data(), 1, padding.size(), m_file) == padding.size();
+	}
+
+	if (!wasWriteSuccessful)
+	{
+		SetSectorsUsed(firstSector, numSectors, false);
+		return false;
+	}
+
+	//only point the table at the new copy once it's fully written, then hand the old sectors back for reuse
+	uint32_t oldFirstSector = m_firstSectors[tableIndex];
+	uint32_t oldPayloadSize = m_payloadSizes[tableIndex];
+
+	m_firstSectors[tableIndex] = static_cast<uint32_t>(firstSector);
+	m_payloadSizes[tableIndex] = payloadSize;
+	if (!WriteTableEntry(tableIndex))
+	{
+		m_firstSectors[tableIndex] = oldFirstSector;
+		m_payloadSizes[tableIndex] = oldPayloadSize;
+		SetSectorsUsed(firstSector, numSectors, false);
+		return false;
+	}
+
+	if (oldPayloadSize > 0)
+	{
+		SetSectorsUsed(static_cast<int>(oldFirstSector), static_cast<int>((oldPayloadSize + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE), false);
+	}
+
+	return true;
+}
+
+
+//
+//public maintenance functions
+//
+int RegionFile::GetNumWastedSectors() const
+{
+	return static_cast<int>(m_usedSectors.size()) - GetNumUsedSectors();
+}
+
+
+int RegionFile::GetNumUsedSectors() const
+{
+	int numUsedSectors = 0;
+	for (int sectorIndex = 0; sectorIndex < m_usedSectors.size(); sectorIndex++)
+	{
+		if (m_usedSectors[sectorIndex])
+		{
+			numUsedSectors++;
+		}
+	}
+
+	return numUsedSectors;
+}
+
+
+void RegionFile::Flush()
+{
+	if (m_file != nullptr)
+	{
+		fflush(m_file);
+	}
+}
+
+
+bool RegionFile::Compact()
+{
+	if (m_file == nullptr)
+	{
+		return false;
+	}
+
+	//the file can't be replaced while a loader is still decoding out of the old mapping, so leave it for next time
+	if (m_mappedFile != nullptr && m_mappedFile.use_count() > 1)
+	{
+		return false;
+	}
+	m_mappedFile.reset();
+
+	//read every saved chunk back in
+	std::vector<std::vector<uint8_t>> chunkBuffers(REGION_NUM_CHUNKS);
+	for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS; tableIndex++)
+	{
+		if (m_payloadSizes[tableIndex] > 0)
+		{
+			IntVec2 localCoords = IntVec2(tableIndex & (REGION_SIZE_X - 1), tableIndex >> REGION_BITS_X);
+			if (!ReadChunk(localCoords, chunkBuffers[tableIndex]))
+			{
+				return false;
+			}
+		}
+	}
+
+	//write them back-to-back into a temporary file, and only replace the real one once that has fully succeeded
+	std::string tempFilePath = m_filePath + ".tmp";
+	std::remove(tempFilePath.c_str());
+
+	bool didWriteCompactedFile = true;
+	RegionFile compactedFile(tempFilePath);
+	for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS && didWriteCompactedFile; tableIndex++)
+	{
+		if (m_payloadSizes[tableIndex] > 0)
+		{
+			IntVec2 localCoords = IntVec2(tableIndex & (REGION_SIZE_X - 1), tableIndex >> REGION_BITS_X);
+			didWriteCompactedFile = compactedFile.WriteChunk(localCoords, chunkBuffers[tableIndex]);
+		}
+	}
+
+	if (compactedFile.m_file != nullptr)
+	{
+		didWriteCompactedFile = fclose(compactedFile.m_file) == 0 && didWriteCompactedFile;
+		compactedFile.m_file = nullptr;
+	}
+
+	if (!didWriteCompactedFile)
+	{
+		std::remove(tempFilePath.c_str());
+		return false;
+	}
+
+	//swapped in with a single move, so there's never a moment without a region file on disk (windows won't replace a file that's still open)
+	fclose(m_file);
+	m_file = nullptr;
+	if (!MoveFileExA(tempFilePath.c_str(), m_filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DebuggerPrintf("Couldn't replace region file %s with its compacted copy\n", m_filePath.c_str());
+		std::remove(tempFilePath.c_str());
+		OpenFile(false);
+		return false;
+	}
+
+	return OpenFile(false);
+}
+
+
+//
+//static region utilities
+//
+IntVec2 RegionFile::GetRegionCoordsForChunk(IntVec2 chunkCoords)
+{
+	//arithmetic shift rounds negative chunk coords down, so region (-1, -1) holds chunks (-32, -32) through (-1, -1)
+	return IntVec2(chunkCoords.x >> REGION_BITS_X, chunkCoords.y >> REGION_BITS_Y);
+}
+
+
+int RegionFile::GetTableIndexForChunk(IntVec2 chunkCoords)
+{
+	int localX = chunkCoords.x & (REGION_SIZE_X - 1);
+	int localY = chunkCoords.y & (REGION_SIZE_Y - 1);
+
+	return localX + (localY << REGION_BITS_X);
+}
+
+
+std::string RegionFile::GetRegionFilePath(unsigned int worldSeed, IntVec2 regionCoords)
+{
+	return Stringf("Saves/World_%u/Region(%i,%i).region", worldSeed, regionCoords.x, regionCoords.y);
+}
+
+
+bool RegionFile::ReadSavedChunkCoords(std::string const& filePath, IntVec2 regionCoords, std::vector<IntVec2>& out_chunkCoords)
+{
+	//just reads the header table, without opening the region for writing or mapping out its sectors
+	FILE* file = nullptr;
+	fopen_s(&file, filePath.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> header(REGION_HEADER_SIZE);
+	bool wasReadSuccessful = fread(header.data(), 1, header.size(), file) == header.size();
+	fclose(file);
+
+	if (!wasReadSuccessful || header[0] != 'G' || header[1] != 'R' || header[2] != 'G' || header[3] != 'N' || header[4] != REGION_FILE_VERSION)
+	{
+		return false;
+	}
+
+	for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS; tableIndex++)
+	{
+		uint8_t const* tableEntry = &header[REGION_TABLE_OFFSET + (tableIndex * REGION_TABLE_ENTRY_SIZE)];
+		bool isChunkSaved = tableEntry[4] != 0 || tableEntry[5] != 0 || tableEntry[6] != 0 || tableEntry[7] != 0;
+		if (isChunkSaved)
+		{
+			int chunkX = (regionCoords.x * REGION_SIZE_X) + (tableIndex & (REGION_SIZE_X - 1));
+			int chunkY = (regionCoords.y * REGION_SIZE_Y) + (tableIndex >> REGION_BITS_X);
+			out_chunkCoords.emplace_back(chunkX, chunkY);
+		}
+	}
+
+	return true;
+}
+
+
+bool RegionFile::Event_BenchmarkRegionFiles(EventArgs& args)
+{
+	int numChunks = args.GetValue("chunks", REGION_NUM_CHUNKS);
+	if (numChunks < 1 || numChunks > REGION_NUM_CHUNKS)
+	{
+		numChunks = REGION_NUM_CHUNKS;
+	}
+
+	CreateDirectoryA("Saves", NULL);
+	CreateDirectoryA("Saves\\Benchmark", NULL);
+
+	//make payloads in the same size range as real saved chunks
+	std::vector<std::vector<uint8_t>> chunkBuffers(numChunks);
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		int payloadSize = 1024 + ((chunkIndex * 733) % 6144);
+		chunkBuffers[chunkIndex].resize(payloadSize);
+		for (int byteIndex = 0; byteIndex < payloadSize; byteIndex++)
+		{
+			chunkBuffers[chunkIndex][byteIndex] = static_cast<uint8_t>((byteIndex * 31) + chunkIndex);
+		}
+	}
+
+	//one file per chunk
+	double startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		FileWriteFromBuffer(chunkBuffers[chunkIndex], Stringf("Saves/Benchmark/Chunk(%i,0).chunk", chunkIndex));
+	}
+	double chunkFileWriteSeconds = GetCurrentTimeSeconds() - startTime;
+
+	bool didChunkFilesMatch = true;
+	startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		std::vector<uint8_t> chunkBuffer;
+		FileReadToBuffer(chunkBuffer, Stringf("Saves/Benchmark/Chunk(%i,0).chunk", chunkIndex));
+		didChunkFilesMatch = didChunkFilesMatch && chunkBuffer == chunkBuffers[chunkIndex];
+	}
+	double chunkFileReadSeconds = GetCurrentTimeSeconds() - startTime;
+
+	//one region file
+	std::string regionFilePath = "Saves/Benchmark/Region(0,0).region";
+	std::remove(regionFilePath.c_str());
+
+	startTime = GetCurrentTimeSeconds();
+	RegionFile* regionFile = new RegionFile(regionFilePath);
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		regionFile->WriteChunk(IntVec2(chunkIndex & (REGION_SIZE_X - 1), chunkIndex >> REGION_BITS_X), chunkBuffers[chunkIndex]);
+	}
+	delete regionFile;
+	double regionWriteSeconds = GetCurrentTimeSeconds() - startTime;
+
+	startTime = GetCurrentTimeSeconds();
+	regionFile = new RegionFile(regionFilePath);
+	double regionOpenSeconds = GetCurrentTimeSeconds() - startTime;
+
+	bool didRegionMatch = true;
+	startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		std::vector<uint8_t> chunkBuffer;
+		regionFile->ReadChunk(IntVec2(chunkIndex & (REGION_SIZE_X - 1), chunkIndex >> REGION_BITS_X), chunkBuffer);
+		didRegionMatch = didRegionMatch && chunkBuffer == chunkBuffers[chunkIndex];
+	}
+	double regionReadSeconds = GetCurrentTimeSeconds() - startTime;
+	int numRegionSectors = regionFile->GetNumUsedSectors();
+	delete regionFile;
+
+	//clean up
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		std::remove(Stringf("Saves/Benchmark/Chunk(%i,0).chunk", chunkIndex).c_str());
+	}
+	std::remove(regionFilePath.c_str());
+
+	double microsecondsPerChunk = 1000000.0 / static_cast<double>(numChunks);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Region file benchmark (%i chunks):", numChunks));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Chunk files: write %.1f us/chunk, open+read %.1f us/chunk%s", chunkFileWriteSeconds * microsecondsPerChunk, chunkFileReadSeconds * microsecondsPerChunk, didChunkFilesMatch ? "" : " (MISMATCH)"));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Region file: open %.1f us, write %.1f us/chunk, read %.1f us/chunk, %i sectors%s", regionOpenSeconds * 1000000.0, regionWriteSeconds * microsecondsPerChunk, regionReadSeconds * microsecondsPerChunk, numRegionSectors, didRegionMatch ? "" : " (MISMATCH)"));
+
+	return true;
+}
+
+
+//
+//private file functions
+//
+bool RegionFile::OpenFile(bool createIfMissing)
+{
+	//a compaction that got cut short leaves its copy behind, which is only complete if the real file is already gone (older builds removed it before moving the copy in)
+	std::string tempFilePath = m_filePath + ".tmp";
+	if (CheckForFile(tempFilePath))
+	{
+		if (CheckForFile(m_filePath))
+		{
+			std::remove(tempFilePath.c_str());
+		}
+		else if (!MoveFileExA(tempFilePath.c_str(), m_filePath.c_str(), MOVEFILE_WRITE_THROUGH))
+		{
+			DebuggerPrintf("Couldn't recover region file %s from its compacted copy\n", m_filePath.c_str());
+		}
+	}
+
+	fopen_s(&m_file, m_filePath.c_str(), "r+b");
+	if (m_file == nullptr)
+	{
+		if (!createIfMissing)
+		{
+			return false;
+		}
+
+		//brand new region, so write an empty table
+		fopen_s(&m_file, m_filePath.c_str(), "w+b");
+		if (m_file == nullptr)
+		{
+			return false;
+		}
+
+		for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS; tableIndex++)
+		{
+			m_firstSectors[tableIndex] = 0;
+			m_payloadSizes[tableIndex] = 0;
+		}
+		m_usedSectors.assign(REGION_HEADER_SECTORS, true);
+
+		return WriteHeader();
+	}
+
+	//read header
+	std::vector<uint8_t> header(REGION_HEADER_SIZE);
+	char const* damageText = nullptr;
+	if (fread(header.data(), 1, header.size(), m_file) != header.size())
+	{
+		damageText = "is missing its header";
+	}
+	else if (header[0] != 'G' || header[1] != 'R' || header[2] != 'G' || header[3] != 'N')
+	{
+		damageText = "is missing its 4CC";
+	}
+	else if (header[4] != REGION_FILE_VERSION)
+	{
+		damageText = "has the wrong version";
+	}
+	else if (header[5] != REGION_BITS_X || header[6] != REGION_BITS_Y)
+	{
+		damageText = "specifies the wrong number of bits";
+	}
+
+	//its chunks just get generated again, and the broken file is moved aside (not deleted) so the next write starts a fresh region
+	if (damageText != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+
+		std::string damagedFilePath = m_filePath + ".damaged";
+		bool wasMovedAside = MoveFileExA(m_filePath.c_str(), damagedFilePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+		DebuggerPrintf("Region file %s %s, %s\n", m_filePath.c_str(), damageText, wasMovedAside ? Stringf("moved it to %s", damagedFilePath.c_str()).c_str() : "and it couldn't be moved aside");
+		return false;
+	}
+
+	//mark which sectors are taken by the header and by saved chunks (anything else is free to reuse)
+	fseek(m_file, 0, SEEK_END);
+	long fileSize = ftell(m_file);
+	m_usedSectors.assign((fileSize + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE, false);
+	SetSectorsUsed(0, REGION_HEADER_SECTORS, true);
+
+	for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS; tableIndex++)
+	{
+		uint8_t const* tableEntry = &header[REGION_TABLE_OFFSET + (tableIndex * REGION_TABLE_ENTRY_SIZE)];
+		m_firstSectors[tableIndex] = static_cast<uint32_t>(tableEntry[0]) | (static_cast<uint32_t>(tableEntry[1]) << 8) | (static_cast<uint32_t>(tableEntry[2]) << 16) | (static_cast<uint32_t>(tableEntry[3]) << 24);
+		m_payloadSizes[tableIndex] = static_cast<uint32_t>(tableEntry[4]) | (static_cast<uint32_t>(tableEntry[5]) << 8) | (static_cast<uint32_t>(tableEntry[6]) << 16) | (static_cast<uint32_t>(tableEntry[7]) << 24);
+
+		if (m_payloadSizes[tableIndex] == 0)
+		{
+			continue;
+		}
+
+		//an entry that points into the header, past the end of the file, or at sectors another chunk already has can't be trusted, so that chunk just gets generated again
+		//(checked before anything is allocated, since a corrupt payload size could otherwise ask for gigabytes)
+		uint64_t payloadEnd = (static_cast<uint64_t>(m_firstSectors[tableIndex]) * REGION_SECTOR_SIZE) + m_payloadSizes[tableIndex];
+		int firstSector = static_cast<int>(m_firstSectors[tableIndex]);
+		int numSectors = static_cast<int>((m_payloadSizes[tableIndex] + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE);
+		bool isEntryValid = m_firstSectors[tableIndex] >= static_cast<uint32_t>(REGION_HEADER_SECTORS) && payloadEnd <= static_cast<uint64_t>(fileSize);
+		for (int sectorIndex = firstSector; sectorIndex < firstSector + numSectors && isEntryValid; sectorIndex++)
+		{
+			isEntryValid = !m_usedSectors[sectorIndex];
+		}
+		if (!isEntryValid)
+		{
+			DebuggerPrintf("Region file %s has a bad table entry for chunk %i (sector %u, %u bytes), dropping it\n", m_filePath.c_str(), tableIndex, m_firstSectors[tableIndex], m_payloadSizes[tableIndex]);
+			m_firstSectors[tableIndex] = 0;
+			m_payloadSizes[tableIndex] = 0;
+			continue;
+		}
+
+		SetSectorsUsed(firstSector, numSectors, true);
+	}
+
+	return true;
+}
+
+
+bool RegionFile::WriteHeader()
+{
+	std::vector<uint8_t> header(REGION_HEADER_SECTORS * REGION_SECTOR_SIZE, 0);
+	header[0] = 'G';
+	header[1] = 'R';
+	header[2] = 'G';
+	header[3] = 'N';
+	header[4] = REGION_FILE_VERSION;
+	header[5] = static_cast<uint8_t>(REGION_BITS_X);
+	header[6] = static_cast<uint8_t>(REGION_BITS_Y);
+
+	fseek(m_file, 0, SEEK_SET);
+	bool wasWriteSuccessful = fwrite(header.data(), 1, header.size(), m_file) == header.size();
+
+	for (int tableIndex = 0; tableIndex < REGION_NUM_CHUNKS && wasWriteSuccessful; tableIndex++)
+	{
+		wasWriteSuccessful = WriteTableEntry(tableIndex);
+	}
+
+	return wasWriteSuccessful;
+}
+
+
+bool RegionFile::WriteTableEntry(int tableIndex)
+{
+	uint32_t firstSector = m_firstSectors[tableIndex];
+	uint32_t payloadSize = m_payloadSizes[tableIndex];
+
+	uint8_t tableEntry[REGION_TABLE_ENTRY_SIZE] = {
+		static_cast<uint8_t>(firstSector), static_cast<uint8_t>(firstSector >> 8), static_cast<uint8_t>(firstSector >> 16), static_cast<uint8_t>(firstSector >> 24),
+		static_cast<uint8_t>(payloadSize), static_cast<uint8_t>(payloadSize >> 8), static_cast<uint8_t>(payloadSize >> 16), static_cast<uint8_t>(payloadSize >> 24)
+	};
+
+	fseek(m_file, REGION_TABLE_OFFSET + (tableIndex * REGION_TABLE_ENTRY_SIZE), SEEK_SET);
+	bool wasWriteSuccessful = fwrite(tableEntry, 1, REGION_TABLE_ENTRY_SIZE, m_file) == REGION_TABLE_ENTRY_SIZE;
+	fflush(m_file);
+
+	return wasWriteSuccessful;
+}
+
+
+int RegionFile::AllocateSectors(int numSectors)
+{
+	//first fit into any gap left by chunks that moved
+	int freeRunStart = 0;
+	int freeRunLength = 0;
+	for (int sectorIndex = 0; sectorIndex < m_usedSectors.size(); sectorIndex++)
+	{
+		if (m_usedSectors[sectorIndex])
+		{
+			freeRunStart = sectorIndex + 1;
+			freeRunLength = 0;
+			continue;
+		}
+
+		freeRunLength++;
+		if (freeRunLength == numSectors)
+		{
+			SetSectorsUsed(freeRunStart, numSectors, true);
+			return freeRunStart;
+		}
+	}
+
+	//otherwise, grow the file (a free run at the very end still gets used)
+	SetSectorsUsed(freeRunStart, numSectors, true);
+	return freeRunStart;
+}
+
+
+void RegionFile::SetSectorsUsed(int firstSector, int numSectors, bool isUsed)
+{
+	if (firstSector + numSectors > m_usedSectors.size())
+	{
+		m_usedSectors.resize(firstSector + numSectors, false);
+	}
+
+	for (int sectorIndex = firstSector; sectorIndex < firstSector + numSectors; sectorIndex++)
+	{
+		m_usedSectors[sectorIndex] = isUsed;
+	}
+}
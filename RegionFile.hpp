@@ -0,0 +1,78 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <cstdio>
+#include <memory>
+
+
+//forward declarations
+class MappedFile;
+
+
+//region constants
+constexpr int REGION_BITS_X = 5;
+constexpr int REGION_BITS_Y = 5;
+constexpr int REGION_SIZE_X = 1 << REGION_BITS_X;
+constexpr int REGION_SIZE_Y = 1 << REGION_BITS_Y;
+constexpr int REGION_NUM_CHUNKS = REGION_SIZE_X * REGION_SIZE_Y;
+
+constexpr int REGION_SECTOR_SIZE = 4096;
+constexpr int REGION_TABLE_OFFSET = 8;		//4CC, version, region bits x and y, one padding byte
+constexpr int REGION_TABLE_ENTRY_SIZE = 8;	//first sector and payload size, both 4 bytes
+constexpr int REGION_HEADER_SIZE = REGION_TABLE_OFFSET + (REGION_NUM_CHUNKS * REGION_TABLE_ENTRY_SIZE);
+constexpr int REGION_HEADER_SECTORS = (REGION_HEADER_SIZE + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+constexpr uint8_t REGION_FILE_VERSION = 1;
+
+
+//one file holding up to 32x32 saved chunks, each stored as a run of whole sectors located through the header's offset/size table
+//a chunk being rewritten always goes to a fresh run of sectors before the table points at it, so a failed write never loses the old copy
+class RegionFile
+{
+//public member functions
+public:
+	//constructor and destructor
+	RegionFile(std::string const& filePath);
+	~RegionFile();
+
+	//chunk access functions
+	bool HasChunk(IntVec2 chunkCoords) const;
+	bool ReadChunk(IntVec2 chunkCoords, std::vector<uint8_t>& out_chunkBuffer);
+	bool ReadChunkMapped(IntVec2 chunkCoords, std::shared_ptr<MappedFile>& out_mappedFile, uint8_t const*& out_chunkData, size_t& out_chunkSize);
+	bool WriteChunk(IntVec2 chunkCoords, std::vector<uint8_t> const& chunkBuffer);
+
+	//maintenance functions
+	int  GetNumWastedSectors() const;
+	int  GetNumUsedSectors() const;
+	bool Compact();
+	void Flush();
+
+	//static region utilities
+	static IntVec2		GetRegionCoordsForChunk(IntVec2 chunkCoords);
+	static int			GetTableIndexForChunk(IntVec2 chunkCoords);
+	static std::string	GetRegionFilePath(unsigned int worldSeed, IntVec2 regionCoords);
+	static bool			ReadSavedChunkCoords(std::string const& filePath, IntVec2 regionCoords, std::vector<IntVec2>& out_chunkCoords);
+	static bool			Event_BenchmarkRegionFiles(EventArgs& args);
+
+//private member functions
+private:
+	bool OpenFile(bool createIfMissing);
+	bool WriteHeader();
+	bool WriteTableEntry(int tableIndex);
+	int	 AllocateSectors(int numSectors);
+	void SetSectorsUsed(int firstSector, int numSectors, bool isUsed);
+
+//public member variables
+public:
+	std::string m_filePath;
+
+//private member variables
+private:
+	FILE*			  m_file = nullptr;
+	uint32_t		  m_firstSectors[REGION_NUM_CHUNKS] = {};
+	uint32_t		  m_payloadSizes[REGION_NUM_CHUNKS] = {};	//0 if the chunk isn't saved in this region
+	std::vector<bool> m_usedSectors;
+
+	//read-only view of the file, remapped whenever a chunk lies past its end
+	//readers keep their own reference while decoding, which is safe since a chunk's sectors only get reused after that same chunk is rewritten
+	std::shared_ptr<MappedFile> m_mappedFile;
+};
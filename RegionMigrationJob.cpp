@@ -0,0 +1,136 @@
+#include "Game/RegionMigrationJob.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/SaveMigrator.hpp"
+#include "Engine/Core/FileUtils.hpp"
+
+
+void RegionMigrationJob::Execute()
+{
+	//a region that exists but can't be read is left alone, since opening it would move it aside and start a fresh one in its place
+	std::string regionFilePath = RegionFile::GetRegionFilePath(m_worldSeed, m_regionCoords);
+	std::vector<IntVec2> savedChunkCoords;
+	if (CheckForFile(regionFilePath) && !RegionFile::ReadSavedChunkCoords(regionFilePath, m_regionCoords, savedChunkCoords))
+	{
+		m_errors.push_back(Stringf("Region %i, %i has a damaged header, so it was skipped", m_regionCoords.x, m_regionCoords.y));
+		m_numChunksFailed += static_cast<int>(m_legacyChunkCoords.size());
+		return;
+	}
+
+	RegionFile regionFile(regionFilePath);
+	bool wasRegionChanged = false;
+
+	//writes always go to fresh sectors, so check every one by reading it straight back
+	auto writeAndVerifyChunk = [this, &regionFile, &wasRegionChanged](IntVec2 chunkCoords, std::vector<uint8_t> const& chunkBuffer)
+		{
+			std::vector<uint8_t> writtenBuffer;
+			wasRegionChanged = true;
+			if (!regionFile.WriteChunk(chunkCoords, chunkBuffer) || !regionFile.ReadChunk(chunkCoords, writtenBuffer) || writtenBuffer != chunkBuffer)
+			{
+				m_errors.push_back(Stringf("Chunk %i, %i didn't read back the same after being written", chunkCoords.x, chunkCoords.y));
+				return false;
+			}
+
+			m_numBytesWritten += chunkBuffer.size();
+			return true;
+		};
+
+	//chunks already in the region
+	std::vector<uint8_t> chunkBuffer;
+	std::vector<uint8_t> migratedBuffer;
+	std::string errorText;
+	for (int chunkIndex = 0; chunkIndex < static_cast<int>(savedChunkCoords.size()); chunkIndex++)
+	{
+		IntVec2 chunkCoords = savedChunkCoords[chunkIndex];
+		m_numChunksRead++;
+		if (!regionFile.ReadChunk(chunkCoords, chunkBuffer))
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i couldn't be read from its region", chunkCoords.x, chunkCoords.y));
+			m_numChunksFailed++;
+			continue;
+		}
+		m_numBytesRead += chunkBuffer.size();
+
+		ChunkMigrationResult result = SaveMigrator::MigrateChunkSave(chunkBuffer.data(), chunkBuffer.size(), m_worldSeed, m_targetCodec, migratedBuffer, errorText);
+		if (result == ChunkMigrationResult::FAILED)
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i %s", chunkCoords.x, chunkCoords.y, errorText.c_str()));
+			m_numChunksFailed++;
+		}
+		else if (result == ChunkMigrationResult::UNCHANGED)
+		{
+			m_numChunksUnchanged++;
+		}
+		else if (m_isVerifyOnly || writeAndVerifyChunk(chunkCoords, migratedBuffer))
+		{
+			m_numChunksUpgraded++;
+		}
+		else
+		{
+			m_numChunksFailed++;
+		}
+	}
+
+	//old per-chunk saves only get deleted once their copy in the region has been written, read back, and flushed
+	std::vector<std::string> importedFilePaths;
+	for (int chunkIndex = 0; chunkIndex < static_cast<int>(m_legacyChunkCoords.size()); chunkIndex++)
+	{
+		IntVec2 chunkCoords = m_legacyChunkCoords[chunkIndex];
+		if (regionFile.HasChunk(chunkCoords))
+		{
+			m_numStaleLegacyFiles++;
+			continue;
+		}
+
+		m_numChunksRead++;
+		std::string legacyFilePath = Stringf("Saves/World_%u/Chunk(%i,%i).chunk", m_worldSeed, chunkCoords.x, chunkCoords.y);
+		if (FileReadToBuffer(chunkBuffer, legacyFilePath) <= 0)
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i save file couldn't be read", chunkCoords.x, chunkCoords.y));
+			m_numChunksFailed++;
+			continue;
+		}
+		m_numBytesRead += chunkBuffer.size();
+
+		ChunkMigrationResult result = SaveMigrator::MigrateChunkSave(chunkBuffer.data(), chunkBuffer.size(), m_worldSeed, m_targetCodec, migratedBuffer, errorText);
+		if (result == ChunkMigrationResult::FAILED)
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i %s", chunkCoords.x, chunkCoords.y, errorText.c_str()));
+			m_numChunksFailed++;
+			continue;
+		}
+
+		if (!m_isVerifyOnly)
+		{
+			if (!writeAndVerifyChunk(chunkCoords, result == ChunkMigrationResult::UPGRADED ? migratedBuffer : chunkBuffer))
+			{
+				m_numChunksFailed++;
+				continue;
+			}
+
+			importedFilePaths.push_back(legacyFilePath);
+			m_numChunksImported++;
+		}
+
+		m_numChunksUpgraded += result == ChunkMigrationResult::UPGRADED ? 1 : 0;
+		m_numChunksUnchanged += result == ChunkMigrationResult::UNCHANGED ? 1 : 0;
+	}
+
+	if (!wasRegionChanged)
+	{
+		return;
+	}
+
+	regionFile.Flush();
+	for (int fileIndex = 0; fileIndex < static_cast<int>(importedFilePaths.size()); fileIndex++)
+	{
+		std::remove(importedFilePaths[fileIndex].c_str());
+	}
+
+	//every rewritten chunk left its old sectors behind, so squeeze them out while nothing else has the region open
+	//a failed compaction leaves the region as it was, so the migrated chunks are still fine, it just stays bigger than it needs to be
+	if (regionFile.GetNumWastedSectors() > 0 && !regionFile.Compact())
+	{
+		m_errors.push_back(Stringf("Region %i, %i couldn't be compacted after migrating, so it still has %i wasted sectors", m_regionCoords.x, m_regionCoords.y, regionFile.GetNumWastedSectors()));
+		m_numRegionsNotCompacted++;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Game/ChunkCodec.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <string>
+#include <vector>
+
+
+//migrates every chunk saved in one region file, and imports the region's old per-chunk save files into it
+//nothing else touches the region while the job runs, so it opens its own region file and needs no locking
+class RegionMigrationJob : public Job
+{
+//public member functions
+public:
+	RegionMigrationJob(unsigned int worldSeed, IntVec2 regionCoords, std::vector<IntVec2> const& legacyChunkCoords, ChunkCodecType targetCodec, bool isVerifyOnly)
+		: m_worldSeed(worldSeed)
+		, m_regionCoords(regionCoords)
+		, m_legacyChunkCoords(legacyChunkCoords)
+		, m_targetCodec(targetCodec)
+		, m_isVerifyOnly(isVerifyOnly)
+	{}
+
+	virtual void Execute() override;
+
+//public member variables
+public:
+	unsigned int		 m_worldSeed = 0;
+	IntVec2				 m_regionCoords;
+	std::vector<IntVec2> m_legacyChunkCoords;	//old per-chunk save files that belong in this region
+	ChunkCodecType		 m_targetCodec = ChunkCodecType::PALETTE_RLE;
+	bool				 m_isVerifyOnly = false;	//check everything, but don't write or delete anything
+
+	//results
+	int						 m_numChunksRead = 0;
+	int						 m_numChunksUpgraded = 0;
+	int						 m_numChunksUnchanged = 0;
+	int						 m_numChunksImported = 0;
+	int						 m_numChunksFailed = 0;
+	int						 m_numStaleLegacyFiles = 0;	//per-chunk files the region already has a newer copy of (the game never reads these)
+	int						 m_numRegionsNotCompacted = 0;	//0 or 1, since each job only has the one region
+	size_t					 m_numBytesRead = 0;
+	size_t					 m_numBytesWritten = 0;
+	std::vector<std::string> m_errors;
+};
@@ -0,0 +1,373 @@
+#include "Game/SaveMigrator.hpp"
+#include "Game/RegionMigrationJob.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/BlockDefinition.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/World.hpp"
+#include "Game/Game.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/JobSystem/JobSystem.hpp"
+#include <windows.h>
+#include <cstdio>
+#include <map>
+#include <thread>
+
+
+//
+//public migration functions
+//
+bool SaveMigrator::RunMigration(unsigned int worldSeed, ChunkCodecType targetCodec, bool isVerifyOnly)
+{
+	//region files can only have one owner, so the world that's being played can't be migrated underneath itself
+	//(and neither can the one before an F9 switch, while the save thread is still writing into its region files)
+	World* world = g_theGame != nullptr ? g_theGame->m_world : nullptr;
+	if (world != nullptr && world->m_worldSeed == worldSeed)
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf("World %u is loaded, so switch to another seed (F9) before migrating it", worldSeed));
+		return false;
+	}
+	if (world != nullptr && world->IsWorldSeedInUse(worldSeed))
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf("World %u still has chunk saves being written, so try again once they finish", worldSeed));
+		return false;
+	}
+
+	double startTime = GetCurrentTimeSeconds();
+
+	//find every region file and old per-chunk save, grouped by the region they belong in
+	std::map<IntVec2, std::vector<IntVec2>> legacyChunkCoordsByRegion;
+	std::string worldFolderPath = Stringf("Saves\\World_%u", worldSeed);
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((worldFolderPath + "\\*").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf("Couldn't find any saves for world %u", worldSeed));
+		return false;
+	}
+
+	do
+	{
+		std::string fileName = findData.cFileName;
+		IntVec2 coords;
+		if (fileName.size() > 7 && fileName.compare(fileName.size() - 7, 7, ".region") == 0 && sscanf_s(fileName.c_str(), "Region(%d,%d)", &coords.x, &coords.y) == 2)
+		{
+			legacyChunkCoordsByRegion.emplace(coords, std::vector<IntVec2>());
+		}
+		else if (fileName.size() > 6 && fileName.compare(fileName.size() - 6, 6, ".chunk") == 0 && sscanf_s(fileName.c_str(), "Chunk(%d,%d)", &coords.x, &coords.y) == 2)
+		{
+			legacyChunkCoordsByRegion[RegionFile::GetRegionCoordsForChunk(coords)].push_back(coords);
+		}
+	}
+	while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+
+	PrintMigrationLine(DevConsole::COLOR_INFO_MAJOR, Stringf("%s world %u (%i regions) to %s...", isVerifyOnly ? "Verifying" : "Migrating", worldSeed, static_cast<int>(legacyChunkCoordsByRegion.size()), ChunkCodec::GetCodecName(targetCodec)));
+
+	//one job per region, since each one works on its own file
+	for (auto regionIndex = legacyChunkCoordsByRegion.begin(); regionIndex != legacyChunkCoordsByRegion.end(); regionIndex++)
+	{
+		g_theJobSystem->PostNewJob(new RegionMigrationJob(worldSeed, regionIndex->first, regionIndex->second, targetCodec, isVerifyOnly));
+	}
+
+	int numRegionsToMigrate = static_cast<int>(legacyChunkCoordsByRegion.size());
+	int numRegionsMigrated = 0;
+	int numChunksRead = 0;
+	int numChunksUpgraded = 0;
+	int numChunksUnchanged = 0;
+	int numChunksImported = 0;
+	int numChunksFailed = 0;
+	int numStaleLegacyFiles = 0;
+	int numRegionsNotCompacted = 0;
+	size_t numBytesRead = 0;
+	size_t numBytesWritten = 0;
+	int numErrorsPrinted = 0;
+	int lastProgressTenth = 0;
+	while (numRegionsMigrated < numRegionsToMigrate)
+	{
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		//another world's generate and load jobs share the completed list, so hang on to those for its next update
+		Job* completedJob = g_theJobSystem->ClaimCompletedJob();
+		RegionMigrationJob* migrationJob = dynamic_cast<RegionMigrationJob*>(completedJob);
+		if (migrationJob == nullptr)
+		{
+			if (world != nullptr)
+			{
+				world->m_deferredCompletedJobs.push_back(completedJob);
+			}
+			else
+			{
+				delete completedJob;
+			}
+			continue;
+		}
+
+		numChunksRead += migrationJob->m_numChunksRead;
+		numChunksUpgraded += migrationJob->m_numChunksUpgraded;
+		numChunksUnchanged += migrationJob->m_numChunksUnchanged;
+		numChunksImported += migrationJob->m_numChunksImported;
+		numChunksFailed += migrationJob->m_numChunksFailed;
+		numStaleLegacyFiles += migrationJob->m_numStaleLegacyFiles;
+		numRegionsNotCompacted += migrationJob->m_numRegionsNotCompacted;
+		numBytesRead += migrationJob->m_numBytesRead;
+		numBytesWritten += migrationJob->m_numBytesWritten;
+
+		//a badly damaged world could fail thousands of chunks, so only the first few get printed
+		for (int errorIndex = 0; errorIndex < static_cast<int>(migrationJob->m_errors.size()); errorIndex++)
+		{
+			if (numErrorsPrinted < 20)
+			{
+				PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf(" %s", migrationJob->m_errors[errorIndex].c_str()));
+			}
+			numErrorsPrinted++;
+		}
+
+		delete migrationJob;
+		numRegionsMigrated++;
+
+		int progressTenth = (numRegionsMigrated * 10) / numRegionsToMigrate;
+		if (progressTenth > lastProgressTenth)
+		{
+			lastProgressTenth = progressTenth;
+			PrintMigrationLine(DevConsole::COLOR_INFO_MINOR, Stringf(" %i / %i regions (%i chunks)", numRegionsMigrated, numRegionsToMigrate, numChunksRead));
+		}
+	}
+
+	double elapsedSeconds = GetCurrentTimeSeconds() - startTime;
+	double megabytesRead = static_cast<double>(numBytesRead) / (1024.0 * 1024.0);
+	double megabytesWritten = static_cast<double>(numBytesWritten) / (1024.0 * 1024.0);
+	if (numErrorsPrinted > 20)
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf(" ...and %i more errors", numErrorsPrinted - 20));
+	}
+	PrintMigrationLine(DevConsole::COLOR_INFO_MAJOR, Stringf("%i chunks: %i upgraded, %i already %s, %i imported from chunk files, %i failed, %i stale chunk files left alone", numChunksRead,
+		numChunksUpgraded, numChunksUnchanged, ChunkCodec::GetCodecName(targetCodec), numChunksImported, numChunksFailed, numStaleLegacyFiles));
+	if (numRegionsNotCompacted > 0)
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf("%i regions couldn't be compacted, but their chunks were still migrated", numRegionsNotCompacted));
+	}
+	PrintMigrationLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Took %.2f s: %.0f chunks/s, %.1f MB read (%.1f MB/s), %.1f MB written", elapsedSeconds, static_cast<double>(numChunksRead) / elapsedSeconds,
+		megabytesRead, megabytesRead / elapsedSeconds, megabytesWritten));
+
+	return numChunksFailed == 0;
+}
+
+
+ChunkMigrationResult SaveMigrator::MigrateChunkSave(uint8_t const* chunkData, size_t chunkDataSize, unsigned int worldSeed, ChunkCodecType targetCodec, std::vector<uint8_t>& out_chunkBuffer, std::string& out_errorText)
+{
+	//walks the same layout Chunk::DecodeSaveBuffer reads, but decodes every section without needing a chunk to put it in
+	out_chunkBuffer.clear();
+
+	//check header
+	if (chunkDataSize < CHUNK_SAVE_HEADER_SIZE || chunkData[0] != 'G' || chunkData[1] != 'C' || chunkData[2] != 'H' || chunkData[3] != 'K')
+	{
+		out_errorText = "save is too short or missing its 4CC";
+		return ChunkMigrationResult::FAILED;
+	}
+	uint8_t codecVersion = chunkData[4] & ~(CHUNK_SAVE_LIGHTING_FLAG | CHUNK_SAVE_MESH_FLAG);
+	bool isOverlaySave = codecVersion == CHUNK_SAVE_OVERLAY_VERSION;
+	if (!isOverlaySave && !ChunkCodec::IsSupportedVersion(codecVersion))
+	{
+		out_errorText = Stringf("save has unsupported version %i", static_cast<int>(chunkData[4]));
+		return ChunkMigrationResult::FAILED;
+	}
+	if (chunkData[5] != CHUNK_BITS_X || chunkData[6] != CHUNK_BITS_Y || chunkData[7] != CHUNK_BITS_Z)
+	{
+		out_errorText = Stringf("save specifies incorrect number of bits (%i, %i, %i)", static_cast<int>(chunkData[5]), static_cast<int>(chunkData[6]), static_cast<int>(chunkData[7]));
+		return ChunkMigrationResult::FAILED;
+	}
+	unsigned int savedWorldSeed = static_cast<unsigned int>(chunkData[8]) | (static_cast<unsigned int>(chunkData[9]) << 8) | (static_cast<unsigned int>(chunkData[10]) << 16) | (static_cast<unsigned int>(chunkData[11]) << 24);
+	if (savedWorldSeed != worldSeed)
+	{
+		out_errorText = Stringf("save belongs to world %u", savedWorldSeed);
+		return ChunkMigrationResult::FAILED;
+	}
+
+	size_t readIndex = CHUNK_SAVE_HEADER_SIZE;
+	auto readUint32 = [chunkData, chunkDataSize, &readIndex](uint32_t& out_value)
+		{
+			if (chunkDataSize - readIndex < 4)
+			{
+				return false;
+			}
+			out_value = static_cast<uint32_t>(chunkData[readIndex]) | (static_cast<uint32_t>(chunkData[readIndex + 1]) << 8) | (static_cast<uint32_t>(chunkData[readIndex + 2]) << 16) | (static_cast<uint32_t>(chunkData[readIndex + 3]) << 24);
+			readIndex += 4;
+			return true;
+		};
+
+	//lighting and mesh sections don't depend on the block codec, so they're checked and then carried over byte for byte
+	std::string sectionErrorText;
+	if ((chunkData[4] & CHUNK_SAVE_LIGHTING_FLAG) != 0)
+	{
+		std::vector<BlockRun> lightingRuns;
+		uint32_t lightingStamp = 0;
+		uint32_t sectionSize = 0;
+		bool didReadLighting = readUint32(lightingStamp);
+		for (int runListIndex = 0; runListIndex < 2 && didReadLighting; runListIndex++)
+		{
+			didReadLighting = readUint32(sectionSize) && sectionSize <= chunkDataSize - readIndex;
+			didReadLighting = didReadLighting && ChunkCodec::DecodeBlockRuns(static_cast<uint8_t>(ChunkCodecType::PALETTE_RLE), chunkData + readIndex, sectionSize, CHUNK_TOTAL_BLOCKS, lightingRuns, sectionErrorText);
+			readIndex += didReadLighting ? sectionSize : 0;
+		}
+
+		if (!didReadLighting)
+		{
+			out_errorText = Stringf("save has a damaged lighting section (%s)", sectionErrorText.empty() ? "bad size" : sectionErrorText.c_str());
+			return ChunkMigrationResult::FAILED;
+		}
+	}
+	if ((chunkData[4] & CHUNK_SAVE_MESH_FLAG) != 0)
+	{
+		std::vector<ChunkMeshFace> meshFaces;
+		uint32_t meshHeaderValue = 0;
+		uint32_t meshDataSize = 0;
+		bool didReadMesh = readUint32(meshHeaderValue) && readUint32(meshHeaderValue) && readUint32(meshHeaderValue);	//stamp and both halves of the input hash
+		didReadMesh = didReadMesh && readUint32(meshDataSize) && meshDataSize <= chunkDataSize - readIndex;
+		didReadMesh = didReadMesh && ChunkCodec::DecodeMeshFaces(chunkData + readIndex, meshDataSize, CHUNK_TOTAL_BLOCKS, meshFaces, sectionErrorText);
+		readIndex += didReadMesh ? meshDataSize : 0;
+
+		if (!didReadMesh)
+		{
+			out_errorText = Stringf("save has a damaged mesh section (%s)", sectionErrorText.empty() ? "bad size" : sectionErrorText.c_str());
+			return ChunkMigrationResult::FAILED;
+		}
+	}
+
+	//overlay saves are already just a list of edits, which no codec changes
+	int numBlockDefs = static_cast<int>(BlockDefinition::s_blockDefs.size());
+	std::string codecErrorText;
+	if (isOverlaySave)
+	{
+		std::vector<BlockEdit> blockEdits;
+		uint32_t generatorVersion = 0;
+		if (!readUint32(generatorVersion) || !ChunkCodec::DecodeBlockEdits(chunkData + readIndex, chunkDataSize - readIndex, CHUNK_TOTAL_BLOCKS, blockEdits, codecErrorText))
+		{
+			out_errorText = Stringf("save %s", codecErrorText.empty() ? "is missing its generator version" : codecErrorText.c_str());
+			return ChunkMigrationResult::FAILED;
+		}
+		for (int editIndex = 0; editIndex < static_cast<int>(blockEdits.size()); editIndex++)
+		{
+			if (blockEdits[editIndex].m_blockType >= numBlockDefs)
+			{
+				out_errorText = Stringf("save has unknown block type %i", static_cast<int>(blockEdits[editIndex].m_blockType));
+				return ChunkMigrationResult::FAILED;
+			}
+		}
+
+		return ChunkMigrationResult::UNCHANGED;
+	}
+
+	//full saves get decoded to block types, which is also what a re-encoded copy has to decode back to
+	std::vector<BlockRun> blockRuns;
+	if (!ChunkCodec::DecodeBlockRuns(codecVersion, chunkData + readIndex, chunkDataSize - readIndex, CHUNK_TOTAL_BLOCKS, blockRuns, codecErrorText))
+	{
+		out_errorText = Stringf("save %s", codecErrorText.c_str());
+		return ChunkMigrationResult::FAILED;
+	}
+
+	auto expandBlockRuns = [](std::vector<BlockRun> const& runs, std::vector<uint8_t>& out_blockTypes)
+		{
+			//runs have to cover every block exactly, just like when loading
+			out_blockTypes.assign(CHUNK_TOTAL_BLOCKS, 0);
+			int blockIndex = 0;
+			for (int runIndex = 0; runIndex < static_cast<int>(runs.size()); runIndex++)
+			{
+				if (blockIndex + runs[runIndex].m_length > CHUNK_TOTAL_BLOCKS)
+				{
+					return false;
+				}
+				memset(out_blockTypes.data() + blockIndex, runs[runIndex].m_blockType, runs[runIndex].m_length);
+				blockIndex += runs[runIndex].m_length;
+			}
+			return blockIndex == CHUNK_TOTAL_BLOCKS;
+		};
+
+	std::vector<uint8_t> blockTypes;
+	if (!expandBlockRuns(blockRuns, blockTypes))
+	{
+		out_errorText = "save doesn't cover every block exactly";
+		return ChunkMigrationResult::FAILED;
+	}
+	for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
+	{
+		if (blockTypes[blockIndex] >= numBlockDefs)
+		{
+			out_errorText = Stringf("save has unknown block type %i", static_cast<int>(blockTypes[blockIndex]));
+			return ChunkMigrationResult::FAILED;
+		}
+	}
+
+	if (codecVersion == static_cast<uint8_t>(targetCodec))
+	{
+		return ChunkMigrationResult::UNCHANGED;
+	}
+
+	//keep the header and the other sections, swapping in the new codec and its block data
+	std::vector<uint8_t> blockData;
+	ChunkCodec::EncodeBlockTypes(targetCodec, blockTypes.data(), CHUNK_TOTAL_BLOCKS, blockData);
+	out_chunkBuffer.reserve(readIndex + blockData.size());
+	out_chunkBuffer.assign(chunkData, chunkData + readIndex);
+	out_chunkBuffer[4] = static_cast<uint8_t>(targetCodec) | (chunkData[4] & (CHUNK_SAVE_LIGHTING_FLAG | CHUNK_SAVE_MESH_FLAG));
+	out_chunkBuffer.insert(out_chunkBuffer.end(), blockData.begin(), blockData.end());
+
+	//and make sure the new data decodes to exactly the same blocks before anything gets written
+	std::vector<BlockRun> migratedBlockRuns;
+	std::vector<uint8_t> migratedBlockTypes;
+	if (!ChunkCodec::DecodeBlockRuns(static_cast<uint8_t>(targetCodec), blockData.data(), blockData.size(), CHUNK_TOTAL_BLOCKS, migratedBlockRuns, codecErrorText) || !expandBlockRuns(migratedBlockRuns, migratedBlockTypes) || migratedBlockTypes != blockTypes)
+	{
+		out_errorText = Stringf("save didn't survive being re-encoded with %s", ChunkCodec::GetCodecName(targetCodec));
+		out_chunkBuffer.clear();
+		return ChunkMigrationResult::FAILED;
+	}
+
+	return ChunkMigrationResult::UPGRADED;
+}
+
+
+//
+//static migration utilities
+//
+bool SaveMigrator::Event_MigrateSaves(EventArgs& args)
+{
+	unsigned int worldSeed = g_gameConfigBlackboard.GetValue("worldSeed", 0u);
+	worldSeed = args.GetValue("seed", worldSeed);
+
+	ChunkCodecType targetCodec = ChunkCodecType::PALETTE_RLE;
+	std::string defaultCodecName = g_gameConfigBlackboard.GetValue("chunkSaveCodec", std::string(ChunkCodec::GetCodecName(targetCodec)));
+	std::string codecName = args.GetValue("codec", defaultCodecName);
+	if (!ChunkCodec::GetCodecFromName(codecName, targetCodec))
+	{
+		PrintMigrationLine(DevConsole::COLOR_ERROR, Stringf("Unknown codec \"%s\" (use rle, palette, or lz)", codecName.c_str()));
+		return false;
+	}
+
+	bool isVerifyOnly = args.GetValue("verifyOnly", false);
+
+	return RunMigration(worldSeed, targetCodec, isVerifyOnly);
+}
+
+
+//
+//private migration functions
+//
+void SaveMigrator::PrintMigrationLine(Rgba8 const& color, std::string const& text)
+{
+	//headless runs have no dev console, but get the parent's console for stdout instead
+	if (g_theDevConsole != nullptr)
+	{
+		g_theDevConsole->AddLine(color, text);
+	}
+	else
+	{
+		printf("%s\n", text.c_str());
+	}
+	DebuggerPrintf("%s\n", text.c_str());
+}
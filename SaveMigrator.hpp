@@ -0,0 +1,34 @@
+#pragma once
+#include "Game/ChunkCodec.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include <string>
+#include <vector>
+
+
+//what happened to one saved chunk when it went through the migrator
+enum class ChunkMigrationResult
+{
+	UNCHANGED,	//already in the target format (still fully decoded and checked)
+	UPGRADED,	//block data re-encoded with the target codec and checked against the original
+	FAILED		//damaged, from another world, or didn't survive the round trip, so it's left exactly as it was
+};
+
+
+//headless tool that streams every saved chunk in a world folder through the current save format
+//each region (plus any old per-chunk files that belong in it) is handled by its own job, so whole worlds migrate on every worker at once
+//runs from the command line without starting the game (SimpleMiner.exe migratesaves seed=N codec=lz verifyOnly=true), or from the dev console for any world that isn't loaded
+class SaveMigrator
+{
+//public member functions
+public:
+	//migration functions
+	static bool					RunMigration(unsigned int worldSeed, ChunkCodecType targetCodec, bool isVerifyOnly);
+	static ChunkMigrationResult MigrateChunkSave(uint8_t const* chunkData, size_t chunkDataSize, unsigned int worldSeed, ChunkCodecType targetCodec, std::vector<uint8_t>& out_chunkBuffer, std::string& out_errorText);
+
+	//static migration utilities
+	static bool Event_MigrateSaves(EventArgs& args);
+
+//private member functions
+private:
+	static void PrintMigrationLine(Rgba8 const& color, std::string const& text);
+};
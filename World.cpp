@@ -6,15 +6,28 @@
 #include "Game/Player.hpp"
 #include "Game/GameCommon.hpp"
 #include "Game/ChunkGenerateJob.hpp"
+#include "Game/ChunkLoadJob.hpp"
+#include "Game/ChunkMeshJob.hpp"
+#include "Game/ChunkSaveJob.hpp"
+#include "Game/ChunkSectionPool.hpp"
+#include "Game/ChunkSnapshot.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/WorldBackupJob.hpp"
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Math/IntVec2.hpp"
 #include "Engine/Renderer/DebugRenderSystem.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Renderer/SpriteSheet.hpp"
 #include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Time.hpp"
 #include "Engine/Core/VertexUtils.hpp"
 #include "ThirdParty/Squirrel/SmoothNoise.hpp"
 #include <windows.h>
+#include <psapi.h>
+#include <set>
+#include <thread>
 
 
 //
@@ -26,11 +39,45 @@ World::World(Game* owner)
 	m_player = new Player(owner);
 	m_player->m_position = Vec3(0.0f, 0.0f, 70.0f);
 
-	m_worldSeed = g_gameConfigBlackboard.GetValue("worldSeed", m_worldSeed);
+	m_worldSeed = g_gameConfigBlackboard.GetValue("worldSeed", m_worldSeed.load());
+
+	std::string saveCodecName = g_gameConfigBlackboard.GetValue("chunkSaveCodec", std::string(ChunkCodec::GetCodecName(m_saveCodec)));
+	if (!ChunkCodec::GetCodecFromName(saveCodecName, m_saveCodec))
+	{
+		DebuggerPrintf("Unknown chunkSaveCodec \"%s\", saving with %s instead\n", saveCodecName.c_str(), ChunkCodec::GetCodecName(m_saveCodec));
+	}
+
+	m_useOverlaySaves = g_gameConfigBlackboard.GetValue("chunkSaveOverlays", m_useOverlaySaves);
+	m_useMappedReads = g_gameConfigBlackboard.GetValue("chunkMappedReads", m_useMappedReads);
+	m_useBakedMeshes = g_gameConfigBlackboard.GetValue("chunkBakedMeshes", m_useBakedMeshes);
+	m_useMeshJobs = g_gameConfigBlackboard.GetValue("chunkMeshJobs", m_useMeshJobs);
+	m_useIndexedQuads = g_gameConfigBlackboard.GetValue("chunkIndexedQuads", m_useIndexedQuads);
+
+	std::string mesherName = g_gameConfigBlackboard.GetValue("chunkMesher", std::string(Chunk::GetMesherName(m_mesherType)));
+	if (!Chunk::GetMesherFromName(mesherName, m_mesherType))
+	{
+		DebuggerPrintf("Unknown chunkMesher \"%s\", meshing with %s instead\n", mesherName.c_str(), Chunk::GetMesherName(m_mesherType));
+	}
+	//greedy quads need a world shader that wraps their tiled uvs back into each sprite, which hasn't shipped yet, so for now they're only built by benchmarkmeshing
+	if (m_mesherType == ChunkMesherType::GREEDY)
+	{
+		DebuggerPrintf("chunkMesher \"greedy\" needs the world shader's tiled sprite mode, so meshing with %s instead\n", Chunk::GetMesherName(ChunkMesherType::PER_FACE));
+		m_mesherType = ChunkMesherType::PER_FACE;
+	}
+
+	float chunkCacheSizeMB = g_gameConfigBlackboard.GetValue("chunkCacheSizeMB", 64.0f);
+	m_chunkCache.SetMemoryBudget(static_cast<size_t>(chunkCacheSizeMB * 1024.0f * 1024.0f));
 
 	CreateDirectoryA("Saves", NULL);
-	std::string worldFolderPath = Stringf("Saves\\World_%u", m_worldSeed);
+	std::string worldFolderPath = Stringf("Saves\\World_%u", m_worldSeed.load());
 	CreateDirectoryA(worldFolderPath.c_str(), NULL);
+
+	BuildSavedChunkIndex();
+	m_chunkSaveQueue.Startup(this);
+	m_editJournal.Startup(this);
+	m_worldBackup.Startup(this);
+
+	m_fullViewStartTime = GetCurrentTimeSeconds();
 }
 
 
@@ -40,6 +87,21 @@ World::~World()
 	{
 		delete chunkIndex->second;
 	}
+
+	//a running backup may still be reading from the region files
+	m_worldBackup.Shutdown();
+
+	for (Job* deferredJob : m_deferredCompletedJobs)
+	{
+		delete deferredJob;
+	}
+
+	//anything edited in chunks that weren't deactivated is still in the journal for next time
+	m_editJournal.Shutdown();
+
+	//finish writing any queued saves before the region files go away
+	m_chunkSaveQueue.Shutdown();
+	CloseAllRegionFiles();
 	
 	delete m_player;
 }
@@ -50,15 +112,60 @@ World::~World()
 //
 void World::Update()
 {
-	//check for completed chunk generate jobs to retrieve
+	//check for completed chunk generate, load, and mesh jobs to retrieve (starting with any that a flush had to set aside)
+	std::vector<Job*> completedJobs;
+	completedJobs.swap(m_deferredCompletedJobs);
 	while (g_theJobSystem->AreThereCompletedJobs())
 	{
-		ChunkGenerateJob* completedJob = dynamic_cast<ChunkGenerateJob*>(g_theJobSystem->ClaimCompletedJob());
-		if (completedJob != nullptr)
+		completedJobs.push_back(g_theJobSystem->ClaimCompletedJob());
+	}
+
+	for (Job* completedJob : completedJobs)
+	{
+		Chunk* completedChunk = nullptr;
+		if (ChunkGenerateJob* generateJob = dynamic_cast<ChunkGenerateJob*>(completedJob))
+		{
+			completedChunk = generateJob->m_chunk;
+		}
+		else if (ChunkLoadJob* loadJob = dynamic_cast<ChunkLoadJob*>(completedJob))
+		{
+			completedChunk = loadJob->m_chunk;
+		}
+		else if (ChunkMeshJob* meshJob = dynamic_cast<ChunkMeshJob*>(completedJob))
+		{
+			//the chunk may have been deactivated (or even deactivated and activated again) while its mesh was building
+			auto chunkFound = m_activeChunks.find(meshJob->m_chunkCoords);
+			if (chunkFound != m_activeChunks.end())
+			{
+				chunkFound->second->OnMeshJobCompleted(meshJob);
+			}
+			m_numMeshJobsRunning--;
+			delete meshJob;
+			continue;
+		}
+		else if (WorldBackupJob* backupJob = dynamic_cast<WorldBackupJob*>(completedJob))
+		{
+			m_worldBackup.OnBackupJobCompleted(backupJob);
+			continue;
+		}
+		else
 		{
-			ActivateChunk(completedJob->m_chunk->m_chunkCoords, completedJob->m_chunk);
 			delete completedJob;
+			continue;
+		}
+
+		//chunks that were cancelled while queued just get thrown away (anything they had is still on disk or in the save queue)
+		if (completedChunk->m_isCancelled)
+		{
+			m_queuedChunks.erase(completedChunk->m_chunkCoords);
+			delete completedChunk;
+		}
+		else
+		{
+			ActivateChunk(completedChunk->m_chunkCoords, completedChunk);
 		}
+
+		delete completedJob;
 	}
 	
 	float currentWorldTimeScale = m_worldTimeScale;
@@ -90,6 +197,18 @@ void World::Update()
 		m_drawPlayerChunkBoundaries = !m_drawPlayerChunkBoundaries;
 	}
 
+	//debug key to switch between indexed and unindexed quads, which also remeshes every active chunk
+	if (g_theInput->WasKeyJustPressed('I'))
+	{
+		m_useIndexedQuads = !m_useIndexedQuads;
+		for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+		{
+			chunkIndex->second->m_areVertsDirty = true;
+		}
+		m_meshBuildSeconds = 0.0;
+		m_numMeshesBuilt = 0;
+	}
+
 	//time acceleration debug key
 	if (g_theInput->IsKeyDown('Y'))
 	{
@@ -99,16 +218,36 @@ void World::Update()
 	//debug key to deactivate all chunks
 	if (g_theInput->WasKeyJustPressed(KEYCODE_F8))
 	{
-		DeactivateAllChunks();
+		DeactivateAllChunks(PrintChunkFlushProgress);
 	}
 
 	//debug key to change seed
 	if (g_theInput->WasKeyJustPressed(KEYCODE_F9))
 	{
-		DeactivateAllChunks();
-		m_worldSeed++;
-		std::string worldFolderPath = Stringf("Saves\\World_%u", m_worldSeed);
+		//nothing that's still reading or writing the old seed's region files can be left running once they close
+		DeactivateAllChunks(PrintChunkFlushProgress);
+		CancelAllQueuedChunks();
+		WaitForChunkJobs();
+		m_chunkCache.Clear();
+		m_worldBackup.Shutdown();
+		m_editJournal.Shutdown();
+		CloseAllRegionFiles();
+		{
+			//saves that are still being retried keep going to the old seed's regions, since they're written with their snapshot's seed
+			std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+			m_worldSeed++;
+		}
+		std::string worldFolderPath = Stringf("Saves\\World_%u", m_worldSeed.load());
 		CreateDirectoryA(worldFolderPath.c_str(), NULL);
+		BuildSavedChunkIndex();
+		m_editJournal.Startup(this);
+		m_worldBackup.Startup(this);
+
+		m_fullViewStartTime = GetCurrentTimeSeconds();
+		m_fullViewSeconds = -1.0;
+		m_numStreamingFrames = 0;
+		m_streamingFrameSeconds = 0.0;
+		m_streamingFrameSecondsSquared = 0.0;
 	}
 
 	//chunk activation logic
@@ -127,14 +266,21 @@ void World::Update()
 			if (foundMissingChunk)
 			{
 				Chunk* newChunk = new Chunk(missingChunkCoords, this);
+				std::shared_ptr<ChunkSnapshot const> pendingSave;
 
-				//check if chunk exists on disk here
-				std::string fileName = Stringf("Saves//World_%u/Chunk(%i,%i).chunk", m_worldSeed, missingChunkCoords.x, missingChunkCoords.y);
-				if (CheckForFile(fileName))
+				//check if chunk was recently deactivated and is still cached in memory
+				if (m_chunkCache.RestoreChunk(missingChunkCoords, newChunk))
 				{
-					newChunk->LoadChunk();
 					ActivateChunk(missingChunkCoords, newChunk);
 				}
+				//then check if it's still waiting to be saved or exists on disk, and post a job to load it if so
+				//(pending saves win, since the disk copy would be stale)
+				else if (m_chunkSaveQueue.GetPendingSave(missingChunkCoords, m_worldSeed, pendingSave) || DoesSavedChunkExist(missingChunkCoords))
+				{
+					ChunkLoadJob* chunkJob = new ChunkLoadJob(newChunk, pendingSave);
+					g_theJobSystem->PostNewJob(chunkJob);
+					m_queuedChunks.emplace(missingChunkCoords, newChunk);
+				}
 				else
 				{
 					//otherwise, post a job to populate its blocks
@@ -154,6 +300,24 @@ void World::Update()
 			DeactivateChunk(inactiveChunkCoords);
 		}
 	}
+	CancelDistantQueuedChunks(chunkDeactivationDistance);
+	CloseUnusedRegionFiles();
+
+	//append any buffered block edits to the journal, and compact it once it gets big
+	m_editJournal.Update();
+
+	//save some of the edited chunks that are still active, and let chunks whose saves have been written know they're clean
+	UpdateWrittenSaves();
+	UpdateAutosave();
+
+	//take a backup snapshot if one is due
+	m_worldBackup.Update();
+
+	//section residency logic (by default, sections go once they're entirely past the fog's far distance, where they can't be seen anyway)
+	//(that's the same far distance ShaderGameConstants gives the world shader, and sections come back two section heights inside it)
+	static float sectionActivationDistance = g_gameConfigBlackboard.GetValue("sectionActivationDistance", chunkActivationDistance - 16.0f - static_cast<float>(CHUNK_SECTION_SIZE_Z * 2));
+	static float sectionDeactivationDistance = sectionActivationDistance + static_cast<float>(CHUNK_SECTION_SIZE_Z * 2);
+	UpdateSectionResidency(sectionActivationDistance, sectionDeactivationDistance);
 
 	//do raycast for digging/placing
 	GameRaycastResult3D blockRaycast = RaycastVsBlocks(m_blockRaycastStart, m_blockRaycastDirection, 8.0f);
@@ -264,20 +428,23 @@ void World::Update()
 		{
 			//set block to air and mark lighting as dirty
 			int blockIndex = blockRaycast.m_impactedBlock.GetBlockIndex();
+			uint8_t oldBlockType = chunk->GetBlock(blockIndex)->m_blockType;
 			chunk->SetBlockType(blockIndex, "air");
+			m_editJournal.RecordEdit(chunk->m_chunkCoords, blockIndex, oldBlockType, chunk->GetBlock(blockIndex)->m_blockType);
 			MarkLightingDirty(chunk, blockIndex);
+			MarkChunksForUrgentRemesh(chunk, blockIndex);
 
 			//if block above is sky, descend downward and set each block to sky and mark lighting as dirty until hitting opaque block
 			BlockIterator blockAbove = BlockIterator(blockIndex, chunk).GetSkywardNeighbor();
 			if (blockAbove.GetBlock()->IsSky())
 			{
-				Block* block = &chunk->m_blocks[blockIndex];
+				Block* block = chunk->GetBlockForWrite(blockIndex);
 				block->SetIsSky(true);
 				BlockIterator nextBlockBelow = BlockIterator(blockIndex, chunk).GetDownwardNeighbor();
 
 				while (nextBlockBelow.GetChunk() != nullptr && !chunk->IsBlockOpaque(nextBlockBelow.GetBlockIndex()))
 				{
-					nextBlockBelow.GetBlock()->SetIsSky(true);
+					nextBlockBelow.GetBlockForWrite()->SetIsSky(true);
 					MarkLightingDirty(nextBlockBelow.GetChunk(), nextBlockBelow.GetBlockIndex());
 					nextBlockBelow = nextBlockBelow.GetDownwardNeighbor();
 				}
@@ -322,20 +489,23 @@ void World::Update()
 			{
 				//set block type and mark as dirty
 				int blockIndex = blockIter.GetBlockIndex();
+				uint8_t oldBlockType = chunkOfPlacedBlock->GetBlock(blockIndex)->m_blockType;
 				chunkOfPlacedBlock->SetBlockType(blockIndex, m_player->m_blockIDToPlace);
+				m_editJournal.RecordEdit(chunkOfPlacedBlock->m_chunkCoords, blockIndex, oldBlockType, m_player->m_blockIDToPlace);
 				MarkLightingDirty(chunkOfPlacedBlock, blockIndex);
+				MarkChunksForUrgentRemesh(chunkOfPlacedBlock, blockIndex);
 
 				//if block was sky, set it to no longer be sky, then clear all sky flags and flag dirty lighting directly below until hitting opaque
 				BlockIterator thisBlock = BlockIterator(blockIndex, chunkOfPlacedBlock);
 				if (thisBlock.GetBlock()->IsSky() && thisBlock.GetBlock()->IsOpaque())
 				{
-					thisBlock.GetBlock()->SetIsSky(false);
+					thisBlock.GetBlockForWrite()->SetIsSky(false);
 
 					BlockIterator nextBlockBelow = BlockIterator(blockIndex, chunkOfPlacedBlock).GetDownwardNeighbor();
 
 					while (nextBlockBelow.GetChunk() != nullptr && !chunk->IsBlockOpaque(nextBlockBelow.GetBlockIndex()))
 					{
-						nextBlockBelow.GetBlock()->SetIsSky(false);
+						nextBlockBelow.GetBlockForWrite()->SetIsSky(false);
 						MarkLightingDirty(nextBlockBelow.GetChunk(), nextBlockBelow.GetBlockIndex());
 						nextBlockBelow = nextBlockBelow.GetDownwardNeighbor();
 					}
@@ -348,15 +518,32 @@ void World::Update()
 	ProcessDirtyLighting();
 	
 	//update chunks
+	UpdateChunkMeshes();
 	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
 	{
 		Chunk*& chunk = chunkIndex->second;
 		if (chunk != nullptr)
 		{
-			chunk->Update();
+			//once lighting has settled, let identical sections be shared between chunks
+			if (m_dirtyBlocks.size() == 0)
+			{
+				chunk->ShareIdenticalSections();
+			}
 		}
 	}
 
+	//sections only drop out of use as chunks get edited or go away, so walking the whole pool every frame isn't worth it
+	static float sectionPoolPruneSeconds = g_gameConfigBlackboard.GetValue("sectionPoolPruneSeconds", 2.0f);
+	double currentTime = GetCurrentTimeSeconds();
+	if (currentTime - m_lastSectionPoolPruneTime >= static_cast<double>(sectionPoolPruneSeconds))
+	{
+		ChunkSectionPool::PruneUnusedSections();
+		m_lastSectionPoolPruneTime = currentTime;
+	}
+
+	UpdateStreamingFrameStats();
+	UpdateFullViewTimer();
+
 	//update world time
 	m_worldTime += (m_game->m_gameClock.GetDeltaSeconds() * currentWorldTimeScale) / (86400.0f);
 	std::string timeMessage = Stringf("Current day/time: %.3f", m_worldTime);
@@ -548,10 +735,31 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 		southChunk->m_northNeighbor = chunk;
 	}
 
+	//sections entirely above this chunk's terrain just share the pooled open sky section
+	chunk->ShareOpenSkySections();
+
+	//find the highest non-air block in this chunk and its neighbors, since everything above that is open sky on both sides of every boundary
+	int neighborhoodHighestNonAirZ = chunk->m_highestNonAirZ;
+	Chunk* neighbors[4] = { chunk->m_eastNeighbor, chunk->m_westNeighbor, chunk->m_northNeighbor, chunk->m_southNeighbor };
+	for (int neighborIndex = 0; neighborIndex < 4; neighborIndex++)
+	{
+		if (neighbors[neighborIndex] != nullptr && neighbors[neighborIndex]->m_highestNonAirZ > neighborhoodHighestNonAirZ)
+		{
+			neighborhoodHighestNonAirZ = neighbors[neighborIndex]->m_highestNonAirZ;
+		}
+	}
+
+	//indoor light can still spread up to 15 blocks above that, so boundary blocks higher than that can't possibly need relighting
+	int boundaryMaxZ = neighborhoodHighestNonAirZ + 15;
+	if (boundaryMaxZ > CHUNK_MAX_Z)
+	{
+		boundaryMaxZ = CHUNK_MAX_Z;
+	}
+
 	//mark non-opaque boundary blocks as dirty
 	for (int blockX = 0; blockX < CHUNK_SIZE_X; blockX++)
 	{
-		for (int blockZ = 0; blockZ < CHUNK_SIZE_Z; blockZ++)
+		for (int blockZ = 0; blockZ <= boundaryMaxZ; blockZ++)
 		{
 			int blockY = 0;
 
@@ -572,7 +780,7 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 	}
 	for (int blockY = 0; blockY < CHUNK_SIZE_Y; blockY++)
 	{
-		for (int blockZ = 0; blockZ < CHUNK_SIZE_Z; blockZ++)
+		for (int blockZ = 0; blockZ <= boundaryMaxZ; blockZ++)
 		{
 			int blockX = 0;
 
@@ -592,12 +800,65 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 		}
 	}
 
+	//a chunk with cached lighting probably won't change when its boundary is relit, so it also has to relight neighbors' boundaries
+	//in case they were relit while it was gone
+	if (chunk->m_hasCachedLighting)
+	{
+		for (int blockZ = 0; blockZ <= boundaryMaxZ; blockZ++)
+		{
+			for (int blockX = 0; blockX < CHUNK_SIZE_X; blockX++)
+			{
+				BlockIterator southNeighbor = BlockIterator(chunk->GetBlockIndexFromLocalCoords(blockX, 0, blockZ), chunk).GetSouthNeighbor();
+				BlockIterator northNeighbor = BlockIterator(chunk->GetBlockIndexFromLocalCoords(blockX, CHUNK_MAX_Y, blockZ), chunk).GetNorthNeighbor();
+				if (southNeighbor.GetChunk() != nullptr && !southNeighbor.GetBlock()->IsOpaque())
+				{
+					MarkLightingDirty(southNeighbor.GetChunk(), southNeighbor.GetBlockIndex());
+				}
+				if (northNeighbor.GetChunk() != nullptr && !northNeighbor.GetBlock()->IsOpaque())
+				{
+					MarkLightingDirty(northNeighbor.GetChunk(), northNeighbor.GetBlockIndex());
+				}
+			}
+			for (int blockY = 0; blockY < CHUNK_SIZE_Y; blockY++)
+			{
+				BlockIterator westNeighbor = BlockIterator(chunk->GetBlockIndexFromLocalCoords(0, blockY, blockZ), chunk).GetWestNeighbor();
+				BlockIterator eastNeighbor = BlockIterator(chunk->GetBlockIndexFromLocalCoords(CHUNK_MAX_X, blockY, blockZ), chunk).GetEastNeighbor();
+				if (westNeighbor.GetChunk() != nullptr && !westNeighbor.GetBlock()->IsOpaque())
+				{
+					MarkLightingDirty(westNeighbor.GetChunk(), westNeighbor.GetBlockIndex());
+				}
+				if (eastNeighbor.GetChunk() != nullptr && !eastNeighbor.GetBlock()->IsOpaque())
+				{
+					MarkLightingDirty(eastNeighbor.GetChunk(), eastNeighbor.GetBlockIndex());
+				}
+			}
+		}
+
+		//everything inside the chunk was already settled when it was cached or saved, so reconciling the boundaries is all it needs
+		chunk->m_hasCachedLighting = false;
+		return;
+	}
+
+	//sections above everything in this chunk are already sky and fully lit, so sky only needs to be carried down from the top of the highest non-sky section
+	int skyDescentStartZ = (((chunk->m_highestNonAirZ >> CHUNK_SECTION_BITS_Z) + 1) << CHUNK_SECTION_BITS_Z) - 1;
+	if (skyDescentStartZ > CHUNK_MAX_Z)
+	{
+		skyDescentStartZ = CHUNK_MAX_Z;
+	}
+
+	//sky blocks next to a neighbor's overhang still need to light it, so the second descent has to start at least that high
+	int skyLightDescentStartZ = skyDescentStartZ;
+	if (neighborhoodHighestNonAirZ > skyLightDescentStartZ)
+	{
+		skyLightDescentStartZ = neighborhoodHighestNonAirZ;
+	}
+
 	//descend down each column and mark sky blocks
 	for (int blockX = 0; blockX < CHUNK_SIZE_X; blockX++)
 	{
 		for (int blockY = 0; blockY < CHUNK_SIZE_Y; blockY++)
 		{
-			int blockZ = CHUNK_MAX_Z;
+			int blockZ = skyDescentStartZ;
 			
 			while (blockZ >= 0 && !chunk->IsBlockOpaque(blockX, blockY, blockZ))
 			{
@@ -612,7 +873,7 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 	{
 		for (int blockY = 0; blockY < CHUNK_SIZE_Y; blockY++)
 		{
-			int blockZ = CHUNK_MAX_Z;
+			int blockZ = skyLightDescentStartZ;
 
 			while (blockZ >= 0 && !chunk->IsBlockOpaque(blockX, blockY, blockZ))
 			{
@@ -620,7 +881,10 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 				
 				//set block's outdoor light influence
 				BlockIterator blockIter = BlockIterator(blockIndex, chunk);
-				blockIter.GetBlock()->SetOutdoorLightLevel(15);
+				if (blockIter.GetBlock()->GetOutdoorLightLevel() != 15)
+				{
+					blockIter.GetBlockForWrite()->SetOutdoorLightLevel(15);
+				}
 				
 				//mark non-opaque, non-sky horizontal neighbors as dirty
 				BlockIterator eastNeighbor = blockIter.GetEastNeighbor();
@@ -650,13 +914,10 @@ void World::ActivateChunk(IntVec2 chunkCoords, Chunk* chunk)
 		}
 	}
 
-	//loop through all blocks and mark light-emitting blocks as dirty
-	for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
+	//mark light-emitting blocks as dirty (chunk keeps track of these, so no need to loop through every block)
+	for (int emitterIndex = 0; emitterIndex < chunk->m_lightEmitterIndices.size(); emitterIndex++)
 	{
-		if (chunk->GetBlockLightEmissionValue(blockIndex) > 0)
-		{
-			MarkLightingDirty(chunk, blockIndex);
-		}
+		MarkLightingDirty(chunk, chunk->m_lightEmitterIndices[emitterIndex]);
 	}
 }
 
@@ -736,189 +997,897 @@ void World::DeactivateChunk(IntVec2 chunkCoords)
 	
 	m_activeChunks.erase(chunkCoords);
 
-	//do saving here
+	//hand saving off to the save thread here
 	if (deactivatedChunk->m_needsSaving)
 	{
-		deactivatedChunk->SaveChunk();
+		m_chunkSaveQueue.QueueChunkSave(deactivatedChunk->TakeSnapshot());
+		deactivatedChunk->m_needsSaving = false;
 	}
 
+	//hold on to a compressed copy in case the player comes right back
+	m_chunkCache.AddChunk(deactivatedChunk);
+
 	delete deactivatedChunk;
 }
 
 
-void World::DeactivateAllChunks()
+void World::DeactivateAllChunks(ChunkFlushProgressCallback progressCallback)
 {
+	//everything is usually deactivated right before the seed changes or the game closes, so save it all right here instead of trickling it through the save queue
+	//anything already in the queue is older than what's about to be written, so it has to land first
+	bool didFlushSaveQueue = m_chunkSaveQueue.Flush();
+
+	//chunks that still have an older save queued (because its write keeps failing) go through the queue instead, so the newer blocks replace it there
+	//(written directly, a later retry of the old save would land on top of them)
+	std::vector<Chunk*> chunksToSave;
+	bool didQueueSaves = false;
 	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
 	{
-		//gonna deactivate a little differently here because the normal way breaks the for loop using the iterator
-		
-		Chunk* deactivatedChunk = chunkIndex->second;
-
-		//do same saving thing here as in normal deactivate chunk function
-		if (deactivatedChunk->m_needsSaving)
+		Chunk* chunk = chunkIndex->second;
+		if (!chunk->m_needsSaving)
 		{
-			deactivatedChunk->SaveChunk();
+			continue;
 		}
 
-		if (deactivatedChunk != nullptr)
+		std::shared_ptr<ChunkSnapshot const> pendingSave;
+		if (m_chunkSaveQueue.GetPendingSave(chunk->m_chunkCoords, m_worldSeed, pendingSave))
 		{
-			delete deactivatedChunk;
-			deactivatedChunk = nullptr;
+			m_chunkSaveQueue.QueueChunkSave(chunk->TakeSnapshot());
+			chunk->m_needsSaving = false;
+			didQueueSaves = true;
+			continue;
 		}
+
+		chunksToSave.push_back(chunk);
+	}
+
+	int numFailedSaves = SaveChunksInParallel(chunksToSave, progressCallback);
+	if (didQueueSaves)
+	{
+		didFlushSaveQueue = m_chunkSaveQueue.Flush();
 	}
 
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		delete chunkIndex->second;
+	}
 	m_activeChunks.clear();
+
+	//once it's all on disk nothing in the journal is needed anymore, but keep it around if anything failed so the edits can still be replayed
+	if (numFailedSaves > 0 || !didFlushSaveQueue)
+	{
+		DebuggerPrintf("%i chunks failed to save (%i more still queued), keeping the edit journal\n", numFailedSaves, m_chunkSaveQueue.GetNumRetryingSaves());
+		m_editJournal.FlushBatch();
+		return;
+	}
+
+	m_editJournal.Reset();
 }
 
 
-//
-//public raycast functions
-//
-GameRaycastResult3D World::RaycastVsBlocks(Vec3 const& startPosition, Vec3 const& directionNormal, float distance)
+int World::SaveChunksInParallel(std::vector<Chunk*> const& chunks, ChunkFlushProgressCallback progressCallback)
 {
-	//go ahead and set up raycast result
-	GameRaycastResult3D raycastResult;
-	raycastResult.m_rayStartPosition = startPosition;
-	raycastResult.m_rayDirection = directionNormal;
-	raycastResult.m_rayLength = distance;
-	
-	//get world coordinates of block raycast starts in
-	int worldX = static_cast<int>(floorf(startPosition.x));
-	int worldY = static_cast<int>(floorf(startPosition.y));
-	int worldZ = static_cast<int>(floorf(startPosition.z));
+	//each job in flight holds a snapshot and an encode buffer, so cap how many there are at once instead of snapshotting everything up front
+	static int maxSaveJobsInFlight = g_gameConfigBlackboard.GetValue("chunkFlushMaxJobsInFlight", 64);
+	int maxJobsInFlight = maxSaveJobsInFlight > 0 ? maxSaveJobsInFlight : 1;
 
-	//get chunk coordinates from world coordinates
-	int chunkX = worldX >> CHUNK_BITS_X;
-	int chunkY = worldY >> CHUNK_BITS_Y;
-	
-	//get chunk you're in (or if you aren't in an active chunk somehow, just don't bother)
-	auto chunkFound = m_activeChunks.find(IntVec2(chunkX, chunkY));
-	if (chunkFound == m_activeChunks.end())
+	int numChunksToSave = static_cast<int>(chunks.size());
+	int numChunksPosted = 0;
+	int numChunksSaved = 0;
+	int numFailedSaves = 0;
+
+	while (numChunksSaved < numChunksToSave)
 	{
-		return GameRaycastResult3D();
-	}
-	Chunk* chunk = chunkFound->second;
+		while (numChunksPosted < numChunksToSave && numChunksPosted - numChunksSaved < maxJobsInFlight)
+		{
+			Chunk* chunk = chunks[numChunksPosted];
+			g_theJobSystem->PostNewJob(new ChunkSaveJob(this, chunk->TakeSnapshot()));
+			chunk->m_needsSaving = false;
+			numChunksPosted++;
+		}
 
-	//get local block coordinates
-	int localX = worldX - (chunkX * CHUNK_SIZE_X);
-	int localY = worldY - (chunkY * CHUNK_SIZE_Y);
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
 
-	//get block index
-	int blockIndex = localX + (localY << CHUNK_BITS_X) + (worldZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
+		//generate and load jobs share the completed list, so hang on to those for the next update
+		Job* completedJob = g_theJobSystem->ClaimCompletedJob();
+		ChunkSaveJob* saveJob = dynamic_cast<ChunkSaveJob*>(completedJob);
+		if (saveJob == nullptr)
+		{
+			m_deferredCompletedJobs.push_back(completedJob);
+			continue;
+		}
 
-	//return blank raycast if above or below active chunk
-	if (blockIndex < 0 || blockIndex >= CHUNK_TOTAL_BLOCKS)
-	{
-		return raycastResult;
+		if (!saveJob->m_wasSaved)
+		{
+			DebuggerPrintf("Failed to save chunk %i, %i\n", saveJob->m_chunkCoords.x, saveJob->m_chunkCoords.y);
+			numFailedSaves++;
+		}
+		delete saveJob;
+		numChunksSaved++;
+
+		if (progressCallback != nullptr)
+		{
+			progressCallback(numChunksSaved, numChunksToSave);
+		}
 	}
 
-	//create block iterator for block we're in
-	BlockIterator blockIter = BlockIterator(blockIndex, chunk);
+	return numFailedSaves;
+}
 
-	//return blank raycast if not in an active chunk
-	if (blockIter.GetChunk() == nullptr)
-	{
-		return raycastResult;
-	}
 
-	//if we're already in a solid block, we're done
-	if (blockIter.GetBlock()->IsSolid())
+void World::CancelDistantQueuedChunks(float deactivationRadius)
+{
+	Vec2 playerPositionXY = Vec2(m_player->m_position.x, m_player->m_position.y);
+
+	//queued chunks use the same radius as active ones, so anything that would be deactivated right away isn't worth generating or loading
+	for (auto chunkIndex = m_queuedChunks.begin(); chunkIndex != m_queuedChunks.end(); chunkIndex++)
 	{
-		raycastResult.m_impactedBlock = blockIter;
-		raycastResult.m_didImpact = true;
-		raycastResult.m_impactDist = 0.0f;
-		raycastResult.m_impactPos = startPosition;
-		raycastResult.m_impactNormal = Vec3();
-		return raycastResult;
+		Chunk* chunk = chunkIndex->second;
+		Vec2 chunkCenter = Vec2(chunk->m_bounds.m_mins.x + (static_cast<float>(CHUNK_SIZE_X) * 0.5f), chunk->m_bounds.m_mins.y + (static_cast<float>(CHUNK_SIZE_Y) * 0.5f));
+
+		if (!IsPointInsideDisc2D(chunkCenter, playerPositionXY, deactivationRadius))
+		{
+			chunk->m_isCancelled = true;
+		}
 	}
+}
 
-	//initialization step
-	float distPerXCrossing = 1.0f / (fabsf(directionNormal.x));
-	int stepDirectionX;
-	if (directionNormal.x < 0) stepDirectionX = -1;
-	else stepDirectionX = 1;
-	float xAtFirstXCrossing = static_cast<float>(worldX + (stepDirectionX + 1) / 2);
-	float xDistToFirstXCrossing = xAtFirstXCrossing - startPosition.x;
-	float totalDistAtNextXCrossing = fabsf(xDistToFirstXCrossing) * distPerXCrossing;
 
-	float distPerYCrossing = 1.0f / (fabsf(directionNormal.y));
-	int stepDirectionY;
-	if (directionNormal.y < 0) stepDirectionY = -1;
-	else stepDirectionY = 1;
-	float yAtFirstYCrossing = static_cast<float>(worldY + (stepDirectionY + 1) / 2);
-	float yDistToFirstYCrossing = yAtFirstYCrossing - startPosition.y;
-	float totalDistAtNextYCrossing = fabsf(yDistToFirstYCrossing) * distPerYCrossing;
+void World::CancelAllQueuedChunks()
+{
+	for (auto chunkIndex = m_queuedChunks.begin(); chunkIndex != m_queuedChunks.end(); chunkIndex++)
+	{
+		chunkIndex->second->m_isCancelled = true;
+	}
+}
 
-	float distPerZCrossing = 1.0f / (fabsf(directionNormal.z));
-	int stepDirectionZ;
-	if (directionNormal.z < 0) stepDirectionZ = -1;
-	else stepDirectionZ = 1;
-	float zAtFirstZCrossing = static_cast<float>(worldZ + (stepDirectionZ + 1) / 2);
-	float zDistToFirstZCrossing = zAtFirstZCrossing - startPosition.z;
-	float totalDistAtNextZCrossing = fabsf(zDistToFirstZCrossing) * distPerZCrossing;
 
-	//main raycast loop
-	while (totalDistAtNextXCrossing < distance || totalDistAtNextYCrossing < distance || totalDistAtNextZCrossing < distance)
+void World::WaitForChunkJobs()
+{
+	//generate, load, and mesh jobs read the seed, region files, and blocks from worker threads, so this waits until every one of them has come back
+	//(including any a flush already claimed and set aside), while anything else is set aside for the next update
+	std::vector<Job*> completedJobs;
+	completedJobs.swap(m_deferredCompletedJobs);
+	while (true)
 	{
-		if (totalDistAtNextXCrossing <= totalDistAtNextYCrossing && totalDistAtNextXCrossing <= totalDistAtNextZCrossing)
+		for (Job* completedJob : completedJobs)
 		{
-			//return blank raycast if we surpass max raycast distance
-			if (totalDistAtNextXCrossing > distance)
+			Chunk* completedChunk = nullptr;
+			if (ChunkGenerateJob* generateJob = dynamic_cast<ChunkGenerateJob*>(completedJob))
 			{
-				return raycastResult;
+				completedChunk = generateJob->m_chunk;
 			}
-
-			if (stepDirectionX == 1) blockIter = blockIter.GetEastNeighbor();
-			else if (stepDirectionX == -1) blockIter = blockIter.GetWestNeighbor();
-
-			//if next block is in unactivated chunk, return blank raycast
-			if (blockIter.GetChunk() == nullptr)
+			else if (ChunkLoadJob* loadJob = dynamic_cast<ChunkLoadJob*>(completedJob))
 			{
-				return raycastResult;
+				completedChunk = loadJob->m_chunk;
 			}
-
-			//if next block is solid, hit
-			if (blockIter.GetBlock()->IsSolid())
+			else if (ChunkMeshJob* meshJob = dynamic_cast<ChunkMeshJob*>(completedJob))
 			{
-				raycastResult.m_didImpact = true;
-				raycastResult.m_impactDist = totalDistAtNextXCrossing;
-				raycastResult.m_impactPos = startPosition + (directionNormal * totalDistAtNextXCrossing);
-				if (stepDirectionX == -1)
-				{
-					raycastResult.m_impactNormal = Vec3(1.0f, 0.0f, 0.0f);
-				}
-				else
+				auto chunkFound = m_activeChunks.find(meshJob->m_chunkCoords);
+				if (chunkFound != m_activeChunks.end())
 				{
-					raycastResult.m_impactNormal = Vec3(-1.0f, 0.0f, 0.0f);
+					chunkFound->second->OnMeshJobCompleted(meshJob);
 				}
-				raycastResult.m_impactedBlock = blockIter;
-				return raycastResult;
+				m_numMeshJobsRunning--;
+				delete meshJob;
+				continue;
 			}
-
-			//otherwise, step forward
-			totalDistAtNextXCrossing += distPerXCrossing;
-		}
-		else if (totalDistAtNextYCrossing <= totalDistAtNextXCrossing && totalDistAtNextYCrossing <= totalDistAtNextZCrossing)
-		{
-			//return blank raycast if we surpass max raycast distance
-			if (totalDistAtNextYCrossing > distance)
+			else
 			{
-				return raycastResult;
+				m_deferredCompletedJobs.push_back(completedJob);
+				continue;
 			}
 
-			if (stepDirectionY == 1) blockIter = blockIter.GetNorthNeighbor();
-			else if (stepDirectionY == -1) blockIter = blockIter.GetSouthNeighbor();
-
-			//if next block is in unactivated chunk, return blank raycast
-			if (blockIter.GetChunk() == nullptr)
+			if (completedChunk->m_isCancelled)
 			{
-				return raycastResult;
+				m_queuedChunks.erase(completedChunk->m_chunkCoords);
+				delete completedChunk;
 			}
-
-			//if next block is solid, hit
-			if (blockIter.GetBlock()->IsSolid())
+			else
 			{
-				raycastResult.m_didImpact = true;
+				ActivateChunk(completedChunk->m_chunkCoords, completedChunk);
+			}
+			delete completedJob;
+		}
+		completedJobs.clear();
+
+		if (m_queuedChunks.empty() && m_numMeshJobsRunning <= 0)
+		{
+			return;
+		}
+
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		completedJobs.push_back(g_theJobSystem->ClaimCompletedJob());
+	}
+}
+
+
+void World::GetSectionSharingStats(int& out_totalSections, int& out_uniqueSections) const
+{
+	//count how many sections active chunks refer to, vs. how many distinct sections are actually allocated
+	std::set<ChunkSection const*> uniqueSections;
+	out_totalSections = 0;
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk const* chunk = chunkIndex->second;
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+		{
+			if (chunk->IsSectionEvicted(sectionIndex))
+			{
+				continue;
+			}
+
+			uniqueSections.insert(chunk->m_sections[sectionIndex].get());
+			out_totalSections++;
+		}
+	}
+
+	out_uniqueSections = static_cast<int>(uniqueSections.size());
+}
+
+
+double World::GetProcessMemoryUsedMB()
+{
+	//private bytes committed by the whole process, not just chunk data
+	PROCESS_MEMORY_COUNTERS_EX memoryCounters = {};
+	memoryCounters.cb = sizeof(memoryCounters);
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof(memoryCounters)))
+	{
+		return 0.0;
+	}
+
+	return static_cast<double>(memoryCounters.PrivateUsage) / (1024.0 * 1024.0);
+}
+
+
+bool World::Event_MeasureSectionSharing(EventArgs& args)
+{
+	UNUSED(args);
+
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Section sharing measurement needs a world, so start the game first");
+		return false;
+	}
+
+	//mesh jobs read sections straight out of active chunks, so nothing can be running while they get swapped
+	if (!world->m_queuedChunks.empty() || world->m_numMeshJobsRunning > 0 || !world->m_deferredCompletedJobs.empty())
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Section sharing measurement can't run while chunks are still loading or meshing, so try again in a moment");
+		return false;
+	}
+
+	int totalSections = 0;
+	int uniqueSections = 0;
+	world->GetSectionSharingStats(totalSections, uniqueSections);
+	double sharedMB = GetProcessMemoryUsedMB();
+
+	//give every resident section its own copy, the way it would be without the pool, and measure again
+	//the shared sections are held onto meanwhile, so the difference is only what the extra copies cost
+	std::vector<std::shared_ptr<ChunkSection>> sharedSections;
+	sharedSections.reserve(totalSections);
+	for (auto chunkIndex = world->m_activeChunks.begin(); chunkIndex != world->m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk* chunk = chunkIndex->second;
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+		{
+			if (chunk->IsSectionEvicted(sectionIndex))
+			{
+				continue;
+			}
+
+			sharedSections.push_back(chunk->m_sections[sectionIndex]);
+			chunk->m_sections[sectionIndex] = std::make_shared<ChunkSection>(*chunk->m_sections[sectionIndex]);
+		}
+	}
+	double unsharedMB = GetProcessMemoryUsedMB();
+
+	//put the shared sections back, in the same order they were taken
+	size_t sharedSectionIndex = 0;
+	for (auto chunkIndex = world->m_activeChunks.begin(); chunkIndex != world->m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk* chunk = chunkIndex->second;
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+		{
+			if (chunk->IsSectionEvicted(sectionIndex))
+			{
+				continue;
+			}
+
+			chunk->m_sections[sectionIndex] = sharedSections[sharedSectionIndex];
+			sharedSectionIndex++;
+		}
+	}
+
+	double estimatedMB = static_cast<double>(totalSections - uniqueSections) * sizeof(ChunkSection) / (1024.0 * 1024.0);
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Section sharing (%i active chunks, %i unique / %i total sections):", static_cast<int>(world->m_activeChunks.size()), uniqueSections, totalSections));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Process private bytes with sharing: %.1f MB", sharedMB));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Process private bytes without sharing: %.1f MB", unsharedMB));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Saved by sharing: %.1f MB measured (%.1f MB estimated from section count)", unsharedMB - sharedMB, estimatedMB));
+	DebuggerPrintf("Section sharing: %i chunks, %i/%i sections, %.1f MB shared, %.1f MB unshared, %.1f MB estimated\n", static_cast<int>(world->m_activeChunks.size()), uniqueSections, totalSections, sharedMB, unsharedMB, estimatedMB);
+
+	return true;
+}
+
+
+void World::GetStreamingFrameStats(double& out_averageMilliseconds, double& out_deviationMilliseconds) const
+{
+	out_averageMilliseconds = 0.0;
+	out_deviationMilliseconds = 0.0;
+	if (m_numStreamingFrames == 0)
+	{
+		return;
+	}
+
+	double numFrames = static_cast<double>(m_numStreamingFrames);
+	double averageSeconds = m_streamingFrameSeconds / numFrames;
+	double variance = (m_streamingFrameSecondsSquared / numFrames) - (averageSeconds * averageSeconds);
+	out_averageMilliseconds = averageSeconds * 1000.0;
+	out_deviationMilliseconds = variance > 0.0 ? sqrt(variance) * 1000.0 : 0.0;
+}
+
+
+void World::UpdateSectionResidency(float sectionActivationRadius, float sectionDeactivationRadius)
+{
+	//sections are kept resident (uncompressed and meshed) based on their 3D distance to the player, so tall worlds only pay for the slices near the player
+	float activationRadiusSquared = sectionActivationRadius * sectionActivationRadius;
+	float deactivationRadiusSquared = sectionDeactivationRadius * sectionDeactivationRadius;
+
+	//reads and snapshots can restore non-resident sections, and sections pinned by a snapshot can't be evicted right away, so every so often those get another try
+	static float sectionEvictionRetrySeconds = g_gameConfigBlackboard.GetValue("sectionEvictionRetrySeconds", 1.0f);
+	double currentTime = GetCurrentTimeSeconds();
+	bool retryEvictions = currentTime - m_lastSectionEvictionRetryTime >= static_cast<double>(sectionEvictionRetrySeconds);
+	if (retryEvictions)
+	{
+		m_lastSectionEvictionRetryTime = currentTime;
+	}
+
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk* chunk = chunkIndex->second;
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+		{
+			AABB3 sectionBounds = chunk->GetSectionBounds(sectionIndex);
+			Vec3 nearestPointOnSection = GetNearestPointOnAABB3D(m_player->m_position, sectionBounds);
+			float distanceSquared = GetDistanceSquared3D(m_player->m_position, nearestPointOnSection);
+
+			if (chunk->IsSectionResident(sectionIndex) && distanceSquared > deactivationRadiusSquared)
+			{
+				chunk->SetSectionResident(sectionIndex, false);
+			}
+			else if (!chunk->IsSectionResident(sectionIndex) && distanceSquared < activationRadiusSquared)
+			{
+				chunk->SetSectionResident(sectionIndex, true);
+			}
+			else if (retryEvictions && !chunk->IsSectionResident(sectionIndex) && !chunk->IsSectionEvicted(sectionIndex))
+			{
+				chunk->EvictNonResidentSection(sectionIndex);
+			}
+		}
+	}
+}
+
+
+int World::GetNumResidentSections() const
+{
+	int numResidentSections = 0;
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk const* chunk = chunkIndex->second;
+		if (chunk == nullptr)
+		{
+			continue;
+		}
+
+		for (int sectionIndex = 0; sectionIndex < CHUNK_NUM_SECTIONS; sectionIndex++)
+		{
+			if (chunk->IsSectionResident(sectionIndex))
+			{
+				numResidentSections++;
+			}
+		}
+	}
+
+	return numResidentSections;
+}
+
+
+//
+//public save file functions
+//
+bool World::ReadSavedChunk(IntVec2 chunkCoords, std::vector<uint8_t>& out_chunkBuffer)
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	RegionFile* regionFile = GetRegionFileForChunk(chunkCoords, m_worldSeed);
+	if (regionFile->ReadChunk(chunkCoords, out_chunkBuffer))
+	{
+		return true;
+	}
+
+	//not in the region yet, so this must be an old per-chunk save file that needs to be imported
+	std::string legacyFileName = Stringf("Saves/World_%u/Chunk(%i,%i).chunk", m_worldSeed.load(), chunkCoords.x, chunkCoords.y);
+	if (!CheckForFile(legacyFileName) || FileReadToBuffer(out_chunkBuffer, legacyFileName) <= 0)
+	{
+		return false;
+	}
+
+	if (regionFile->WriteChunk(chunkCoords, out_chunkBuffer))
+	{
+		std::remove(legacyFileName.c_str());
+	}
+
+	return true;
+}
+
+
+bool World::ReadSavedChunkMapped(IntVec2 chunkCoords, std::shared_ptr<MappedFile>& out_mappedFile, uint8_t const*& out_chunkData, size_t& out_chunkSize)
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	//the data stays valid for as long as the caller holds on to the mapped file, even after the lock is released or the region is closed
+	return GetRegionFileForChunk(chunkCoords, m_worldSeed)->ReadChunkMapped(chunkCoords, out_mappedFile, out_chunkData, out_chunkSize);
+}
+
+
+bool World::WriteSavedChunk(IntVec2 chunkCoords, std::vector<uint8_t> const& chunkBuffer, unsigned int worldSeed)
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	if (!GetRegionFileForChunk(chunkCoords, worldSeed)->WriteChunk(chunkCoords, chunkBuffer))
+	{
+		return false;
+	}
+
+	//a late save from the previous seed doesn't belong in this world's index
+	if (worldSeed != m_worldSeed)
+	{
+		return true;
+	}
+
+	std::lock_guard<std::mutex> savedChunksLock(m_savedChunksMutex);
+	m_savedChunks.insert(chunkCoords);
+	m_chunksWrittenSinceBackup.insert(chunkCoords);
+	return true;
+}
+
+
+bool World::DoesSavedChunkExist(IntVec2 chunkCoords)
+{
+	std::lock_guard<std::mutex> savedChunksLock(m_savedChunksMutex);
+
+	return m_savedChunks.find(chunkCoords) != m_savedChunks.end();
+}
+
+
+void World::CloseUnusedRegionFiles()
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	//checked under the lock, since the save thread can open region files too
+	if (m_openRegionFiles.size() <= MAX_OPEN_REGION_FILES)
+	{
+		return;
+	}
+
+	//find which regions still have active chunks in them
+	std::set<IntVec2> usedRegions;
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		usedRegions.insert(RegionFile::GetRegionCoordsForChunk(chunkIndex->first));
+	}
+	for (auto chunkIndex = m_queuedChunks.begin(); chunkIndex != m_queuedChunks.end(); chunkIndex++)
+	{
+		usedRegions.insert(RegionFile::GetRegionCoordsForChunk(chunkIndex->first));
+	}
+
+	for (auto regionIndex = m_openRegionFiles.begin(); regionIndex != m_openRegionFiles.end();)
+	{
+		if (regionIndex->first.first == m_worldSeed && usedRegions.find(regionIndex->first.second) != usedRegions.end())
+		{
+			regionIndex++;
+			continue;
+		}
+
+		//compacting rewrites the whole file, which is far too slow to do while streaming, so just remember it for when the world closes
+		RegionFile* regionFile = regionIndex->second;
+		if (ShouldCompactRegionFile(regionFile))
+		{
+			m_regionFilesToCompact.insert(regionFile->m_filePath);
+		}
+
+		delete regionFile;
+		regionIndex = m_openRegionFiles.erase(regionIndex);
+	}
+}
+
+
+void World::CloseAllRegionFiles()
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	//nothing is streaming any more, so it's a good time to squeeze out space left behind by rewritten chunks
+	for (auto regionIndex = m_openRegionFiles.begin(); regionIndex != m_openRegionFiles.end(); regionIndex++)
+	{
+		RegionFile* regionFile = regionIndex->second;
+		m_regionFilesToCompact.erase(regionFile->m_filePath);
+		if (ShouldCompactRegionFile(regionFile) && !regionFile->Compact())
+		{
+			DebuggerPrintf("Region file %s couldn't be compacted, so it was left as it was\n", regionFile->m_filePath.c_str());
+		}
+
+		delete regionFile;
+	}
+
+	m_openRegionFiles.clear();
+
+	//including the ones closed while streaming
+	for (auto pathIndex = m_regionFilesToCompact.begin(); pathIndex != m_regionFilesToCompact.end(); pathIndex++)
+	{
+		RegionFile regionFile(*pathIndex);
+		if (ShouldCompactRegionFile(&regionFile) && !regionFile.Compact())
+		{
+			DebuggerPrintf("Region file %s couldn't be compacted, so it was left as it was\n", pathIndex->c_str());
+		}
+	}
+
+	m_regionFilesToCompact.clear();
+}
+
+
+void World::FlushRegionFiles()
+{
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+
+	for (auto regionIndex = m_openRegionFiles.begin(); regionIndex != m_openRegionFiles.end(); regionIndex++)
+	{
+		regionIndex->second->Flush();
+	}
+}
+
+
+bool World::IsWorldSeedInUse(unsigned int worldSeed)
+{
+	if (worldSeed == m_worldSeed)
+	{
+		return true;
+	}
+
+	//only the save thread opens region files for an old seed, and only while it has saves for that seed, so with both checked under the lock nothing else can start writing there
+	std::lock_guard<std::mutex> regionFileLock(m_regionFileMutex);
+	if (m_chunkSaveQueue.GetNumPendingSaves(worldSeed) > 0)
+	{
+		return true;
+	}
+
+	for (auto regionIndex = m_openRegionFiles.begin(); regionIndex != m_openRegionFiles.end(); regionIndex++)
+	{
+		if (regionIndex->first.first == worldSeed)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//
+//public flush utilities
+//
+void World::PrintChunkFlushProgress(int numChunksSaved, int numChunksToSave)
+{
+	//only every tenth of the way, so big flushes don't flood the output
+	int tenthsSaved = (numChunksSaved * 10) / numChunksToSave;
+	int previousTenthsSaved = ((numChunksSaved - 1) * 10) / numChunksToSave;
+	if (tenthsSaved != previousTenthsSaved)
+	{
+		DebuggerPrintf("Saving chunks: %i / %i\n", numChunksSaved, numChunksToSave);
+	}
+}
+
+
+bool World::Event_BenchmarkChunkFlush(EventArgs& args)
+{
+	World* world = g_theGame->m_world;
+	if (world == nullptr)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk flush benchmark needs a world, so start the game first");
+		return false;
+	}
+
+	//the seed, region files, and saved chunk index all get swapped out from under anything still running, so only run once the world has settled
+	if (world->m_worldBackup.IsBackupRunning())
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk flush benchmark can't run while a backup is being taken, so try again in a moment");
+		return false;
+	}
+	if (!world->m_queuedChunks.empty() || world->m_numMeshJobsRunning > 0 || !world->m_deferredCompletedJobs.empty())
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk flush benchmark can't run while chunks are still loading or meshing, so try again in a moment");
+		return false;
+	}
+	if (world->m_chunkSaveQueue.GetNumPendingSaves() > 0 || world->m_chunkSaveQueue.GetNumRetryingSaves() > 0)
+	{
+		g_theDevConsole->AddLine(DevConsole::COLOR_ERROR, "Chunk flush benchmark can't run while chunk saves are still waiting to be written, so try again in a moment");
+		return false;
+	}
+
+	int numChunks = args.GetValue("chunks", 1000);
+	if (numChunks < 1 || numChunks > 4096)
+	{
+		numChunks = 1000;
+	}
+
+	//write into a throwaway world folder, so the real saves and saved chunk index are left alone
+	unsigned int const benchmarkSeed = 0xFFFFFFFF;
+	world->m_chunkSaveQueue.Flush();
+	world->UpdateWrittenSaves();
+	world->CloseAllRegionFiles();
+
+	unsigned int realWorldSeed = world->m_worldSeed;
+	std::unordered_set<IntVec2, ChunkCoordsHasher> realSavedChunks;
+	std::unordered_set<IntVec2, ChunkCoordsHasher> realChunksWrittenSinceBackup;
+	{
+		std::lock_guard<std::mutex> savedChunksLock(world->m_savedChunksMutex);
+		realSavedChunks.swap(world->m_savedChunks);
+		realChunksWrittenSinceBackup.swap(world->m_chunksWrittenSinceBackup);
+	}
+
+	{
+		std::lock_guard<std::mutex> regionFileLock(world->m_regionFileMutex);
+		world->m_worldSeed = benchmarkSeed;
+	}
+	std::string benchmarkFolderPath = Stringf("Saves\\World_%u", benchmarkSeed);
+	CreateDirectoryA(benchmarkFolderPath.c_str(), NULL);
+
+	//edited chunks generated far away from the player, so every one of them needs saving
+	std::vector<Chunk*> chunks(numChunks);
+	std::set<IntVec2> benchmarkRegions;
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		IntVec2 chunkCoords = IntVec2(2000 + (chunkIndex % 32), 2000 + (chunkIndex / 32));
+		chunks[chunkIndex] = new Chunk(chunkCoords, world);
+		chunks[chunkIndex]->PopulateBlocks();
+		chunks[chunkIndex]->SetBlockType(0, "air");
+		benchmarkRegions.insert(RegionFile::GetRegionCoordsForChunk(chunkCoords));
+	}
+
+	//old path: everything goes through the save queue's one thread
+	double startTime = GetCurrentTimeSeconds();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		world->m_chunkSaveQueue.QueueChunkSave(chunks[chunkIndex]->TakeSnapshot());
+	}
+	world->m_chunkSaveQueue.Flush();
+	world->FlushRegionFiles();
+	double saveQueueSeconds = GetCurrentTimeSeconds() - startTime;
+
+	//these saves were never the real world's, so the journal and active chunks shouldn't hear about them
+	std::vector<WrittenChunkSave> benchmarkWrittenSaves;
+	world->m_chunkSaveQueue.TakeWrittenSaves(benchmarkWrittenSaves);
+
+	//start the next pass from empty region files too
+	world->CloseAllRegionFiles();
+	for (auto regionIndex = benchmarkRegions.begin(); regionIndex != benchmarkRegions.end(); regionIndex++)
+	{
+		std::remove(RegionFile::GetRegionFilePath(benchmarkSeed, *regionIndex).c_str());
+	}
+
+	//new path: encode and write on every worker
+	startTime = GetCurrentTimeSeconds();
+	int numFailedSaves = world->SaveChunksInParallel(chunks, nullptr);
+	world->FlushRegionFiles();
+	double parallelSeconds = GetCurrentTimeSeconds() - startTime;
+
+	//clean up and put the real world back
+	world->CloseAllRegionFiles();
+	for (auto regionIndex = benchmarkRegions.begin(); regionIndex != benchmarkRegions.end(); regionIndex++)
+	{
+		std::remove(RegionFile::GetRegionFilePath(benchmarkSeed, *regionIndex).c_str());
+	}
+	RemoveDirectoryA(benchmarkFolderPath.c_str());
+
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		delete chunks[chunkIndex];
+	}
+
+	{
+		std::lock_guard<std::mutex> regionFileLock(world->m_regionFileMutex);
+		world->m_worldSeed = realWorldSeed;
+	}
+	{
+		std::lock_guard<std::mutex> savedChunksLock(world->m_savedChunksMutex);
+		world->m_savedChunks.swap(realSavedChunks);
+		world->m_chunksWrittenSinceBackup.swap(realChunksWrittenSinceBackup);
+	}
+
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Chunk flush benchmark (%i edited chunks):", numChunks));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Save queue thread: %.1f ms (%.0f chunks/s)", saveQueueSeconds * 1000.0, numChunks / saveQueueSeconds));
+	g_theDevConsole->AddLine(DevConsole::COLOR_INFO_MINOR, Stringf(" Parallel save jobs: %.1f ms (%.0f chunks/s), %.1fx faster%s", parallelSeconds * 1000.0, numChunks / parallelSeconds, saveQueueSeconds / parallelSeconds, numFailedSaves == 0 ? "" : " (SAVES FAILED)"));
+
+	return true;
+}
+
+
+//
+//public raycast functions
+//
+GameRaycastResult3D World::RaycastVsBlocks(Vec3 const& startPosition, Vec3 const& directionNormal, float distance)
+{
+	//go ahead and set up raycast result
+	GameRaycastResult3D raycastResult;
+	raycastResult.m_rayStartPosition = startPosition;
+	raycastResult.m_rayDirection = directionNormal;
+	raycastResult.m_rayLength = distance;
+	
+	//get world coordinates of block raycast starts in
+	int worldX = static_cast<int>(floorf(startPosition.x));
+	int worldY = static_cast<int>(floorf(startPosition.y));
+	int worldZ = static_cast<int>(floorf(startPosition.z));
+
+	//get chunk coordinates from world coordinates
+	int chunkX = worldX >> CHUNK_BITS_X;
+	int chunkY = worldY >> CHUNK_BITS_Y;
+	
+	//get chunk you're in (or if you aren't in an active chunk somehow, just don't bother)
+	auto chunkFound = m_activeChunks.find(IntVec2(chunkX, chunkY));
+	if (chunkFound == m_activeChunks.end())
+	{
+		return GameRaycastResult3D();
+	}
+	Chunk* chunk = chunkFound->second;
+
+	//get local block coordinates
+	int localX = worldX - (chunkX * CHUNK_SIZE_X);
+	int localY = worldY - (chunkY * CHUNK_SIZE_Y);
+
+	//get block index
+	int blockIndex = localX + (localY << CHUNK_BITS_X) + (worldZ << (CHUNK_BITS_X + CHUNK_BITS_Y));
+
+	//return blank raycast if above or below active chunk
+	if (blockIndex < 0 || blockIndex >= CHUNK_TOTAL_BLOCKS)
+	{
+		return raycastResult;
+	}
+
+	//create block iterator for block we're in
+	BlockIterator blockIter = BlockIterator(blockIndex, chunk);
+
+	//return blank raycast if not in an active chunk
+	if (blockIter.GetChunk() == nullptr)
+	{
+		return raycastResult;
+	}
+
+	//if we're already in a solid block, we're done
+	if (blockIter.GetBlock()->IsSolid())
+	{
+		raycastResult.m_impactedBlock = blockIter;
+		raycastResult.m_didImpact = true;
+		raycastResult.m_impactDist = 0.0f;
+		raycastResult.m_impactPos = startPosition;
+		raycastResult.m_impactNormal = Vec3();
+		return raycastResult;
+	}
+
+	//initialization step
+	float distPerXCrossing = 1.0f / (fabsf(directionNormal.x));
+	int stepDirectionX;
+	if (directionNormal.x < 0) stepDirectionX = -1;
+	else stepDirectionX = 1;
+	float xAtFirstXCrossing = static_cast<float>(worldX + (stepDirectionX + 1) / 2);
+	float xDistToFirstXCrossing = xAtFirstXCrossing - startPosition.x;
+	float totalDistAtNextXCrossing = fabsf(xDistToFirstXCrossing) * distPerXCrossing;
+
+	float distPerYCrossing = 1.0f / (fabsf(directionNormal.y));
+	int stepDirectionY;
+	if (directionNormal.y < 0) stepDirectionY = -1;
+	else stepDirectionY = 1;
+	float yAtFirstYCrossing = static_cast<float>(worldY + (stepDirectionY + 1) / 2);
+	float yDistToFirstYCrossing = yAtFirstYCrossing - startPosition.y;
+	float totalDistAtNextYCrossing = fabsf(yDistToFirstYCrossing) * distPerYCrossing;
+
+	float distPerZCrossing = 1.0f / (fabsf(directionNormal.z));
+	int stepDirectionZ;
+	if (directionNormal.z < 0) stepDirectionZ = -1;
+	else stepDirectionZ = 1;
+	float zAtFirstZCrossing = static_cast<float>(worldZ + (stepDirectionZ + 1) / 2);
+	float zDistToFirstZCrossing = zAtFirstZCrossing - startPosition.z;
+	float totalDistAtNextZCrossing = fabsf(zDistToFirstZCrossing) * distPerZCrossing;
+
+	//main raycast loop
+	while (totalDistAtNextXCrossing < distance || totalDistAtNextYCrossing < distance || totalDistAtNextZCrossing < distance)
+	{
+		if (totalDistAtNextXCrossing <= totalDistAtNextYCrossing && totalDistAtNextXCrossing <= totalDistAtNextZCrossing)
+		{
+			//return blank raycast if we surpass max raycast distance
+			if (totalDistAtNextXCrossing > distance)
+			{
+				return raycastResult;
+			}
+
+			if (stepDirectionX == 1) blockIter = blockIter.GetEastNeighbor();
+			else if (stepDirectionX == -1) blockIter = blockIter.GetWestNeighbor();
+
+			//if next block is in unactivated chunk, return blank raycast
+			if (blockIter.GetChunk() == nullptr)
+			{
+				return raycastResult;
+			}
+
+			//if next block is solid, hit (chunk's column summary lets us skip looking up blocks in open air)
+			if (blockIter.GetChunk()->CouldBlockBeSolid(blockIter.GetBlockIndex()) && blockIter.GetBlock()->IsSolid())
+			{
+				raycastResult.m_didImpact = true;
+				raycastResult.m_impactDist = totalDistAtNextXCrossing;
+				raycastResult.m_impactPos = startPosition + (directionNormal * totalDistAtNextXCrossing);
+				if (stepDirectionX == -1)
+				{
+					raycastResult.m_impactNormal = Vec3(1.0f, 0.0f, 0.0f);
+				}
+				else
+				{
+					raycastResult.m_impactNormal = Vec3(-1.0f, 0.0f, 0.0f);
+				}
+				raycastResult.m_impactedBlock = blockIter;
+				return raycastResult;
+			}
+
+			//otherwise, step forward
+			totalDistAtNextXCrossing += distPerXCrossing;
+		}
+		else if (totalDistAtNextYCrossing <= totalDistAtNextXCrossing && totalDistAtNextYCrossing <= totalDistAtNextZCrossing)
+		{
+			//return blank raycast if we surpass max raycast distance
+			if (totalDistAtNextYCrossing > distance)
+			{
+				return raycastResult;
+			}
+
+			if (stepDirectionY == 1) blockIter = blockIter.GetNorthNeighbor();
+			else if (stepDirectionY == -1) blockIter = blockIter.GetSouthNeighbor();
+
+			//if next block is in unactivated chunk, return blank raycast
+			if (blockIter.GetChunk() == nullptr)
+			{
+				return raycastResult;
+			}
+
+			//if next block is solid, hit (chunk's column summary lets us skip looking up blocks in open air)
+			if (blockIter.GetChunk()->CouldBlockBeSolid(blockIter.GetBlockIndex()) && blockIter.GetBlock()->IsSolid())
+			{
+				raycastResult.m_didImpact = true;
 				raycastResult.m_impactDist = totalDistAtNextYCrossing;
 				raycastResult.m_impactPos = startPosition + (directionNormal * totalDistAtNextYCrossing);
 				if (stepDirectionY == -1)
@@ -953,8 +1922,8 @@ GameRaycastResult3D World::RaycastVsBlocks(Vec3 const& startPosition, Vec3 const
 				return raycastResult;
 			}
 
-			//if next block is solid, hit
-			if (blockIter.GetBlock()->IsSolid())
+			//if next block is solid, hit (chunk's column summary lets us skip looking up blocks in open air)
+			if (blockIter.GetChunk()->CouldBlockBeSolid(blockIter.GetBlockIndex()) && blockIter.GetBlock()->IsSolid())
 			{
 				raycastResult.m_didImpact = true;
 				raycastResult.m_impactDist = totalDistAtNextZCrossing;
@@ -1015,7 +1984,7 @@ void World::ProcessNextDirtyLightBlock()
 	}
 
 	//clear dirty light flag
-	Block* block = blockIter.GetBlock();
+	Block* block = blockIter.GetBlockForWrite();
 	block->m_bitFlags = block->m_bitFlags & ~BLOCK_BIT_IS_LIGHT_DIRTY;
 
 	//compute theoretically-correct light influence
@@ -1048,17 +2017,17 @@ void World::ProcessNextDirtyLightBlock()
 		BlockIterator skywardNeighbor = blockIter.GetSkywardNeighbor();
 		BlockIterator downwardNeighbor = blockIter.GetDownwardNeighbor();
 		
-		Block* eastBlock = nullptr;
+		Block const* eastBlock = nullptr;
 		if (eastNeighbor.GetChunk() != nullptr) eastBlock = eastNeighbor.GetBlock();
-		Block* westBlock = nullptr;
+		Block const* westBlock = nullptr;
 		if (westNeighbor.GetChunk() != nullptr) westBlock = westNeighbor.GetBlock();
-		Block* northBlock = nullptr;
+		Block const* northBlock = nullptr;
 		if (northNeighbor.GetChunk() != nullptr) northBlock = northNeighbor.GetBlock();
-		Block* southBlock = nullptr;
+		Block const* southBlock = nullptr;
 		if (southNeighbor.GetChunk() != nullptr) southBlock = southNeighbor.GetBlock();
-		Block* skywardBlock = nullptr;
+		Block const* skywardBlock = nullptr;
 		if (skywardNeighbor.GetChunk() != nullptr) skywardBlock = skywardNeighbor.GetBlock();
-		Block* downwardBlock = nullptr;
+		Block const* downwardBlock = nullptr;
 		if (downwardNeighbor.GetChunk() != nullptr) downwardBlock = downwardNeighbor.GetBlock();
 
 		//compare to east indoor and outdoor
@@ -1221,13 +2190,14 @@ void World::ProcessNextDirtyLightBlock()
 
 void World::MarkLightingDirty(Chunk* chunk, int blockIndex)
 {
-	Block* block = &chunk->m_blocks[blockIndex];
+	Block const* block = chunk->GetBlock(blockIndex);
 	
 	//if block isn't already in queue
 	if ((block->m_bitFlags & BLOCK_BIT_IS_LIGHT_DIRTY) != BLOCK_BIT_IS_LIGHT_DIRTY)
 	{
 		//set block flag for dirty lighting
-		block->m_bitFlags = block->m_bitFlags | BLOCK_BIT_IS_LIGHT_DIRTY;
+		Block* dirtyBlock = chunk->GetBlockForWrite(blockIndex);
+		dirtyBlock->m_bitFlags = dirtyBlock->m_bitFlags | BLOCK_BIT_IS_LIGHT_DIRTY;
 
 		m_dirtyBlocks.emplace_back(BlockIterator(blockIndex, chunk));
 	}
@@ -1245,3 +2215,291 @@ void World::UndirtyAllBlocksInChunk(Chunk* chunk)
 	}
 }
 
+
+//
+//private save file functions
+//
+RegionFile* World::GetRegionFileForChunk(IntVec2 chunkCoords, unsigned int worldSeed)
+{
+	IntVec2 regionCoords = RegionFile::GetRegionCoordsForChunk(chunkCoords);
+
+	auto regionFound = m_openRegionFiles.find(std::make_pair(worldSeed, regionCoords));
+	if (regionFound != m_openRegionFiles.end())
+	{
+		return regionFound->second;
+	}
+
+	RegionFile* regionFile = new RegionFile(RegionFile::GetRegionFilePath(worldSeed, regionCoords));
+	m_openRegionFiles.emplace(std::make_pair(worldSeed, regionCoords), regionFile);
+
+	return regionFile;
+}
+
+
+bool World::ShouldCompactRegionFile(RegionFile const* regionFile)
+{
+	int numSectors = regionFile->GetNumUsedSectors() + regionFile->GetNumWastedSectors();
+	return numSectors > 0 && static_cast<float>(regionFile->GetNumWastedSectors()) > static_cast<float>(numSectors) * REGION_COMPACTION_WASTE_THRESHOLD;
+}
+
+
+//
+//private save index functions
+//
+void World::BuildSavedChunkIndex()
+{
+	double startTime = GetCurrentTimeSeconds();
+
+	std::vector<IntVec2> savedChunkCoords;
+	int numRegionFiles = 0;
+
+	//one pass over the world folder picks up both region files and old per-chunk saves that haven't been imported yet
+	std::string worldFolderPath = Stringf("Saves\\World_%u", m_worldSeed.load());
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((worldFolderPath + "\\*").c_str(), &findData);
+	if (findHandle != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			std::string fileName = findData.cFileName;
+			IntVec2 coords;
+			if (fileName.size() > 7 && fileName.compare(fileName.size() - 7, 7, ".region") == 0 && sscanf_s(fileName.c_str(), "Region(%d,%d)", &coords.x, &coords.y) == 2)
+			{
+				if (RegionFile::ReadSavedChunkCoords(RegionFile::GetRegionFilePath(m_worldSeed, coords), coords, savedChunkCoords))
+				{
+					numRegionFiles++;
+				}
+			}
+			else if (fileName.size() > 6 && fileName.compare(fileName.size() - 6, 6, ".chunk") == 0 && sscanf_s(fileName.c_str(), "Chunk(%d,%d)", &coords.x, &coords.y) == 2)
+			{
+				savedChunkCoords.push_back(coords);
+			}
+		}
+		while (FindNextFileA(findHandle, &findData));
+
+		FindClose(findHandle);
+	}
+
+	{
+		std::lock_guard<std::mutex> savedChunksLock(m_savedChunksMutex);
+		m_savedChunks.clear();
+		m_savedChunks.insert(savedChunkCoords.begin(), savedChunkCoords.end());
+		m_chunksWrittenSinceBackup.clear();
+	}
+
+	DebuggerPrintf("Indexed %i saved chunks from %i region files in %.2f ms\n", static_cast<int>(savedChunkCoords.size()), numRegionFiles, (GetCurrentTimeSeconds() - startTime) * 1000.0);
+}
+
+
+//
+//private autosave functions
+//
+void World::UpdateAutosave()
+{
+	static float autosaveIntervalSeconds = g_gameConfigBlackboard.GetValue("autosaveIntervalSeconds", 5.0f);
+	static int autosaveChunksPerInterval = g_gameConfigBlackboard.GetValue("autosaveChunksPerInterval", 16);
+	if (autosaveIntervalSeconds <= 0.0f || autosaveChunksPerInterval <= 0)
+	{
+		return;
+	}
+
+	double currentTime = GetCurrentTimeSeconds();
+	if (currentTime - m_lastAutosaveTime < static_cast<double>(autosaveIntervalSeconds))
+	{
+		return;
+	}
+	m_lastAutosaveTime = currentTime;
+
+	//the budget counts saves that haven't been written yet too, so a slow disk just means fewer new ones get queued
+	int saveBudget = autosaveChunksPerInterval - m_chunkSaveQueue.GetNumPendingSaves();
+	if (saveBudget <= 0 || m_activeChunks.empty())
+	{
+		return;
+	}
+
+	//walk the active chunks starting just past wherever the last pass stopped, wrapping around at most once
+	auto chunkIndex = m_activeChunks.upper_bound(m_autosaveCursor);
+	for (size_t numChunksChecked = 0; numChunksChecked < m_activeChunks.size() && saveBudget > 0; numChunksChecked++, chunkIndex++)
+	{
+		if (chunkIndex == m_activeChunks.end())
+		{
+			chunkIndex = m_activeChunks.begin();
+		}
+
+		m_autosaveCursor = chunkIndex->first;
+		Chunk* chunk = chunkIndex->second;
+		if (!chunk->m_needsSaving || chunk->m_queuedSaveTicket != 0)
+		{
+			continue;
+		}
+
+		//the chunk stays flagged until the save is actually written (a failed one stays queued and gets retried), and a later edit clears the ticket so it gets queued again
+		chunk->m_queuedSaveTicket = m_chunkSaveQueue.QueueChunkSave(chunk->TakeSnapshot());
+		m_numChunksAutosaved++;
+		saveBudget--;
+	}
+}
+
+
+void World::UpdateWrittenSaves()
+{
+	std::vector<WrittenChunkSave> writtenSaves;
+	m_chunkSaveQueue.TakeWrittenSaves(writtenSaves);
+
+	for (int saveIndex = 0; saveIndex < static_cast<int>(writtenSaves.size()); saveIndex++)
+	{
+		//saves still finishing from the seed before an F9 switch don't belong to anything in this world
+		if (writtenSaves[saveIndex].m_worldSeed != m_worldSeed)
+		{
+			continue;
+		}
+
+		m_editJournal.OnChunkSaveWritten(writtenSaves[saveIndex]);
+
+		//an edit since the save was queued clears the ticket, and tickets are never reused, so a chunk that came back since then can't match an old one
+		auto chunkFound = m_activeChunks.find(writtenSaves[saveIndex].m_chunkCoords);
+		if (chunkFound != m_activeChunks.end() && chunkFound->second->m_queuedSaveTicket == writtenSaves[saveIndex].m_saveTicket)
+		{
+			chunkFound->second->m_needsSaving = false;
+			chunkFound->second->m_queuedSaveTicket = 0;
+		}
+	}
+}
+
+
+//
+//private remesh scheduling functions
+//
+void World::UpdateChunkMeshes()
+{
+	static int remeshesPerFrame = g_gameConfigBlackboard.GetValue("chunkRemeshesPerFrame", 8);
+	static float remeshMillisecondsPerFrame = g_gameConfigBlackboard.GetValue("chunkRemeshMillisecondsPerFrame", 2.0f);
+	static float viewHalfAngleCosine = CosDegrees(REMESH_VIEW_HALF_ANGLE_DEGREES);
+	static float chunkRadiusXY = sqrtf(static_cast<float>((CHUNK_SIZE_X * CHUNK_SIZE_X) + (CHUNK_SIZE_Y * CHUNK_SIZE_Y))) * 0.5f;
+
+	//chunks are tall and the camera mostly looks sideways, so the view check only looks at the horizontal angle to each chunk
+	Vec2 cameraPositionXY = Vec2(m_player->m_position.x, m_player->m_position.y);
+	Vec2 cameraForwardXY = Vec2::MakeFromPolarDegrees(m_player->m_orientation.m_yawDegrees, 1.0f);
+
+	std::priority_queue<ChunkRemeshRequest> remeshQueue;
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk* chunk = chunkIndex->second;
+		if (chunk == nullptr || !chunk->IsReadyToRemesh())
+		{
+			continue;
+		}
+
+		Vec3 chunkCenter = chunk->GetChunkCenter();
+		Vec2 chunkCenterXY = Vec2(chunkCenter.x, chunkCenter.y);
+		Vec2 cameraToChunk = chunkCenterXY - cameraPositionXY;
+		float distance = sqrtf(GetDistanceSquared2D(cameraPositionXY, chunkCenterXY));
+
+		//the chunk's radius keeps ones straddling the edge of the view (or the one the camera is in) counted as in it
+		float forwardDistance = (cameraToChunk.x * cameraForwardXY.x) + (cameraToChunk.y * cameraForwardXY.y);
+		bool isInView = distance <= chunkRadiusXY || forwardDistance >= (distance * viewHalfAngleCosine) - chunkRadiusXY;
+
+		ChunkRemeshRequest request;
+		request.m_chunk = chunk;
+		request.m_isUrgent = chunk->m_isRemeshUrgent;
+		request.m_priorityDistance = isInView ? distance : distance * REMESH_OUT_OF_VIEW_DISTANCE_SCALE;
+		remeshQueue.push(request);
+	}
+
+	//player edits always go out right away, but everything else stops once either budget is spent (a budget of zero means no limit)
+	double startTime = GetCurrentTimeSeconds();
+	int numRemeshed = 0;
+	while (!remeshQueue.empty())
+	{
+		ChunkRemeshRequest const& request = remeshQueue.top();
+		if (!request.m_isUrgent)
+		{
+			bool isOverChunkBudget = remeshesPerFrame > 0 && numRemeshed >= remeshesPerFrame;
+			bool isOverTimeBudget = remeshMillisecondsPerFrame > 0.0f && (GetCurrentTimeSeconds() - startTime) * 1000.0 >= static_cast<double>(remeshMillisecondsPerFrame);
+			if (isOverChunkBudget || isOverTimeBudget)
+			{
+				break;
+			}
+		}
+
+		request.m_chunk->RebuildVertexes();
+		remeshQueue.pop();
+		numRemeshed++;
+	}
+
+	m_numRemeshesWaiting = static_cast<int>(remeshQueue.size());
+}
+
+
+void World::MarkChunksForUrgentRemesh(Chunk* chunk, int blockIndex)
+{
+	chunk->m_isRemeshUrgent = true;
+
+	//blocks on the edge of a chunk also change the faces of the chunk next to them
+	int localX = blockIndex & CHUNK_MAX_X;
+	int localY = (blockIndex >> CHUNK_BITS_X) & CHUNK_MAX_Y;
+	Chunk* edgeNeighbors[4] = {
+		localX == CHUNK_MAX_X ? chunk->m_eastNeighbor : nullptr,
+		localX == 0 ? chunk->m_westNeighbor : nullptr,
+		localY == CHUNK_MAX_Y ? chunk->m_northNeighbor : nullptr,
+		localY == 0 ? chunk->m_southNeighbor : nullptr
+	};
+	for (int neighborIndex = 0; neighborIndex < 4; neighborIndex++)
+	{
+		if (edgeNeighbors[neighborIndex] != nullptr)
+		{
+			edgeNeighbors[neighborIndex]->SetVertsAsDirty();
+			edgeNeighbors[neighborIndex]->m_isRemeshUrgent = true;
+		}
+	}
+}
+
+
+//
+//private startup timing functions
+//
+void World::UpdateFullViewTimer()
+{
+	if (m_fullViewSeconds >= 0.0 || m_activeChunks.empty() || !m_queuedChunks.empty() || !m_dirtyBlocks.empty())
+	{
+		return;
+	}
+
+	//chunks on the edge never get meshed, since they're missing a neighbor
+	for (auto chunkIndex = m_activeChunks.begin(); chunkIndex != m_activeChunks.end(); chunkIndex++)
+	{
+		Chunk const* chunk = chunkIndex->second;
+		bool allNeighborsPresent = (chunk->m_eastNeighbor != nullptr) && (chunk->m_westNeighbor != nullptr) && (chunk->m_northNeighbor != nullptr) && (chunk->m_southNeighbor != nullptr);
+		if ((allNeighborsPresent && chunk->m_areVertsDirty) || chunk->IsMeshJobRunning())
+		{
+			return;
+		}
+	}
+
+	m_fullViewSeconds = GetCurrentTimeSeconds() - m_fullViewStartTime;
+	double averageFrameMilliseconds = 0.0;
+	double frameDeviationMilliseconds = 0.0;
+	GetStreamingFrameStats(averageFrameMilliseconds, frameDeviationMilliseconds);
+	DebuggerPrintf("Full view of %i chunks took %.3f seconds (%i of %i baked meshes reused, frames averaged %.2f ms with %.2f ms deviation)\n", static_cast<int>(m_activeChunks.size()), m_fullViewSeconds, m_numBakedMeshHits, m_numBakedMeshChecks, averageFrameMilliseconds, frameDeviationMilliseconds);
+	DebuggerPrintf("Chunk cache over that run: %.1f%% hit rate (%i hits, %i misses, %i evicted, %i skipped)\n", m_chunkCache.GetHitRate() * 100.0f, m_chunkCache.m_numHits, m_chunkCache.m_numMisses, m_chunkCache.m_numEvictions, m_chunkCache.m_numSkipped);
+}
+
+
+void World::UpdateStreamingFrameStats()
+{
+	//frames only count while chunks are still loading, lighting, or waiting on a mesh, since that's when the frame time jumps around
+	double currentTime = GetCurrentTimeSeconds();
+	double frameSeconds = currentTime - m_lastUpdateTime;
+	bool wasFirstUpdate = m_lastUpdateTime == 0.0;
+	m_lastUpdateTime = currentTime;
+
+	bool isStreaming = !m_queuedChunks.empty() || !m_dirtyBlocks.empty() || m_numRemeshesWaiting > 0 || m_numMeshJobsRunning > 0;
+	if (wasFirstUpdate || !isStreaming)
+	{
+		return;
+	}
+
+	m_numStreamingFrames++;
+	m_streamingFrameSeconds += frameSeconds;
+	m_streamingFrameSecondsSquared += frameSeconds * frameSeconds;
+}
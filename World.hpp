@@ -1,15 +1,29 @@
 #pragma once
 #include "Game/BlockIterator.hpp"
+#include "Game/ChunkCache.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Game/ChunkSaveQueue.hpp"
+#include "Game/EditJournal.hpp"
+#include "Game/WorldBackup.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/JobSystem/JobSystem.hpp"
+#include <atomic>
 #include <deque>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_set>
 
 
 //forward declarations
 class Player;
 class Game;
 class Chunk;
+class RegionFile;
+class MappedFile;
+class Job;
 
 
 //game version of raycast result struct
@@ -19,7 +33,46 @@ struct GameRaycastResult3D : public RaycastResult3D
 };
 
 
+//hash for chunk coords, so they can be kept in unordered containers
+struct ChunkCoordsHasher
+{
+	size_t operator()(IntVec2 const& chunkCoords) const
+	{
+		return std::hash<uint64_t>()((static_cast<uint64_t>(static_cast<uint32_t>(chunkCoords.x)) << 32) | static_cast<uint32_t>(chunkCoords.y));
+	}
+};
+
+
+//one chunk waiting for a new mesh: std::priority_queue hands out the largest first, so player edits come out on top, then the nearest chunks
+struct ChunkRemeshRequest
+{
+	Chunk* m_chunk = nullptr;
+	bool   m_isUrgent = false;
+	float  m_priorityDistance = 0.0f;
+
+	bool operator<(ChunkRemeshRequest const& other) const
+	{
+		if (m_isUrgent != other.m_isUrgent)
+		{
+			return !m_isUrgent;
+		}
+
+		return m_priorityDistance > other.m_priorityDistance;
+	}
+};
+
+
+//called as a parallel chunk flush goes, so long flushes can report how far along they are
+typedef void (*ChunkFlushProgressCallback)(int numChunksSaved, int numChunksToSave);
+
+
 //constants
+constexpr int MAX_OPEN_REGION_FILES = 16;
+constexpr float REGION_COMPACTION_WASTE_THRESHOLD = 0.25f;
+
+constexpr float REMESH_VIEW_HALF_ANGLE_DEGREES = 60.0f;		//a bit wider than the camera's horizontal fov, so chunks about to turn into view count as in it
+constexpr float REMESH_OUT_OF_VIEW_DISTANCE_SCALE = 2.0f;	//chunks behind the camera get remeshed as if they were this much farther away
+
 constexpr float TIME_MIDNIGHT = 0.0f;
 constexpr float TIME_DAWN = 0.25f;
 constexpr float TIME_NOON = 0.5f;
@@ -43,7 +96,33 @@ public:
 	void ActivateChunk(IntVec2 chunkCoords, Chunk* chunk);
 	bool FindFarthestInactiveChunk(IntVec2& out_ChunkCoords, float deactivationRadius);
 	void DeactivateChunk(IntVec2 chunkCoords);
-	void DeactivateAllChunks();
+	void DeactivateAllChunks(ChunkFlushProgressCallback progressCallback = nullptr);
+	int  SaveChunksInParallel(std::vector<Chunk*> const& chunks, ChunkFlushProgressCallback progressCallback);
+	void CancelDistantQueuedChunks(float deactivationRadius);
+	void CancelAllQueuedChunks();
+	void WaitForChunkJobs();
+	void GetSectionSharingStats(int& out_totalSections, int& out_uniqueSections) const;
+	static double GetProcessMemoryUsedMB();
+	static bool Event_MeasureSectionSharing(EventArgs& args);
+	void GetStreamingFrameStats(double& out_averageMilliseconds, double& out_deviationMilliseconds) const;
+
+	//section residency functions
+	void UpdateSectionResidency(float sectionActivationRadius, float sectionDeactivationRadius);
+	int  GetNumResidentSections() const;
+
+	//save file functions (safe to call from any thread)
+	bool ReadSavedChunk(IntVec2 chunkCoords, std::vector<uint8_t>& out_chunkBuffer);
+	bool ReadSavedChunkMapped(IntVec2 chunkCoords, std::shared_ptr<MappedFile>& out_mappedFile, uint8_t const*& out_chunkData, size_t& out_chunkSize);
+	bool WriteSavedChunk(IntVec2 chunkCoords, std::vector<uint8_t> const& chunkBuffer, unsigned int worldSeed);
+	bool DoesSavedChunkExist(IntVec2 chunkCoords);
+	void CloseUnusedRegionFiles();
+	void CloseAllRegionFiles();
+	void FlushRegionFiles();
+	bool IsWorldSeedInUse(unsigned int worldSeed);	//loaded, or the save thread still has writes for it (tools that rewrite a world's folder have to wait until it isn't)
+
+	//flush utilities
+	static void PrintChunkFlushProgress(int numChunksSaved, int numChunksToSave);
+	static bool Event_BenchmarkChunkFlush(EventArgs& args);
 
 	//raycast functions
 	GameRaycastResult3D RaycastVsBlocks(Vec3 const& startPosition, Vec3 const& directionNormal, float distance);
@@ -57,18 +136,88 @@ private:
 	void MarkLightingDirty(Chunk* chunk, int blockIndex);
 	void UndirtyAllBlocksInChunk(Chunk* chunk);
 
+	//save file functions (caller must hold the region file mutex)
+	RegionFile* GetRegionFileForChunk(IntVec2 chunkCoords, unsigned int worldSeed);
+	static bool ShouldCompactRegionFile(RegionFile const* regionFile);
+
+	//save index functions
+	void BuildSavedChunkIndex();
+
+	//autosave functions
+	void UpdateAutosave();
+	void UpdateWrittenSaves();
+
+	//remesh scheduling functions
+	void UpdateChunkMeshes();
+	void MarkChunksForUrgentRemesh(Chunk* chunk, int blockIndex);
+
+	//startup timing functions
+	void UpdateFullViewTimer();
+	void UpdateStreamingFrameStats();
+
 //public member variables
 public:
 	std::map<IntVec2, Chunk*> m_queuedChunks;
 	std::map<IntVec2, Chunk*> m_activeChunks;
+	std::vector<Job*>		  m_deferredCompletedJobs;	//generate and load jobs that finished while a flush was claiming its own jobs
 
 	Player* m_player = nullptr;
 	Game*   m_game = nullptr;
 
-	unsigned int m_worldSeed = 0;
+	std::atomic<unsigned int> m_worldSeed = 0;	//only changes under the region file mutex, with no chunk jobs running
+	ChunkCodecType m_saveCodec = ChunkCodecType::PALETTE_RLE;
+	bool		   m_useOverlaySaves = true;	//save generated chunks as just their edits when that's smaller
+	bool		   m_useMappedReads = true;		//decode saved chunks straight out of memory-mapped region files
+	bool		   m_useBakedMeshes = true;		//save finished meshes with chunks, and reuse them on load if nothing they were built from changed
+	ChunkMesherType m_mesherType = ChunkMesherType::PER_FACE;
+	bool			m_useMeshJobs = true;		//build chunk meshes on worker threads, and only upload them on the main thread
+	bool			m_useIndexedQuads = true;	//4 verts per quad, drawn through the shared quad index buffer, instead of 6
 
 	std::deque<BlockIterator> m_dirtyBlocks;
 
+	ChunkCache m_chunkCache;
+	ChunkSaveQueue m_chunkSaveQueue;
+	EditJournal m_editJournal;
+	WorldBackup m_worldBackup;
+
+	//edited chunks get saved a few at a time while they're still active, so shutdown only has to write whatever changed since the last pass
+	double	m_lastAutosaveTime = 0.0;
+	IntVec2 m_autosaveCursor = IntVec2();	//last chunk a pass looked at, so the next one carries on from there and every chunk gets its turn
+	int		m_numChunksAutosaved = 0;
+
+	double m_lastSectionEvictionRetryTime = 0.0;	//non-resident sections that came back (or were pinned) get evicted again on this timer
+	double m_lastSectionPoolPruneTime = 0.0;		//pooled sections nothing uses anymore get dropped on this timer
+
+	int m_numBakedMeshChecks = 0;	//chunks that came back with a baked mesh and were checked against their blocks
+	int m_numBakedMeshHits = 0;
+
+	//time spent turning visible faces into vertexes, for comparing meshers
+	double m_meshBuildSeconds = 0.0;
+	int	   m_numMeshesBuilt = 0;
+	int	   m_numMeshJobsRunning = 0;
+
+	//chunks left waiting for a remesh after this frame's budget, and frame times while chunks were still streaming in, to see how smooth it was
+	int	   m_numRemeshesWaiting = 0;
+	double m_lastUpdateTime = 0.0;
+	int	   m_numStreamingFrames = 0;
+	double m_streamingFrameSeconds = 0.0;
+	double m_streamingFrameSecondsSquared = 0.0;
+
+	//how long it took from the world starting (or changing seed) until every chunk in range was loaded, lit, and meshed
+	double m_fullViewStartTime = 0.0;
+	double m_fullViewSeconds = -1.0;	//negative until the full view is reached
+
+	//keyed by seed too, since the save thread can still be retrying saves from the seed before the current one
+	std::map<std::pair<unsigned int, IntVec2>, RegionFile*> m_openRegionFiles;
+	std::set<std::string>									m_regionFilesToCompact;	//closed while streaming with too many wasted sectors, so they get compacted once the world closes (same mutex)
+	std::mutex												m_regionFileMutex;
+
+	//every chunk that has a save on disk, built once per world so activation never has to ask the filesystem
+	//(has its own mutex, since the save thread adds to it while holding the region file mutex for a long write)
+	std::unordered_set<IntVec2, ChunkCoordsHasher> m_savedChunks;
+	std::unordered_set<IntVec2, ChunkCoordsHasher> m_chunksWrittenSinceBackup;	//so the next backup only has to read and hash these (same mutex)
+	std::mutex									   m_savedChunksMutex;
+
 	float m_worldTime = 0.4f;
 	float m_worldTimeScale = 200.0f;
 	Rgba8 m_nightSkyColor = Rgba8(20, 20, 40);
@@ -0,0 +1,704 @@
+#include "Game/WorldBackup.hpp"
+#include "Game/WorldBackupJob.hpp"
+#include "Game/BackupRestoreJob.hpp"
+#include "Game/RegionFile.hpp"
+#include "Game/Chunk.hpp"
+#include "Game/World.hpp"
+#include "Game/Game.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/JobSystem/JobSystem.hpp"
+#include <windows.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <set>
+#include <thread>
+
+
+//
+//public backup flow functions
+//
+void WorldBackup::Startup(World* world)
+{
+	m_world = world;
+	m_runningJob = nullptr;
+	m_lastBackupTime = GetCurrentTimeSeconds();
+	m_lastManifestEntries.clear();
+	m_hasLastManifest = false;
+	m_lastSnapshotIndex = -1;
+}
+
+
+void WorldBackup::Shutdown()
+{
+	//a flush waiting on its own jobs may have already claimed this one and set it aside
+	std::vector<Job*>& deferredJobs = m_world->m_deferredCompletedJobs;
+	auto deferredJobFound = std::find(deferredJobs.begin(), deferredJobs.end(), static_cast<Job*>(m_runningJob));
+	if (m_runningJob != nullptr && deferredJobFound != deferredJobs.end())
+	{
+		deferredJobs.erase(deferredJobFound);
+		OnBackupJobCompleted(m_runningJob);
+	}
+
+	//the job reads through the world's region files, so it has to finish before they close
+	while (m_runningJob != nullptr)
+	{
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		Job* completedJob = g_theJobSystem->ClaimCompletedJob();
+		if (completedJob == m_runningJob)
+		{
+			OnBackupJobCompleted(m_runningJob);
+		}
+		else
+		{
+			m_world->m_deferredCompletedJobs.push_back(completedJob);
+		}
+	}
+}
+
+
+void WorldBackup::Update()
+{
+	static double backupIntervalSeconds = static_cast<double>(g_gameConfigBlackboard.GetValue("worldBackupIntervalSeconds", 0.0f));
+
+	//periodic backups are off unless an interval is set
+	if (backupIntervalSeconds > 0.0 && m_runningJob == nullptr && GetCurrentTimeSeconds() - m_lastBackupTime >= backupIntervalSeconds)
+	{
+		BeginBackup();
+	}
+}
+
+
+bool WorldBackup::BeginBackup()
+{
+	if (m_runningJob != nullptr)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, "A backup is already running");
+		return false;
+	}
+
+	unsigned int worldSeed = m_world->m_worldSeed;
+	m_lastBackupTime = GetCurrentTimeSeconds();
+
+	CreateDirectoryA("Saves\\Backups", NULL);
+	CreateDirectoryA(GetBackupFolderPath(worldSeed).c_str(), NULL);
+	CreateDirectoryA((GetBackupFolderPath(worldSeed) + "/Objects").c_str(), NULL);
+
+	int snapshotIndex = (m_lastSnapshotIndex >= 0 ? m_lastSnapshotIndex : FindLatestSnapshotIndex(worldSeed)) + 1;
+	WorldBackupJob* backupJob = new WorldBackupJob(m_world, worldSeed, snapshotIndex, m_world->m_saveCodec, m_world->m_useOverlaySaves);
+	backupJob->m_startTime = m_lastBackupTime;
+
+	//chunks waiting to be saved, then edited active chunks on top, since those are newer still
+	//(taking a snapshot just shares the chunk's sections, so this is cheap even with lots of edited chunks)
+	std::map<IntVec2, std::shared_ptr<ChunkSnapshot const>> memorySnapshots;
+	std::vector<std::shared_ptr<ChunkSnapshot const>> pendingSaves;
+	m_world->m_chunkSaveQueue.GetPendingSaves(pendingSaves);
+	for (int saveIndex = 0; saveIndex < static_cast<int>(pendingSaves.size()); saveIndex++)
+	{
+		//saves still retrying from the seed before an F9 switch belong to that world's backups, not this one
+		if (pendingSaves[saveIndex]->m_worldSeed == worldSeed)
+		{
+			memorySnapshots[pendingSaves[saveIndex]->m_chunkCoords] = pendingSaves[saveIndex];
+		}
+	}
+	for (auto chunkIndex = m_world->m_activeChunks.begin(); chunkIndex != m_world->m_activeChunks.end(); chunkIndex++)
+	{
+		if (chunkIndex->second->m_needsSaving)
+		{
+			memorySnapshots[chunkIndex->first] = chunkIndex->second->TakeSnapshot();
+		}
+	}
+	for (auto memorySnapshotIndex = memorySnapshots.begin(); memorySnapshotIndex != memorySnapshots.end(); memorySnapshotIndex++)
+	{
+		backupJob->m_chunkSnapshots.push_back(memorySnapshotIndex->second);
+	}
+
+	//anything saved since the last snapshot gets read again, which also starts a fresh list for the next one
+	std::vector<IntVec2> savedChunkCoords;
+	std::unordered_set<IntVec2, ChunkCoordsHasher> changedChunks;
+	{
+		std::lock_guard<std::mutex> savedChunksLock(m_world->m_savedChunksMutex);
+		savedChunkCoords.assign(m_world->m_savedChunks.begin(), m_world->m_savedChunks.end());
+		changedChunks.swap(m_world->m_chunksWrittenSinceBackup);
+	}
+
+	for (int chunkIndex = 0; chunkIndex < static_cast<int>(savedChunkCoords.size()); chunkIndex++)
+	{
+		IntVec2 chunkCoords = savedChunkCoords[chunkIndex];
+		if (memorySnapshots.find(chunkCoords) != memorySnapshots.end())
+		{
+			continue;
+		}
+
+		auto lastEntryFound = m_lastManifestEntries.find(chunkCoords);
+		if (m_hasLastManifest && lastEntryFound != m_lastManifestEntries.end() && changedChunks.find(chunkCoords) == changedChunks.end())
+		{
+			backupJob->m_reusedEntries.push_back(lastEntryFound->second);
+		}
+		else
+		{
+			backupJob->m_savedChunkCoords.push_back(chunkCoords);
+		}
+	}
+
+	//region by region, so the job's reads hit one region file at a time
+	std::sort(backupJob->m_savedChunkCoords.begin(), backupJob->m_savedChunkCoords.end(), [](IntVec2 const& a, IntVec2 const& b)
+		{
+			IntVec2 regionA = RegionFile::GetRegionCoordsForChunk(a);
+			IntVec2 regionB = RegionFile::GetRegionCoordsForChunk(b);
+			if (regionA.x != regionB.x) return regionA.x < regionB.x;
+			if (regionA.y != regionB.y) return regionA.y < regionB.y;
+			if (a.x != b.x) return a.x < b.x;
+			return a.y < b.y;
+		});
+
+	m_runningJob = backupJob;
+	g_theJobSystem->PostNewJob(backupJob);
+	return true;
+}
+
+
+void WorldBackup::OnBackupJobCompleted(WorldBackupJob* backupJob)
+{
+	if (backupJob == m_runningJob)
+	{
+		m_runningJob = nullptr;
+	}
+
+	PrintBackupResults(backupJob);
+
+	//a failed snapshot has already thrown away the list of changed chunks, so the next one can't trust the last manifest
+	if (!backupJob->m_didWriteManifest)
+	{
+		m_lastManifestEntries.clear();
+		m_hasLastManifest = false;
+		delete backupJob;
+		return;
+	}
+
+	m_lastManifestEntries.clear();
+	for (int entryIndex = 0; entryIndex < static_cast<int>(backupJob->m_entries.size()); entryIndex++)
+	{
+		m_lastManifestEntries[backupJob->m_entries[entryIndex].m_chunkCoords] = backupJob->m_entries[entryIndex];
+	}
+	m_hasLastManifest = true;
+
+	m_numBackupsTaken++;
+	m_lastSnapshotIndex = backupJob->m_snapshotIndex;
+	m_lastNumChunks = static_cast<int>(backupJob->m_entries.size());
+	m_lastNumChunksReused = static_cast<int>(backupJob->m_reusedEntries.size());
+	m_lastNumObjectsWritten = backupJob->m_numObjectsWritten;
+	m_lastBackupSeconds = GetCurrentTimeSeconds() - backupJob->m_startTime;
+
+	delete backupJob;
+}
+
+
+bool WorldBackup::IsBackupRunning() const
+{
+	return m_runningJob != nullptr;
+}
+
+
+//
+//static backup utilities
+//
+bool WorldBackup::RunOfflineBackup(unsigned int worldSeed)
+{
+	//the loaded world has newer chunks in memory than on disk, so it has to back itself up
+	World* world = g_theGame != nullptr ? g_theGame->m_world : nullptr;
+	if (world != nullptr && world->m_worldSeed == worldSeed)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u is loaded, so it can only be backed up from the game", worldSeed));
+		return false;
+	}
+	if (world != nullptr && world->IsWorldSeedInUse(worldSeed))
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u still has chunk saves being written, so try again once they finish", worldSeed));
+		return false;
+	}
+
+	//find every saved chunk, with region copies winning over old per-chunk files like they do when loading
+	std::set<IntVec2> savedChunkCoords;
+	std::vector<IntVec2> legacyChunkCoords;
+	std::string worldFolderPath = Stringf("Saves\\World_%u", worldSeed);
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((worldFolderPath + "\\*").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("Couldn't find any saves for world %u", worldSeed));
+		return false;
+	}
+
+	bool areRegionsValid = true;
+	do
+	{
+		std::string fileName = findData.cFileName;
+		IntVec2 coords;
+		if (fileName.size() > 7 && fileName.compare(fileName.size() - 7, 7, ".region") == 0 && sscanf_s(fileName.c_str(), "Region(%d,%d)", &coords.x, &coords.y) == 2)
+		{
+			std::vector<IntVec2> regionChunkCoords;
+			if (!RegionFile::ReadSavedChunkCoords(RegionFile::GetRegionFilePath(worldSeed, coords), coords, regionChunkCoords))
+			{
+				PrintBackupLine(DevConsole::COLOR_ERROR, Stringf(" Region %i, %i has a damaged header", coords.x, coords.y));
+				areRegionsValid = false;
+			}
+			savedChunkCoords.insert(regionChunkCoords.begin(), regionChunkCoords.end());
+		}
+		else if (fileName.size() > 6 && fileName.compare(fileName.size() - 6, 6, ".chunk") == 0 && sscanf_s(fileName.c_str(), "Chunk(%d,%d)", &coords.x, &coords.y) == 2)
+		{
+			legacyChunkCoords.push_back(coords);
+		}
+	}
+	while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+
+	if (!areRegionsValid)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u wasn't backed up, since a snapshot of it would be missing chunks", worldSeed));
+		return false;
+	}
+	savedChunkCoords.insert(legacyChunkCoords.begin(), legacyChunkCoords.end());
+
+	CreateDirectoryA("Saves\\Backups", NULL);
+	CreateDirectoryA(GetBackupFolderPath(worldSeed).c_str(), NULL);
+	CreateDirectoryA((GetBackupFolderPath(worldSeed) + "/Objects").c_str(), NULL);
+
+	//nothing says which chunks changed since the last snapshot, so every chunk gets hashed, but unchanged ones still share their stored objects
+	int snapshotIndex = FindLatestSnapshotIndex(worldSeed) + 1;
+	PrintBackupLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Backing up world %u (%i chunks) to snapshot %i...", worldSeed, static_cast<int>(savedChunkCoords.size()), snapshotIndex));
+
+	WorldBackupJob* backupJob = new WorldBackupJob(nullptr, worldSeed, snapshotIndex, ChunkCodecType::PALETTE_RLE, false);
+	backupJob->m_startTime = GetCurrentTimeSeconds();
+	backupJob->m_savedChunkCoords.assign(savedChunkCoords.begin(), savedChunkCoords.end());
+	std::sort(backupJob->m_savedChunkCoords.begin(), backupJob->m_savedChunkCoords.end(), [](IntVec2 const& a, IntVec2 const& b)
+		{
+			IntVec2 regionA = RegionFile::GetRegionCoordsForChunk(a);
+			IntVec2 regionB = RegionFile::GetRegionCoordsForChunk(b);
+			if (regionA.x != regionB.x) return regionA.x < regionB.x;
+			if (regionA.y != regionB.y) return regionA.y < regionB.y;
+			if (a.x != b.x) return a.x < b.x;
+			return a.y < b.y;
+		});
+	g_theJobSystem->PostNewJob(backupJob);
+
+	bool isBackupDone = false;
+	bool didWriteManifest = false;
+	while (!isBackupDone)
+	{
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		//another world's generate and load jobs share the completed list, so hang on to those for its next update
+		Job* completedJob = g_theJobSystem->ClaimCompletedJob();
+		if (completedJob != backupJob)
+		{
+			if (world != nullptr)
+			{
+				world->m_deferredCompletedJobs.push_back(completedJob);
+			}
+			else
+			{
+				delete completedJob;
+			}
+			continue;
+		}
+
+		PrintBackupResults(backupJob);
+		didWriteManifest = backupJob->m_didWriteManifest;
+		delete backupJob;
+		isBackupDone = true;
+	}
+
+	return didWriteManifest;
+}
+
+
+bool WorldBackup::RestoreBackup(unsigned int worldSeed, int snapshotIndex)
+{
+	//the loaded world owns its folder and region files, so it can't have them swapped out from under it
+	//(the same goes for the world before an F9 switch, while the save thread is still writing its retried saves)
+	World* world = g_theGame != nullptr ? g_theGame->m_world : nullptr;
+	if (world != nullptr && world->m_worldSeed == worldSeed)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u is loaded, so switch to another seed (F9) before restoring it", worldSeed));
+		return false;
+	}
+	if (world != nullptr && world->IsWorldSeedInUse(worldSeed))
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u still has chunk saves being written, so try again once they finish", worldSeed));
+		return false;
+	}
+
+	double startTime = GetCurrentTimeSeconds();
+
+	if (snapshotIndex < 0)
+	{
+		snapshotIndex = FindLatestSnapshotIndex(worldSeed);
+	}
+	std::vector<BackupEntry> entries;
+	if (snapshotIndex < 0 || !ReadManifest(GetManifestFilePath(worldSeed, snapshotIndex), worldSeed, entries))
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("Couldn't find a readable backup snapshot for world %u", worldSeed));
+		return false;
+	}
+
+	PrintBackupLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Restoring world %u from snapshot %i (%i chunks)...", worldSeed, snapshotIndex, static_cast<int>(entries.size())));
+
+	//the restored world is built off to the side, so a failed restore leaves the current saves exactly as they were
+	std::string worldFolderPath = Stringf("Saves/World_%u", worldSeed);
+	std::string restoringFolderPath = worldFolderPath + ".restoring";
+	std::string previousFolderPath = worldFolderPath + ".beforeRestore";
+	DeleteFolder(restoringFolderPath);
+	CreateDirectoryA("Saves", NULL);
+	CreateDirectoryA(restoringFolderPath.c_str(), NULL);
+
+	//manifests are sorted by region, so every run of entries becomes one job writing one region file
+	int numRegionsToRestore = 0;
+	for (int entryIndex = 0; entryIndex < static_cast<int>(entries.size());)
+	{
+		IntVec2 regionCoords = RegionFile::GetRegionCoordsForChunk(entries[entryIndex].m_chunkCoords);
+		int endEntryIndex = entryIndex;
+		while (endEntryIndex < static_cast<int>(entries.size()) && RegionFile::GetRegionCoordsForChunk(entries[endEntryIndex].m_chunkCoords) == regionCoords)
+		{
+			endEntryIndex++;
+		}
+
+		std::string regionFilePath = Stringf("%s/Region(%i,%i).region", restoringFolderPath.c_str(), regionCoords.x, regionCoords.y);
+		std::vector<BackupEntry> regionEntries(entries.begin() + entryIndex, entries.begin() + endEntryIndex);
+		g_theJobSystem->PostNewJob(new BackupRestoreJob(worldSeed, regionFilePath, regionEntries));
+		numRegionsToRestore++;
+		entryIndex = endEntryIndex;
+	}
+
+	int numRegionsRestored = 0;
+	int numChunksRestored = 0;
+	int numChunksFailed = 0;
+	size_t numBytesRestored = 0;
+	int numErrorsPrinted = 0;
+	while (numRegionsRestored < numRegionsToRestore)
+	{
+		if (!g_theJobSystem->AreThereCompletedJobs())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		Job* completedJob = g_theJobSystem->ClaimCompletedJob();
+		BackupRestoreJob* restoreJob = dynamic_cast<BackupRestoreJob*>(completedJob);
+		if (restoreJob == nullptr)
+		{
+			if (world != nullptr)
+			{
+				world->m_deferredCompletedJobs.push_back(completedJob);
+			}
+			else
+			{
+				delete completedJob;
+			}
+			continue;
+		}
+
+		numChunksRestored += restoreJob->m_numChunksRestored;
+		numChunksFailed += restoreJob->m_numChunksFailed;
+		numBytesRestored += restoreJob->m_numBytesRestored;
+		for (int errorIndex = 0; errorIndex < static_cast<int>(restoreJob->m_errors.size()); errorIndex++)
+		{
+			if (numErrorsPrinted < 20)
+			{
+				PrintBackupLine(DevConsole::COLOR_ERROR, Stringf(" %s", restoreJob->m_errors[errorIndex].c_str()));
+			}
+			numErrorsPrinted++;
+		}
+
+		delete restoreJob;
+		numRegionsRestored++;
+	}
+
+	if (numErrorsPrinted > 20)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf(" ...and %i more errors", numErrorsPrinted - 20));
+	}
+	if (numChunksFailed > 0)
+	{
+		DeleteFolder(restoringFolderPath);
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("Restore failed (%i chunks couldn't be restored), so world %u was left alone", numChunksFailed, worldSeed));
+		return false;
+	}
+
+	//the current saves (and any edit journal with them) are kept next to the restored world until the next restore
+	DeleteFolder(previousFolderPath);
+	//(a world that was never saved has no folder to move, and one that can't be moved makes the next rename fail)
+	bool hadWorldFolder = std::rename(worldFolderPath.c_str(), previousFolderPath.c_str()) == 0;
+	if (std::rename(restoringFolderPath.c_str(), worldFolderPath.c_str()) != 0)
+	{
+		if (hadWorldFolder)
+		{
+			std::rename(previousFolderPath.c_str(), worldFolderPath.c_str());
+		}
+		DeleteFolder(restoringFolderPath);
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("Couldn't move the restored world %u into place (is its folder in use?), so nothing was restored", worldSeed));
+		return false;
+	}
+
+	double elapsedSeconds = GetCurrentTimeSeconds() - startTime;
+	double megabytesRestored = static_cast<double>(numBytesRestored) / (1024.0 * 1024.0);
+	PrintBackupLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Restored %i chunks in %i regions (%.1f MB) in %.2f s%s", numChunksRestored, numRegionsToRestore, megabytesRestored, elapsedSeconds,
+		hadWorldFolder ? Stringf(", old saves are in %s", previousFolderPath.c_str()).c_str() : ""));
+
+	return true;
+}
+
+
+uint64_t WorldBackup::HashPayload(uint8_t const* data, size_t dataSize)
+{
+	//fnv-1a, which is plenty to tell chunk saves apart and fast enough to run over every chunk in a backup
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (size_t byteIndex = 0; byteIndex < dataSize; byteIndex++)
+	{
+		hash ^= data[byteIndex];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+
+std::string WorldBackup::GetBackupFolderPath(unsigned int worldSeed)
+{
+	return Stringf("Saves/Backups/World_%u", worldSeed);
+}
+
+
+std::string WorldBackup::GetObjectFilePath(unsigned int worldSeed, uint64_t payloadHash)
+{
+	return Stringf("Saves/Backups/World_%u/Objects/%016llx.payload", worldSeed, static_cast<unsigned long long>(payloadHash));
+}
+
+
+std::string WorldBackup::GetManifestFilePath(unsigned int worldSeed, int snapshotIndex)
+{
+	return Stringf("Saves/Backups/World_%u/Snapshot_%i.manifest", worldSeed, snapshotIndex);
+}
+
+
+int WorldBackup::FindLatestSnapshotIndex(unsigned int worldSeed)
+{
+	int latestSnapshotIndex = -1;
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((GetBackupFolderPath(worldSeed) + "\\*").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+
+	do
+	{
+		std::string fileName = findData.cFileName;
+		int snapshotIndex = -1;
+		if (fileName.size() > 9 && fileName.compare(fileName.size() - 9, 9, ".manifest") == 0 && sscanf_s(fileName.c_str(), "Snapshot_%d", &snapshotIndex) == 1 && snapshotIndex > latestSnapshotIndex)
+		{
+			latestSnapshotIndex = snapshotIndex;
+		}
+	}
+	while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+	return latestSnapshotIndex;
+}
+
+
+bool WorldBackup::ReadManifest(std::string const& filePath, unsigned int worldSeed, std::vector<BackupEntry>& out_entries)
+{
+	out_entries.clear();
+
+	std::vector<uint8_t> manifest;
+	if (FileReadToBuffer(manifest, filePath) < WORLD_BACKUP_MANIFEST_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	auto readUint32 = [&manifest](size_t readIndex)
+		{
+			return static_cast<uint32_t>(manifest[readIndex]) | (static_cast<uint32_t>(manifest[readIndex + 1]) << 8) | (static_cast<uint32_t>(manifest[readIndex + 2]) << 16) | (static_cast<uint32_t>(manifest[readIndex + 3]) << 24);
+		};
+
+	bool isHeaderValid = manifest[0] == 'G' && manifest[1] == 'B' && manifest[2] == 'A' && manifest[3] == 'K' && manifest[4] == WORLD_BACKUP_MANIFEST_VERSION && readUint32(8) == worldSeed;
+	size_t numEntries = readUint32(16);
+	if (!isHeaderValid || manifest.size() != WORLD_BACKUP_MANIFEST_HEADER_SIZE + (numEntries * WORLD_BACKUP_MANIFEST_ENTRY_SIZE))
+	{
+		DebuggerPrintf("Backup manifest %s has a bad header or size, ignoring it\n", filePath.c_str());
+		return false;
+	}
+
+	out_entries.resize(numEntries);
+	for (size_t entryIndex = 0; entryIndex < numEntries; entryIndex++)
+	{
+		size_t readIndex = WORLD_BACKUP_MANIFEST_HEADER_SIZE + (entryIndex * WORLD_BACKUP_MANIFEST_ENTRY_SIZE);
+		BackupEntry& entry = out_entries[entryIndex];
+		entry.m_chunkCoords = IntVec2(static_cast<int>(readUint32(readIndex)), static_cast<int>(readUint32(readIndex + 4)));
+		entry.m_payloadSize = readUint32(readIndex + 8);
+		entry.m_payloadHash = static_cast<uint64_t>(readUint32(readIndex + 12)) | (static_cast<uint64_t>(readUint32(readIndex + 16)) << 32);
+	}
+
+	return true;
+}
+
+
+bool WorldBackup::WriteManifest(std::string const& filePath, unsigned int worldSeed, std::vector<BackupEntry> const& entries)
+{
+	std::vector<uint8_t> manifest;
+	manifest.reserve(WORLD_BACKUP_MANIFEST_HEADER_SIZE + (entries.size() * WORLD_BACKUP_MANIFEST_ENTRY_SIZE));
+	auto writeUint32 = [&manifest](uint32_t value)
+		{
+			manifest.push_back(static_cast<uint8_t>(value));
+			manifest.push_back(static_cast<uint8_t>(value >> 8));
+			manifest.push_back(static_cast<uint8_t>(value >> 16));
+			manifest.push_back(static_cast<uint8_t>(value >> 24));
+		};
+
+	uint8_t fourCC[8] = { 'G', 'B', 'A', 'K', WORLD_BACKUP_MANIFEST_VERSION, 0, 0, 0 };
+	manifest.insert(manifest.end(), fourCC, fourCC + 8);
+	writeUint32(worldSeed);
+	writeUint32(static_cast<uint32_t>(std::time(nullptr)));
+	writeUint32(static_cast<uint32_t>(entries.size()));
+
+	for (int entryIndex = 0; entryIndex < static_cast<int>(entries.size()); entryIndex++)
+	{
+		writeUint32(static_cast<uint32_t>(entries[entryIndex].m_chunkCoords.x));
+		writeUint32(static_cast<uint32_t>(entries[entryIndex].m_chunkCoords.y));
+		writeUint32(entries[entryIndex].m_payloadSize);
+		writeUint32(static_cast<uint32_t>(entries[entryIndex].m_payloadHash));
+		writeUint32(static_cast<uint32_t>(entries[entryIndex].m_payloadHash >> 32));
+	}
+
+	//a snapshot only exists once its whole manifest is on disk, so restores never see a partial one
+	std::string tempFilePath = filePath + ".tmp";
+	FILE* file = nullptr;
+	fopen_s(&file, tempFilePath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	bool didWriteManifest = fwrite(manifest.data(), 1, manifest.size(), file) == manifest.size();
+	didWriteManifest = fclose(file) == 0 && didWriteManifest;
+	if (!didWriteManifest || std::rename(tempFilePath.c_str(), filePath.c_str()) != 0)
+	{
+		std::remove(tempFilePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+bool WorldBackup::Event_BackupWorld(EventArgs& args)
+{
+	World* world = g_theGame != nullptr ? g_theGame->m_world : nullptr;
+	unsigned int worldSeed = world != nullptr ? world->m_worldSeed.load() : g_gameConfigBlackboard.GetValue("worldSeed", 0u);
+	worldSeed = args.GetValue("seed", worldSeed);
+
+	//the loaded world backs itself up in the background, anything else is read straight from its saves
+	if (world != nullptr && world->m_worldSeed == worldSeed)
+	{
+		if (!world->m_worldBackup.BeginBackup())
+		{
+			return false;
+		}
+		PrintBackupLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Backing up world %u in the background...", worldSeed));
+		return true;
+	}
+
+	return RunOfflineBackup(worldSeed);
+}
+
+
+bool WorldBackup::Event_RestoreBackup(EventArgs& args)
+{
+	unsigned int worldSeed = g_gameConfigBlackboard.GetValue("worldSeed", 0u);
+	worldSeed = args.GetValue("seed", worldSeed);
+	int snapshotIndex = args.GetValue("snapshot", -1);
+
+	return RestoreBackup(worldSeed, snapshotIndex);
+}
+
+
+//
+//private backup functions
+//
+void WorldBackup::PrintBackupLine(Rgba8 const& color, std::string const& text)
+{
+	//headless runs have no dev console, but get the parent's console for stdout instead
+	if (g_theDevConsole != nullptr)
+	{
+		g_theDevConsole->AddLine(color, text);
+	}
+	else
+	{
+		printf("%s\n", text.c_str());
+	}
+	DebuggerPrintf("%s\n", text.c_str());
+}
+
+
+void WorldBackup::PrintBackupResults(WorldBackupJob const* backupJob)
+{
+	for (int errorIndex = 0; errorIndex < static_cast<int>(backupJob->m_errors.size()) && errorIndex < 20; errorIndex++)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf(" %s", backupJob->m_errors[errorIndex].c_str()));
+	}
+	if (backupJob->m_errors.size() > 20)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf(" ...and %i more errors", static_cast<int>(backupJob->m_errors.size()) - 20));
+	}
+
+	if (!backupJob->m_didWriteManifest)
+	{
+		PrintBackupLine(DevConsole::COLOR_ERROR, Stringf("World %u backup failed (%i chunks couldn't be stored), so no snapshot was made", backupJob->m_worldSeed, backupJob->m_numChunksFailed));
+		return;
+	}
+
+	double elapsedSeconds = GetCurrentTimeSeconds() - backupJob->m_startTime;
+	PrintBackupLine(DevConsole::COLOR_INFO_MAJOR, Stringf("Snapshot %i of world %u: %i chunks, %i unchanged, %i hashed (%.1f MB), %i new objects (%.1f MB), %i already stored, took %.2f s", backupJob->m_snapshotIndex,
+		backupJob->m_worldSeed, static_cast<int>(backupJob->m_entries.size()), static_cast<int>(backupJob->m_reusedEntries.size()), backupJob->m_numChunksHashed,
+		static_cast<double>(backupJob->m_numBytesHashed) / (1024.0 * 1024.0), backupJob->m_numObjectsWritten, static_cast<double>(backupJob->m_numBytesWritten) / (1024.0 * 1024.0),
+		backupJob->m_numObjectsShared, elapsedSeconds));
+}
+
+
+bool WorldBackup::DeleteFolder(std::string const& folderPath)
+{
+	//world and restore folders only ever hold files, never other folders
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((folderPath + "\\*").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+	{
+		return true;
+	}
+
+	do
+	{
+		std::string fileName = findData.cFileName;
+		if (fileName != "." && fileName != "..")
+		{
+			std::remove((folderPath + "/" + fileName).c_str());
+		}
+	}
+	while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+	return RemoveDirectoryA(folderPath.c_str()) != 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/IntVec2.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+
+//backup constants
+constexpr int WORLD_BACKUP_MANIFEST_HEADER_SIZE = 20;	//4CC, version, 3 padding bytes, world seed, unix timestamp, number of entries
+constexpr int WORLD_BACKUP_MANIFEST_ENTRY_SIZE = 20;	//chunk x and y, payload size (4 bytes each), payload hash (8 bytes)
+constexpr uint8_t WORLD_BACKUP_MANIFEST_VERSION = 1;
+
+
+//forward declarations
+class World;
+class WorldBackupJob;
+
+
+//one chunk in a backup snapshot, which points at its save payload in the backup's object store
+struct BackupEntry
+{
+	IntVec2	 m_chunkCoords;
+	uint32_t m_payloadSize = 0;
+	uint64_t m_payloadHash = 0;
+};
+
+
+//incremental world backups built on a content-addressed store: every chunk save payload is stored once under its hash, and each snapshot is just a manifest of hashes
+//a snapshot only has to hash the chunks that were saved since the last one, and chunks that didn't change between snapshots share the same object
+//live backups read active and queued chunks from in-memory snapshots and run on a job, so they never hold up the world
+class WorldBackup
+{
+//public member functions
+public:
+	//backup flow functions
+	void Startup(World* world);
+	void Shutdown();
+	void Update();
+	bool BeginBackup();
+	void OnBackupJobCompleted(WorldBackupJob* backupJob);
+	bool IsBackupRunning() const;
+
+	//static backup utilities
+	static bool		   RunOfflineBackup(unsigned int worldSeed);
+	static bool		   RestoreBackup(unsigned int worldSeed, int snapshotIndex);
+	static uint64_t	   HashPayload(uint8_t const* data, size_t dataSize);
+	static std::string GetBackupFolderPath(unsigned int worldSeed);
+	static std::string GetObjectFilePath(unsigned int worldSeed, uint64_t payloadHash);
+	static std::string GetManifestFilePath(unsigned int worldSeed, int snapshotIndex);
+	static int		   FindLatestSnapshotIndex(unsigned int worldSeed);
+	static bool		   ReadManifest(std::string const& filePath, unsigned int worldSeed, std::vector<BackupEntry>& out_entries);
+	static bool		   WriteManifest(std::string const& filePath, unsigned int worldSeed, std::vector<BackupEntry> const& entries);
+	static bool		   Event_BackupWorld(EventArgs& args);
+	static bool		   Event_RestoreBackup(EventArgs& args);
+
+//private member functions
+private:
+	static void PrintBackupLine(Rgba8 const& color, std::string const& text);
+	static void PrintBackupResults(WorldBackupJob const* backupJob);
+	static bool DeleteFolder(std::string const& folderPath);
+
+//public member variables
+public:
+	int	   m_numBackupsTaken = 0;
+	int	   m_lastSnapshotIndex = -1;
+	int	   m_lastNumChunks = 0;
+	int	   m_lastNumChunksReused = 0;	//chunks carried over from the previous manifest without being read or hashed again
+	int	   m_lastNumObjectsWritten = 0;
+	double m_lastBackupSeconds = 0.0;
+
+//private member variables
+private:
+	World*			m_world = nullptr;
+	WorldBackupJob* m_runningJob = nullptr;
+	double			m_lastBackupTime = 0.0;
+
+	//the last manifest this session wrote, so the next snapshot can skip every chunk that hasn't been saved since
+	//(empty until the first backup, which has to hash everything)
+	std::map<IntVec2, BackupEntry> m_lastManifestEntries;
+	bool						   m_hasLastManifest = false;
+};
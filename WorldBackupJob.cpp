@@ -0,0 +1,131 @@
+#include "Game/WorldBackupJob.hpp"
+#include "Game/World.hpp"
+#include "Game/RegionFile.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include <algorithm>
+#include <cstdio>
+
+
+void WorldBackupJob::Execute()
+{
+	//chunks that only exist in memory go first, and anything they cover doesn't need to be read from disk
+	std::vector<uint8_t> payload;
+	for (int snapshotIndex = 0; snapshotIndex < static_cast<int>(m_chunkSnapshots.size()); snapshotIndex++)
+	{
+		ChunkSnapshot const* snapshot = m_chunkSnapshots[snapshotIndex].get();
+		payload.clear();
+		snapshot->WriteSaveBuffer(payload, m_saveCodec, m_allowOverlaySaves);
+		StorePayload(snapshot->m_chunkCoords, payload);
+	}
+
+	//offline backups keep one region open at a time, which works since the coords come sorted by region
+	std::unique_ptr<RegionFile> regionFile;
+	IntVec2 openRegionCoords;
+	for (int chunkIndex = 0; chunkIndex < static_cast<int>(m_savedChunkCoords.size()); chunkIndex++)
+	{
+		IntVec2 chunkCoords = m_savedChunkCoords[chunkIndex];
+		bool didReadChunk = false;
+		if (m_world != nullptr)
+		{
+			//buffered reads only, since a mapped chunk could be rewritten by the save thread while it's being hashed
+			didReadChunk = m_world->ReadSavedChunk(chunkCoords, payload);
+		}
+		else
+		{
+			IntVec2 regionCoords = RegionFile::GetRegionCoordsForChunk(chunkCoords);
+			if (regionFile == nullptr || regionCoords != openRegionCoords)
+			{
+				regionFile = std::make_unique<RegionFile>(RegionFile::GetRegionFilePath(m_worldSeed, regionCoords));
+				openRegionCoords = regionCoords;
+			}
+
+			std::string legacyFilePath = Stringf("Saves/World_%u/Chunk(%i,%i).chunk", m_worldSeed, chunkCoords.x, chunkCoords.y);
+			didReadChunk = regionFile->ReadChunk(chunkCoords, payload) || FileReadToBuffer(payload, legacyFilePath) > 0;
+		}
+
+		if (!didReadChunk)
+		{
+			m_errors.push_back(Stringf("Chunk %i, %i couldn't be read", chunkCoords.x, chunkCoords.y));
+			m_numChunksFailed++;
+			continue;
+		}
+
+		StorePayload(chunkCoords, payload);
+	}
+	regionFile.reset();
+
+	//a snapshot with missing chunks would restore a world with holes in it, so it doesn't get a manifest at all
+	if (m_numChunksFailed > 0)
+	{
+		return;
+	}
+
+	m_entries.insert(m_entries.end(), m_reusedEntries.begin(), m_reusedEntries.end());
+	std::sort(m_entries.begin(), m_entries.end(), [](BackupEntry const& a, BackupEntry const& b)
+		{
+			IntVec2 regionA = RegionFile::GetRegionCoordsForChunk(a.m_chunkCoords);
+			IntVec2 regionB = RegionFile::GetRegionCoordsForChunk(b.m_chunkCoords);
+			if (regionA.x != regionB.x) return regionA.x < regionB.x;
+			if (regionA.y != regionB.y) return regionA.y < regionB.y;
+			if (a.m_chunkCoords.x != b.m_chunkCoords.x) return a.m_chunkCoords.x < b.m_chunkCoords.x;
+			return a.m_chunkCoords.y < b.m_chunkCoords.y;
+		});
+
+	m_didWriteManifest = WorldBackup::WriteManifest(WorldBackup::GetManifestFilePath(m_worldSeed, m_snapshotIndex), m_worldSeed, m_entries);
+	if (!m_didWriteManifest)
+	{
+		m_errors.push_back(Stringf("Snapshot %i manifest couldn't be written", m_snapshotIndex));
+	}
+}
+
+
+//
+//private backup functions
+//
+bool WorldBackupJob::StorePayload(IntVec2 chunkCoords, std::vector<uint8_t> const& payload)
+{
+	BackupEntry entry;
+	entry.m_chunkCoords = chunkCoords;
+	entry.m_payloadSize = static_cast<uint32_t>(payload.size());
+	entry.m_payloadHash = WorldBackup::HashPayload(payload.data(), payload.size());
+	m_numChunksHashed++;
+	m_numBytesHashed += payload.size();
+
+	//objects are named by their hash, so one that's already there has these exact bytes in it
+	std::string objectFilePath = WorldBackup::GetObjectFilePath(m_worldSeed, entry.m_payloadHash);
+	if (CheckForFile(objectFilePath))
+	{
+		m_numObjectsShared++;
+		m_entries.push_back(entry);
+		return true;
+	}
+
+	//written to a temp file first, so a crash can't leave a truncated object behind under a real hash
+	std::string tempFilePath = objectFilePath + ".tmp";
+	FILE* file = nullptr;
+	fopen_s(&file, tempFilePath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		m_errors.push_back(Stringf("Chunk %i, %i payload couldn't be stored", chunkCoords.x, chunkCoords.y));
+		m_numChunksFailed++;
+		return false;
+	}
+
+	bool didWritePayload = fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+	didWritePayload = fclose(file) == 0 && didWritePayload;
+
+	//another chunk with the same blocks may have stored this object in the meantime, which is just as good
+	if (!didWritePayload || (std::rename(tempFilePath.c_str(), objectFilePath.c_str()) != 0 && !CheckForFile(objectFilePath)))
+	{
+		std::remove(tempFilePath.c_str());
+		m_errors.push_back(Stringf("Chunk %i, %i payload couldn't be stored", chunkCoords.x, chunkCoords.y));
+		m_numChunksFailed++;
+		return false;
+	}
+	std::remove(tempFilePath.c_str());
+
+	m_numObjectsWritten++;
+	m_numBytesWritten += payload.size();
+	m_entries.push_back(entry);
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Game/WorldBackup.hpp"
+#include "Game/ChunkSnapshot.hpp"
+#include "Game/ChunkCodec.hpp"
+#include "Engine/JobSystem/Job.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+
+//forward declarations
+class World;
+
+
+//writes one backup snapshot: stores the payload of every chunk that changed since the last snapshot, then writes the manifest
+//snapshots were taken on the main thread before the job was posted, and saved chunks are read through the world's locked region reads,
+//so nothing here touches a live chunk (with no world, it's an offline backup and the job opens the region files itself)
+class WorldBackupJob : public Job
+{
+//public member functions
+public:
+	WorldBackupJob(World* world, unsigned int worldSeed, int snapshotIndex, ChunkCodecType saveCodec, bool allowOverlaySaves)
+		: m_world(world)
+		, m_worldSeed(worldSeed)
+		, m_snapshotIndex(snapshotIndex)
+		, m_saveCodec(saveCodec)
+		, m_allowOverlaySaves(allowOverlaySaves)
+	{}
+
+	virtual void Execute() override;
+
+//private member functions
+private:
+	bool StorePayload(IntVec2 chunkCoords, std::vector<uint8_t> const& payload);
+
+//public member variables
+public:
+	World*		   m_world = nullptr;
+	unsigned int   m_worldSeed = 0;
+	int			   m_snapshotIndex = 0;
+	ChunkCodecType m_saveCodec = ChunkCodecType::PALETTE_RLE;
+	bool		   m_allowOverlaySaves = false;
+	double		   m_startTime = 0.0;
+
+	//inputs
+	std::vector<std::shared_ptr<ChunkSnapshot const>> m_chunkSnapshots;	//active and queued chunks whose latest blocks aren't on disk yet
+	std::vector<IntVec2>							  m_savedChunkCoords;	//chunks that get read from disk, sorted by region
+	std::vector<BackupEntry>						  m_reusedEntries;		//unchanged chunks carried over from the previous manifest
+
+	//results (entries are sorted by region, then chunk)
+	std::vector<BackupEntry> m_entries;
+	bool					 m_didWriteManifest = false;
+	int						 m_numChunksHashed = 0;
+	int						 m_numObjectsWritten = 0;
+	int						 m_numObjectsShared = 0;	//payloads already in the store from an earlier snapshot or another chunk
+	int						 m_numChunksFailed = 0;
+	size_t					 m_numBytesHashed = 0;
+	size_t					 m_numBytesWritten = 0;
+	std::vector<std::string> m_errors;
+};